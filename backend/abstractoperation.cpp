@@ -27,6 +27,11 @@ int AbstractOperation::operationState() const
     return m_operationState;
 }
 
+bool AbstractOperation::isFinished() const
+{
+    return m_operationState == AbstractOperation::Finished;
+}
+
 void AbstractOperation::setTimeout(int msec)
 {
     m_timeoutTimer->setInterval(msec);
@@ -25,6 +25,7 @@ public:
     virtual void finish();
 
     int operationState() const;
+    bool isFinished() const;
     void setTimeout(int msec);
 
     double progress() const;
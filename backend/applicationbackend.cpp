@@ -5,6 +5,7 @@
 #include <QCoreApplication>
 
 #include "logger.h"
+#include "fleetrunner.h"
 #include "deviceregistry.h"
 #include "firmwareupdateregistry.h"
 
@@ -17,6 +18,7 @@
 
 #include "flipperzero/flipperzero.h"
 #include "flipperzero/devicestate.h"
+#include "flipperzero/protobufsession.h"
 #include "flipperzero/assetmanifest.h"
 #include "flipperzero/screenstreamer.h"
 
@@ -35,6 +37,7 @@ ApplicationBackend::ApplicationBackend(QObject *parent):
     QObject(parent),
     m_deviceRegistry(new DeviceRegistry(this)),
     m_firmwareUpdateRegistry(new FirmwareUpdateRegistry("https://update.flipperzero.one/firmware/directory.json", this)),
+    m_fleetRunner(new FleetRunner(this)),
     m_screenStreamer(new ScreenStreamer(this)),
     m_virtualDisplay(new VirtualDisplay(this)),
     m_fileManager(new FileManager(this)),
@@ -88,6 +91,15 @@ QAbstractListModel *ApplicationBackend::firmwareUpdateModel() const
     return m_firmwareUpdateRegistry;
 }
 
+QAbstractListModel *ApplicationBackend::rpcMetrics() const
+{
+    if(device()) {
+        return device()->rpc()->metrics();
+    } else {
+        return nullptr;
+    }
+}
+
 FlipperZero *ApplicationBackend::device() const
 {
     return m_deviceRegistry->currentDevice();
@@ -107,6 +119,16 @@ DeviceRegistry *ApplicationBackend::deviceRegistry() const
     return m_deviceRegistry;
 }
 
+QAbstractListModel *ApplicationBackend::deviceModel() const
+{
+    return m_deviceRegistry;
+}
+
+FleetRunner *ApplicationBackend::fleetRunner() const
+{
+    return m_fleetRunner;
+}
+
 ScreenStreamer *ApplicationBackend::screenStreamer() const
 {
     return m_screenStreamer;
@@ -234,6 +256,38 @@ void ApplicationBackend::finalizeOperation()
     }
 }
 
+void ApplicationBackend::fleetFullUpdate(const QList<int> &deviceIndices)
+{
+    const auto versionInfo = m_firmwareUpdateRegistry->latestVersion();
+
+    m_fleetRunner->run(fleetDevices(deviceIndices), [versionInfo](FlipperZero *device) {
+        device->fullUpdate(versionInfo);
+    });
+}
+
+void ApplicationBackend::fleetFullRepair(const QList<int> &deviceIndices)
+{
+    const auto versionInfo = m_firmwareUpdateRegistry->latestVersion();
+
+    m_fleetRunner->run(fleetDevices(deviceIndices), [versionInfo](FlipperZero *device) {
+        device->fullRepair(versionInfo);
+    });
+}
+
+void ApplicationBackend::fleetRestoreBackup(const QList<int> &deviceIndices, const QUrl &backupUrl)
+{
+    m_fleetRunner->run(fleetDevices(deviceIndices), [backupUrl](FlipperZero *device) {
+        device->restoreBackup(backupUrl);
+    });
+}
+
+void ApplicationBackend::fleetInstallFirmware(const QList<int> &deviceIndices, const QUrl &fileUrl)
+{
+    m_fleetRunner->run(fleetDevices(deviceIndices), [fileUrl](FlipperZero *device) {
+        device->installFirmware(fileUrl);
+    });
+}
+
 void ApplicationBackend::onCurrentDeviceChanged()
 {
     // Should not happen during an ongoing operation
@@ -284,6 +338,11 @@ void ApplicationBackend::onDeviceInfoChanged()
 
 void ApplicationBackend::onDeviceOperationFinished()
 {
+    if(device() && m_fleetRunner->isBusy(device())) {
+        // Reported by the fleet runner instead
+        return;
+    }
+
     if(!device()) {
         qCDebug(LOG_BACKEND) << "Lost all connected devices";
         setErrorType(BackendError::UnknownError);
@@ -375,6 +434,24 @@ void ApplicationBackend::beginRepair()
     connect(helper, &AbstractOperationHelper::finished, helper, &QObject::deleteLater);
 }
 
+const QVector<FlipperZero*> ApplicationBackend::fleetDevices(const QList<int> &deviceIndices) const
+{
+    QVector<FlipperZero*> devices;
+
+    for(const auto idx : deviceIndices) {
+        auto *device = m_deviceRegistry->device(idx);
+
+        if(!device) {
+            qCDebug(LOG_BACKEND) << "Invalid device index:" << idx;
+            continue;
+        }
+
+        devices.append(device);
+    }
+
+    return devices;
+}
+
 void ApplicationBackend::setBackendState(BackendState newState)
 {
     if(m_backendState == newState) {
@@ -408,6 +485,7 @@ void ApplicationBackend::registerMetaTypes()
     qRegisterMetaType<Flipper::Zero::StorageInfo>("Flipper::Zero::StorageInfo");
 
     qRegisterMetaType<Flipper::FlipperZero*>("Flipper::FlipperZero*");
+    qRegisterMetaType<Flipper::FleetRunner*>("Flipper::FleetRunner*");
     qRegisterMetaType<Flipper::Zero::DeviceState*>("Flipper::Zero::DeviceState*");
     qRegisterMetaType<Flipper::Zero::ScreenStreamer*>("Flipper::Zero::ScreenStreamer*");
     qRegisterMetaType<Flipper::Zero::VirtualDisplay*>("Flipper::Zero::VirtualDisplay*");
@@ -8,6 +8,7 @@
 
 namespace Flipper {
 class FlipperZero;
+class FleetRunner;
 class DeviceRegistry;
 class UpdateRegistry;
 
@@ -19,6 +20,7 @@ class VirtualDisplay;
 }}
 
 #if QT_VERSION >= 0x060000
+Q_MOC_INCLUDE("fleetrunner.h")
 Q_MOC_INCLUDE("flipperzero/devicestate.h")
 Q_MOC_INCLUDE("flipperzero/screenstreamer.h")
 Q_MOC_INCLUDE("flipperzero/virtualdisplay.h")
@@ -35,9 +37,12 @@ class ApplicationBackend : public QObject
     Q_PROPERTY(Flipper::Zero::FileManager* fileManager READ fileManager CONSTANT)
     Q_PROPERTY(FirmwareUpdateState firmwareUpdateState READ firmwareUpdateState NOTIFY firmwareUpdateStateChanged)
     Q_PROPERTY(QAbstractListModel* firmwareUpdateModel READ firmwareUpdateModel CONSTANT)
+    Q_PROPERTY(QAbstractListModel* rpcMetrics READ rpcMetrics NOTIFY currentDeviceChanged)
     Q_PROPERTY(Flipper::Updates::VersionInfo latestFirmwareVersion READ latestFirmwareVersion NOTIFY firmwareUpdateStateChanged)
     Q_PROPERTY(BackendError::ErrorType errorType READ errorType NOTIFY errorTypeChanged)
     Q_PROPERTY(bool isQueryInProgress READ isQueryInProgress NOTIFY isQueryInProgressChanged)
+    Q_PROPERTY(QAbstractListModel* deviceModel READ deviceModel CONSTANT)
+    Q_PROPERTY(Flipper::FleetRunner* fleetRunner READ fleetRunner CONSTANT)
 
 public:
     enum class BackendState {
@@ -79,6 +84,8 @@ public:
     Flipper::Zero::DeviceState *deviceState() const;
 
     Flipper::DeviceRegistry *deviceRegistry() const;
+    QAbstractListModel *deviceModel() const;
+    Flipper::FleetRunner *fleetRunner() const;
 
     Flipper::Zero::ScreenStreamer *screenStreamer() const;
     Flipper::Zero::VirtualDisplay *virtualDisplay() const;
@@ -86,6 +93,7 @@ public:
 
     FirmwareUpdateState firmwareUpdateState() const;
     QAbstractListModel *firmwareUpdateModel() const;
+    QAbstractListModel *rpcMetrics() const;
     const Flipper::Updates::VersionInfo latestFirmwareVersion() const;
 
     // TODO: Replace it with a state
@@ -111,6 +119,14 @@ public:
     Q_INVOKABLE void checkFirmwareUpdates();
     Q_INVOKABLE void finalizeOperation();
 
+    /* Fleet actions.
+     * Apply to the devices at the given rows of deviceModel, several at a time. */
+
+    Q_INVOKABLE void fleetFullUpdate(const QList<int> &deviceIndices);
+    Q_INVOKABLE void fleetFullRepair(const QList<int> &deviceIndices);
+    Q_INVOKABLE void fleetRestoreBackup(const QList<int> &deviceIndices, const QUrl &backupUrl);
+    Q_INVOKABLE void fleetInstallFirmware(const QList<int> &deviceIndices, const QUrl &fileUrl);
+
 signals:
     void errorTypeChanged();
     void currentDeviceChanged();
@@ -137,11 +153,14 @@ private:
     void beginUpdate();
     void beginRepair();
 
+    const QVector<Flipper::FlipperZero*> fleetDevices(const QList<int> &deviceIndices) const;
+
     void setBackendState(BackendState newState);
     void setErrorType(BackendError::ErrorType newErrorType);
 
     Flipper::DeviceRegistry *m_deviceRegistry;
     Flipper::UpdateRegistry *m_firmwareUpdateRegistry;
+    Flipper::FleetRunner *m_fleetRunner;
 
     Flipper::Zero::ScreenStreamer *m_screenStreamer;
     Flipper::Zero::VirtualDisplay *m_virtualDisplay;
@@ -18,10 +18,13 @@ SOURCES += \
     failable.cpp \
     filenode.cpp \
     firmwareupdateregistry.cpp \
+    fleetrunner.cpp \
     flipperupdates.cpp \
     flipperzero/assetmanifest.cpp \
     flipperzero/filemanager.cpp \
+    flipperzero/protobufpluginregistry.cpp \
     flipperzero/protobufsession.cpp \
+    flipperzero/protobuftransport.cpp \
     flipperzero/rpc/abstractprotobufoperation.cpp \
     flipperzero/rpc/abstractstorageoperation.cpp \
     flipperzero/rpc/guiscreenframeoperation.cpp \
@@ -52,6 +55,7 @@ SOURCES += \
     flipperzero/devicestate.cpp \
     flipperzero/factoryinfo.cpp \
     flipperzero/flipperzero.cpp \
+    flipperzero/localsockettransport.cpp \
     flipperzero/helper/deviceinfohelper.cpp \
     flipperzero/helper/firmwarehelper.cpp \
     flipperzero/helper/radiomanifesthelper.cpp \
@@ -59,6 +63,7 @@ SOURCES += \
     flipperzero/helper/serialinithelper.cpp \
     flipperzero/helper/toplevelhelper.cpp \
     flipperzero/radiomanifest.cpp \
+    flipperzero/receivebuffer.cpp \
     flipperzero/recovery.cpp \
     flipperzero/recovery/abstractrecoveryoperation.cpp \
     flipperzero/recovery/correctoptionbytesoperation.cpp \
@@ -68,7 +73,10 @@ SOURCES += \
     flipperzero/recovery/wirelessstackdownloadoperation.cpp \
     flipperzero/recoveryinterface.cpp \
     flipperzero/rpc/systemupdateoperation.cpp \
+    flipperzero/rpcmetrics.cpp \
     flipperzero/screenstreamer.cpp \
+    flipperzero/serialtransport.cpp \
+    flipperzero/storagewritetuner.cpp \
     flipperzero/toplevel/abstracttopleveloperation.cpp \
     flipperzero/toplevel/factoryresetoperation.cpp \
     flipperzero/toplevel/firmwareinstalloperation.cpp \
@@ -124,6 +132,7 @@ HEADERS += \
     fileinfo.h \
     filenode.h \
     firmwareupdateregistry.h \
+    fleetrunner.h \
     flipperupdates.h \
     flipperzero/assetmanifest.h \
     flipperzero/devicecolor.h \
@@ -132,7 +141,9 @@ HEADERS += \
     flipperzero/pixmaps/default.h \
     flipperzero/pixmaps/updateok.h \
     flipperzero/pixmaps/updating.h \
+    flipperzero/protobufpluginregistry.h \
     flipperzero/protobufsession.h \
+    flipperzero/protobuftransport.h \
     flipperzero/rpc/abstractprotobufoperation.h \
     flipperzero/rpc/abstractstorageoperation.h \
     flipperzero/rpc/guiscreenframeoperation.h \
@@ -164,6 +175,7 @@ HEADERS += \
     flipperzero/devicestate.h \
     flipperzero/factoryinfo.h \
     flipperzero/flipperzero.h \
+    flipperzero/localsockettransport.h \
     flipperzero/helper/deviceinfohelper.h \
     flipperzero/helper/firmwarehelper.h \
     flipperzero/helper/radiomanifesthelper.h \
@@ -171,6 +183,7 @@ HEADERS += \
     flipperzero/helper/serialinithelper.h \
     flipperzero/helper/toplevelhelper.h \
     flipperzero/radiomanifest.h \
+    flipperzero/receivebuffer.h \
     flipperzero/recovery.h \
     flipperzero/recovery/abstractrecoveryoperation.h \
     flipperzero/recovery/correctoptionbytesoperation.h \
@@ -180,7 +193,10 @@ HEADERS += \
     flipperzero/recovery/wirelessstackdownloadoperation.h \
     flipperzero/recoveryinterface.h \
     flipperzero/rpc/systemupdateoperation.h \
+    flipperzero/rpcmetrics.h \
     flipperzero/screenstreamer.h \
+    flipperzero/serialtransport.h \
+    flipperzero/storagewritetuner.h \
     flipperzero/toplevel/abstracttopleveloperation.h \
     flipperzero/toplevel/factoryresetoperation.h \
     flipperzero/toplevel/firmwareinstalloperation.h \
@@ -225,5 +241,10 @@ HEADERS += \
     updateregistry.h \
     versioninfo.h
 
+linux {
+    SOURCES += sysfsserialfinder.cpp
+    HEADERS += sysfsserialfinder.h
+}
+
 INCLUDEPATH += $$PWD/../dfu \
                $$PWD/../plugins/protobufinterface
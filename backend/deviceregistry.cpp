@@ -19,7 +19,7 @@ Q_LOGGING_CATEGORY(LOG_DEVREG, "REG");
 using namespace Flipper;
 
 DeviceRegistry::DeviceRegistry(QObject *parent):
-    QObject(parent),
+    QAbstractListModel(parent),
     m_detector(new USBDeviceDetector(this)),
     m_error(BackendError::UnknownError),
     m_isQueryInProgress(false)
@@ -45,6 +45,16 @@ FlipperZero *DeviceRegistry::currentDevice() const
     return m_devices.isEmpty() ? nullptr : m_devices.first();
 }
 
+FlipperZero *DeviceRegistry::device(int index) const
+{
+    return m_devices.value(index, nullptr);
+}
+
+const DeviceRegistry::DeviceList &DeviceRegistry::devices() const
+{
+    return m_devices;
+}
+
 int DeviceRegistry::deviceCount() const
 {
     return m_devices.size();
@@ -65,6 +75,46 @@ bool DeviceRegistry::isQueryInProgress() const
     return m_isQueryInProgress;
 }
 
+int DeviceRegistry::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return m_devices.size();
+}
+
+QVariant DeviceRegistry::data(const QModelIndex &index, int role) const
+{
+    auto *device = m_devices.value(index.row(), nullptr);
+
+    if(!device) {
+        return QVariant();
+    }
+
+    auto *state = device->deviceState();
+
+    switch(role) {
+    case DeviceStateRole:
+        return QVariant::fromValue(state);
+    case NameRole:
+        return state->name();
+    case SerialNumberRole:
+        return state->deviceInfo().usbInfo.serialNumber();
+    case IsOnlineRole:
+        return state->isOnline();
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> DeviceRegistry::roleNames() const
+{
+    return {
+        {DeviceStateRole, QByteArrayLiteral("deviceState")},
+        {NameRole, QByteArrayLiteral("name")},
+        {SerialNumberRole, QByteArrayLiteral("serialNumber")},
+        {IsOnlineRole, QByteArrayLiteral("isOnline")}
+    };
+}
+
 void DeviceRegistry::insertDevice(const USBDeviceInfo &info)
 {
     if(!info.isComplete()) {
@@ -104,7 +154,10 @@ void DeviceRegistry::removeDevice(const USBDeviceInfo &info)
             qCDebug(LOG_DEVREG).noquote().nospace()
                 << "Device disconnected: VID_0x" << QString::number(info.vendorID(), 16) << ":PID_0x" << QString::number(info.productID(), 16);
 
+            beginRemoveRows(QModelIndex(), idx, idx);
             m_devices.takeAt(idx)->deleteLater();
+            endRemoveRows();
+
             emit deviceCountChanged();
             emit currentDeviceChanged();
 
@@ -119,17 +172,22 @@ void DeviceRegistry::removeDevice(const USBDeviceInfo &info)
 
 void DeviceRegistry::removeOfflineDevices()
 {
-    auto it = std::remove_if(m_devices.begin(), m_devices.end(), [](Flipper::FlipperZero *arg) {
-        return !arg->deviceState()->isOnline();
-    });
+    for(auto i = m_devices.size() - 1; i >= 0; --i) {
+        auto *device = m_devices.at(i);
+
+        if(device->deviceState()->isOnline()) {
+            continue;
+        }
 
-    for(const auto end = m_devices.end(); it != end; ++it) {
-        qCDebug(LOG_DEVREG).noquote() << "Removed offline device:" << (*it)->deviceState()->name();
+        qCDebug(LOG_DEVREG).noquote() << "Removed offline device:" << device->deviceState()->name();
+
+        beginRemoveRows(QModelIndex(), i, i);
+        m_devices.removeAt(i);
+        endRemoveRows();
 
-        m_devices.erase(it);
         emit deviceCountChanged();
 
-        (*it)->deleteLater();
+        device->deleteLater();
     }
 }
 
@@ -153,13 +211,28 @@ void DeviceRegistry::processDevice()
     if(it != m_devices.end()) {
         // Preserving the old instance
         qCDebug(LOG_DEVREG) << "Device went back online";
-        (*it)->deviceState()->setDeviceInfo(info);
+
+        auto *device = *it;
+
+        // Let the old instance carry on with the session that was used to query the device
+        if(auto *session = fetcher->takeSession()) {
+            device->adoptSession(session);
+        }
+
+        device->deviceState()->setDeviceInfo(info);
 
     } else {
         qCDebug(LOG_DEVREG) << "Registering the device";
 
-        auto *device = new FlipperZero(info, this);
+        // Reuse the session that was used to query the device, if possible
+        auto *device = new FlipperZero(info, fetcher->takeSession(), this);
+
+        connect(device->deviceState(), &Zero::DeviceState::deviceInfoChanged, this, &DeviceRegistry::onDeviceStateChanged);
+        connect(device->deviceState(), &Zero::DeviceState::isOnlineChanged, this, &DeviceRegistry::onDeviceStateChanged);
+
+        beginInsertRows(QModelIndex(), m_devices.size(), m_devices.size());
         m_devices.append(device);
+        endInsertRows();
 
         emit deviceCountChanged();
 
@@ -169,6 +242,19 @@ void DeviceRegistry::processDevice()
     }
 }
 
+void DeviceRegistry::onDeviceStateChanged()
+{
+    const auto *state = sender();
+    const auto it = std::find_if(m_devices.cbegin(), m_devices.cend(), [state](Flipper::FlipperZero *dev) {
+        return dev->deviceState() == state;
+    });
+
+    if(it != m_devices.cend()) {
+        const auto idx = index(std::distance(m_devices.cbegin(), it));
+        emit dataChanged(idx, idx);
+    }
+}
+
 void DeviceRegistry::setError(BackendError::ErrorType newError)
 {
     if(m_error == newError) {
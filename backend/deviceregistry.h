@@ -1,7 +1,7 @@
 #pragma once
 
-#include <QObject>
 #include <QVector>
+#include <QAbstractListModel>
 
 #include "backenderror.h"
 #include "usbdeviceinfo.h"
@@ -12,18 +12,29 @@ namespace Flipper {
 
 class FlipperZero;
 
-class DeviceRegistry : public QObject
+class DeviceRegistry : public QAbstractListModel
 {
     Q_OBJECT
 
     using DeviceList = QVector<FlipperZero*>;
 
 public:
+    enum DeviceRole {
+        DeviceStateRole = Qt::UserRole,
+        NameRole,
+        SerialNumberRole,
+        IsOnlineRole
+    };
+
+    Q_ENUM(DeviceRole)
+
     DeviceRegistry(QObject *parent = nullptr);
 
     void setBackendLogLevel(int logLevel);
 
     FlipperZero *currentDevice() const;
+    FlipperZero *device(int index) const;
+    const DeviceList &devices() const;
     int deviceCount() const;
 
     BackendError::ErrorType error() const;
@@ -31,6 +42,11 @@ public:
 
     bool isQueryInProgress() const;
 
+    // Model API functions
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
 signals:
     void isQueryInProgressChanged();
     void currentDeviceChanged();
@@ -44,6 +60,7 @@ public slots:
 
 private slots:
     void processDevice();
+    void onDeviceStateChanged();
 
 private:
     void setError(BackendError::ErrorType newError);
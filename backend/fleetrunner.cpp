@@ -0,0 +1,202 @@
+#include "fleetrunner.h"
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QLoggingCategory>
+
+#include "flipperzero/flipperzero.h"
+#include "flipperzero/devicestate.h"
+
+#define DEFAULT_MAX_JOBS 4
+
+Q_LOGGING_CATEGORY(LOG_FLEET, "FLT")
+
+using namespace Flipper;
+using namespace Zero;
+
+FleetRunner::FleetRunner(QObject *parent):
+    QObject(parent),
+    m_maxJobs(DEFAULT_MAX_JOBS),
+    m_isRunning(false),
+    m_totalCount(0),
+    m_finishedCount(0),
+    m_errorCount(0)
+{}
+
+int FleetRunner::maxJobs() const
+{
+    return m_maxJobs;
+}
+
+void FleetRunner::setMaxJobs(int maxJobs)
+{
+    maxJobs = qMax(1, maxJobs);
+
+    if(m_maxJobs == maxJobs) {
+        return;
+    }
+
+    m_maxJobs = maxJobs;
+    emit maxJobsChanged();
+
+    if(m_isRunning) {
+        startJobs();
+    }
+}
+
+bool FleetRunner::isRunning() const
+{
+    return m_isRunning;
+}
+
+bool FleetRunner::isBusy(FlipperZero *device) const
+{
+    if(m_activeDevices.contains(device)) {
+        return true;
+    }
+
+    return std::any_of(m_queue.cbegin(), m_queue.cend(), [device](const Entry &entry) {
+        return entry.device == device;
+    });
+}
+
+int FleetRunner::totalCount() const
+{
+    return m_totalCount;
+}
+
+int FleetRunner::finishedCount() const
+{
+    return m_finishedCount;
+}
+
+int FleetRunner::errorCount() const
+{
+    return m_errorCount;
+}
+
+void FleetRunner::run(const QVector<FlipperZero*> &devices, const Job &job)
+{
+    if(!m_isRunning) {
+        m_totalCount = 0;
+        m_finishedCount = 0;
+        m_errorCount = 0;
+    }
+
+    for(auto *device : devices) {
+        if(isBusy(device)) {
+            qCDebug(LOG_FLEET).noquote() << "Device is busy, skipping:" << device->deviceState()->name();
+            continue;
+        }
+
+        m_queue.enqueue({device, device->deviceState()->name(), job});
+        ++m_totalCount;
+    }
+
+    emit progressChanged();
+
+    if(m_queue.isEmpty() && m_activeDevices.isEmpty()) {
+        return;
+    }
+
+    qCDebug(LOG_FLEET) << "Running on" << m_queue.size() << "devices," << m_maxJobs << "at a time";
+
+    setRunning(true);
+    startJobs();
+}
+
+void FleetRunner::startJobs()
+{
+    while(!m_queue.isEmpty() && (m_activeDevices.size() < m_maxJobs)) {
+        startJob(m_queue.dequeue());
+    }
+
+    if(m_queue.isEmpty() && m_activeDevices.isEmpty()) {
+        qCDebug(LOG_FLEET) << "Finished," << m_errorCount << "of" << m_totalCount << "devices failed";
+
+        setRunning(false);
+        emit finished();
+    }
+}
+
+void FleetRunner::startJob(const Entry &entry)
+{
+    auto *device = entry.device.data();
+
+    if(!device) {
+        qCDebug(LOG_FLEET).noquote() << "Lost the device while in the queue:" << entry.deviceName;
+
+        finishJob(nullptr, true);
+        emit deviceLost(entry.deviceName);
+        return;
+    }
+
+    m_activeDevices.append(device);
+
+    auto *state = device->deviceState();
+    const auto deviceName = state->name();
+
+    connect(device, &FlipperZero::operationFinished, this, [=]() {
+        device->disconnect(this);
+        state->disconnect(this);
+
+        finishJob(device, state->isError());
+        emit deviceFinished(device);
+
+        startJobs();
+    });
+
+    connect(device, &QObject::destroyed, this, [=]() {
+        qCDebug(LOG_FLEET).noquote() << "Lost the device during operation:" << deviceName;
+
+        finishJob(device, true);
+        emit deviceLost(deviceName);
+
+        startJobs();
+    });
+
+    const auto startOperation = [=]() {
+        // Leftovers from the previous operation, if any
+        device->finalizeOperation();
+
+        emit deviceStarted(device);
+        entry.job(device);
+    };
+
+    if(state->isOnline()) {
+        startOperation();
+        return;
+    }
+
+    // E.g. still rebooting after the previous operation
+    connect(state, &DeviceState::isOnlineChanged, this, [=]() {
+        if(state->isOnline()) {
+            state->disconnect(this);
+            startOperation();
+        }
+    });
+}
+
+void FleetRunner::finishJob(FlipperZero *device, bool isError)
+{
+    m_activeDevices.removeOne(device);
+
+    ++m_finishedCount;
+
+    if(isError) {
+        ++m_errorCount;
+    }
+
+    emit progressChanged();
+}
+
+void FleetRunner::setRunning(bool set)
+{
+    if(m_isRunning == set) {
+        return;
+    }
+
+    m_isRunning = set;
+    emit isRunningChanged();
+}
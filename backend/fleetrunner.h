@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QQueue>
+#include <QObject>
+#include <QPointer>
+
+#include <functional>
+
+namespace Flipper {
+
+class FlipperZero;
+
+// Runs the same operation on several devices at once.
+// Devices are taken from the queue as the running ones finish, so that no more
+// than maxJobs() of them are busy at the same time (a cheap USB hub will not like more).
+class FleetRunner : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int maxJobs READ maxJobs WRITE setMaxJobs NOTIFY maxJobsChanged)
+    Q_PROPERTY(bool isRunning READ isRunning NOTIFY isRunningChanged)
+    Q_PROPERTY(int totalCount READ totalCount NOTIFY progressChanged)
+    Q_PROPERTY(int finishedCount READ finishedCount NOTIFY progressChanged)
+    Q_PROPERTY(int errorCount READ errorCount NOTIFY progressChanged)
+
+public:
+    // Expected to start exactly one operation on the device
+    using Job = std::function<void(FlipperZero*)>;
+
+    FleetRunner(QObject *parent = nullptr);
+
+    int maxJobs() const;
+    void setMaxJobs(int maxJobs);
+
+    bool isRunning() const;
+    bool isBusy(FlipperZero *device) const;
+
+    int totalCount() const;
+    int finishedCount() const;
+    int errorCount() const;
+
+    void run(const QVector<FlipperZero*> &devices, const Job &job);
+
+signals:
+    void maxJobsChanged();
+    void isRunningChanged();
+    void progressChanged();
+
+    void deviceStarted(Flipper::FlipperZero *device);
+    void deviceFinished(Flipper::FlipperZero *device);
+    // The device was unplugged and forgotten before its operation finished
+    void deviceLost(const QString &deviceName);
+
+    void finished();
+
+private:
+    struct Entry {
+        QPointer<FlipperZero> device;
+        // Still known after the device is gone
+        QString deviceName;
+        Job job;
+    };
+
+    void startJobs();
+    void startJob(const Entry &entry);
+    void finishJob(FlipperZero *device, bool isError);
+
+    void setRunning(bool set);
+
+    QQueue<Entry> m_queue;
+    QVector<FlipperZero*> m_activeDevices;
+
+    int m_maxJobs;
+    bool m_isRunning;
+
+    int m_totalCount;
+    int m_finishedCount;
+    int m_errorCount;
+};
+
+}
@@ -36,12 +36,19 @@ using namespace Updates;
 using namespace Zero;
 
 FlipperZero::FlipperZero(const Zero::DeviceInfo &info, QObject *parent):
+    FlipperZero(info, nullptr, parent)
+{}
+
+FlipperZero::FlipperZero(const Zero::DeviceInfo &info, Zero::ProtobufSession *rpc, QObject *parent):
     QObject(parent),
     m_state(new DeviceState(info, this)),
-    m_rpc(new ProtobufSession(info.portInfo, this)),
+    m_rpc(rpc ? rpc : new ProtobufSession(info.portInfo, this)),
+    m_pendingRpc(nullptr),
     m_recovery(new RecoveryInterface(m_state, this)),
     m_utility(new UtilityInterface(m_state, m_rpc, this))
 {
+    m_rpc->setParent(this);
+
     connect(m_state, &DeviceState::deviceInfoChanged, this, &FlipperZero::onDeviceInfoChanged);
     connect(m_state, &DeviceState::deviceInfoChanged, this, &FlipperZero::deviceStateChanged);
 
@@ -65,6 +72,16 @@ UtilityInterface *FlipperZero::utility() const
     return m_utility;
 }
 
+void FlipperZero::adoptSession(ProtobufSession *rpc)
+{
+    if(m_pendingRpc) {
+        m_pendingRpc->deleteLater();
+    }
+
+    m_pendingRpc = rpc;
+    m_pendingRpc->setParent(this);
+}
+
 // TODO: Handle -rcxx suffixes correctly
 bool FlipperZero::canUpdate(const Updates::VersionInfo &versionInfo) const
 {
@@ -216,7 +233,17 @@ void FlipperZero::onDeviceInfoChanged()
     if(m_state->isOnline()) {
         // Most likely Storage info update
         return;
-    } else if(m_state->isRecoveryMode()) {
+    }
+
+    auto *pendingRpc = m_pendingRpc;
+    m_pendingRpc = nullptr;
+
+    if(pendingRpc) {
+        // Whatever happens, the other session is not needed anymore
+        pendingRpc->deleteLater();
+    }
+
+    if(m_state->isRecoveryMode()) {
         // Recovery mode, not using Protobuf
         m_state->setOnline(true);
         return;
@@ -231,6 +258,17 @@ void FlipperZero::onDeviceInfoChanged()
     const auto &pb = deviceInfo.protobuf;
     const auto &pi = deviceInfo.portInfo;
 
+    if(pendingRpc) {
+        m_rpc->adoptSession(pendingRpc);
+    }
+
+    if(m_rpc->isSessionUp()) {
+        // The session has been handed over already running, no need for another handshake
+        m_rpc->setMinorVersion(pb.versionMinor);
+        m_state->setOnline(true);
+        return;
+    }
+
     m_rpc->setMajorVersion(pb.versionMajor);
     m_rpc->setMinorVersion(pb.versionMinor);
     m_rpc->setSerialPort(pi);
@@ -25,11 +25,17 @@ class FlipperZero : public QObject
 
 public:
     FlipperZero(const Zero::DeviceInfo &info, QObject *parent = nullptr);
+    // Takes over an RPC session that is already up, e.g. the one used to fetch the device info
+    FlipperZero(const Zero::DeviceInfo &info, Zero::ProtobufSession *rpc, QObject *parent = nullptr);
 
     Zero::DeviceState *deviceState() const;
     Zero::ProtobufSession *rpc() const;
     Zero::UtilityInterface *utility() const;
 
+    // Use the connection of a session that is already up the next time the device comes online,
+    // instead of performing the handshake again
+    void adoptSession(Zero::ProtobufSession *rpc);
+
     bool canUpdate(const Flipper::Updates::VersionInfo &versionInfo) const;
     bool canInstall(const Flipper::Updates::VersionInfo &versionInfo) const;
     bool canRepair(const Flipper::Updates::VersionInfo &versionInfo) const;
@@ -61,6 +67,7 @@ private:
 
     Zero::DeviceState *m_state;
     Zero::ProtobufSession *m_rpc;
+    Zero::ProtobufSession *m_pendingRpc;
     Zero::RecoveryInterface *m_recovery;
     Zero::UtilityInterface *m_utility;
 };
@@ -23,6 +23,10 @@
 #include "device/stm32wb55.h"
 #include "serialfinder.h"
 
+#if defined(Q_OS_LINUX)
+#include "sysfsserialfinder.h"
+#endif
+
 Q_DECLARE_LOGGING_CATEGORY(CATEGORY_DEBUG)
 
 using namespace Flipper;
@@ -55,12 +59,38 @@ const DeviceInfo &AbstractDeviceInfoHelper::result() const
     return m_deviceInfo;
 }
 
+ProtobufSession *AbstractDeviceInfoHelper::takeSession()
+{
+    return nullptr;
+}
+
 VCPDeviceInfoHelper::VCPDeviceInfoHelper(const USBDeviceInfo &info, QObject *parent):
-    AbstractDeviceInfoHelper(parent)
+    AbstractDeviceInfoHelper(parent),
+    m_rpc(nullptr)
 {
     m_deviceInfo.usbInfo = info;
 }
 
+ProtobufSession *VCPDeviceInfoHelper::takeSession()
+{
+    if(!m_rpc || isError() || !m_rpc->isSessionUp()) {
+        return nullptr;
+    }
+
+    auto *rpc = m_rpc;
+    m_rpc = nullptr;
+
+    rpc->disconnect(this);
+    rpc->setParent(nullptr);
+
+    return rpc;
+}
+
+void VCPDeviceInfoHelper::clearCache()
+{
+    deviceInfoCache().clear();
+}
+
 void VCPDeviceInfoHelper::nextStateLogic()
 {
     if(state() == AbstractDeviceInfoHelper::Ready) {
@@ -72,8 +102,13 @@ void VCPDeviceInfoHelper::nextStateLogic()
         startRPCSession();
 
     } else if(state() == VCPDeviceInfoHelper::StartingRPCSession) {
-        setState(VCPDeviceInfoHelper::FetchingProtobufVersion);
-        fetchProtobufVersion();
+        if(hasCachedInfo()) {
+            setState(VCPDeviceInfoHelper::ValidatingCachedInfo);
+            validateCachedInfo();
+        } else {
+            setState(VCPDeviceInfoHelper::FetchingProtobufVersion);
+            fetchProtobufVersion();
+        }
 
     } else if(state() == VCPDeviceInfoHelper::FetchingProtobufVersion) {
         setState(VCPDeviceInfoHelper::FetchingDeviceInfo);
@@ -96,27 +131,55 @@ void VCPDeviceInfoHelper::nextStateLogic()
         syncTime();
 
     } else if(state() == VCPDeviceInfoHelper::SyncingTime) {
-        setState(VCPDeviceInfoHelper::StoppingRPCSession);
-        stopRPCSession();
+        deviceInfoCache().insert(m_deviceInfo.usbInfo.serialNumber(), m_deviceInfo);
+        finishOrStopRPCSession();
     }
 }
 
 void VCPDeviceInfoHelper::findSerialPort()
+{
+#if defined(Q_OS_LINUX)
+    const auto &systemPath = m_deviceInfo.usbInfo.systemPath();
+
+    if(!systemPath.isEmpty()) {
+        auto *finder = new SysfsSerialFinder(systemPath, this);
+
+        connect(finder, &SysfsSerialFinder::finished, this, [=](const QSerialPortInfo &portInfo) {
+            finder->deleteLater();
+
+            if(portInfo.isNull()) {
+                // Try the slow but universal way
+                findSerialPortBySerialNumber();
+            } else {
+                onSerialPortFound(portInfo);
+            }
+        });
+
+        return;
+    }
+#endif
+
+    findSerialPortBySerialNumber();
+}
+
+void VCPDeviceInfoHelper::findSerialPortBySerialNumber()
 {
     auto *finder = new SerialFinder(m_deviceInfo.usbInfo.serialNumber(), this);
+    connect(finder, &SerialFinder::finished, this, &VCPDeviceInfoHelper::onSerialPortFound);
+}
 
-    connect(finder, &SerialFinder::finished, this, [=](const QSerialPortInfo &portInfo) {
-        if(portInfo.isNull()) {
-            finishWithError(BackendError::SerialAccessError, QStringLiteral("Failed to find a suitable serial port"));
+void VCPDeviceInfoHelper::onSerialPortFound(const QSerialPortInfo &portInfo)
+{
+    if(portInfo.isNull()) {
+        finishWithError(BackendError::SerialAccessError, QStringLiteral("Failed to find a suitable serial port"));
 
-        } else {
-            qCDebug(CATEGORY_DEBUG).noquote() << "Using  serial port" << portInfo.serialNumber() << "at" << portInfo.systemLocation();
-            m_deviceInfo.portInfo = portInfo;
-            m_deviceInfo.systemLocation = portInfo.systemLocation();
+    } else {
+        qCDebug(CATEGORY_DEBUG).noquote() << "Using  serial port" << portInfo.serialNumber() << "at" << portInfo.systemLocation();
+        m_deviceInfo.portInfo = portInfo;
+        m_deviceInfo.systemLocation = portInfo.systemLocation();
 
-            advanceState();
-        }
-    });
+        advanceState();
+    }
 }
 
 void VCPDeviceInfoHelper::startRPCSession()
@@ -126,6 +189,51 @@ void VCPDeviceInfoHelper::startRPCSession()
     m_rpc->startSession();
 }
 
+void VCPDeviceInfoHelper::validateCachedInfo()
+{
+    const auto cachedInfo = deviceInfoCache().value(m_deviceInfo.usbInfo.serialNumber());
+
+    m_rpc->setMinorVersion(cachedInfo.protobuf.versionMinor);
+
+    // Only the firmware part of the device info, enough to tell whether anything has changed
+    auto *operation = m_rpc->propertyGet(QByteArrayLiteral("devinfo.firmware"));
+
+    connect(operation, &AbstractOperation::finished, this, [=]() {
+        if(operation->isError()) {
+            finishWithError(BackendError::InvalidDevice, QStringLiteral("Failed to get firmware information: %1").arg(operation->errorString()));
+            return;
+        }
+
+        const auto isSameFirmware = operation->value(QByteArrayLiteral("firmware.version")) == cachedInfo.firmware.version &&
+                                    operation->value(QByteArrayLiteral("firmware.commit.hash")) == cachedInfo.firmware.commit;
+
+        if(!isSameFirmware) {
+            qCDebug(CATEGORY_DEBUG) << "Firmware has changed since the last connection, doing a full query";
+
+            deviceInfoCache().remove(m_deviceInfo.usbInfo.serialNumber());
+            // Go the long way
+            setState(VCPDeviceInfoHelper::StartingRPCSession);
+            advanceState();
+            return;
+        }
+
+        qCDebug(CATEGORY_DEBUG) << "Using cached device information";
+
+        const auto usbInfo = m_deviceInfo.usbInfo;
+        const auto portInfo = m_deviceInfo.portInfo;
+        const auto systemLocation = m_deviceInfo.systemLocation;
+
+        m_deviceInfo = cachedInfo;
+        m_deviceInfo.usbInfo = usbInfo;
+        m_deviceInfo.portInfo = portInfo;
+        m_deviceInfo.systemLocation = systemLocation;
+
+        // Storage state may have changed regardless, continue from there
+        setState(VCPDeviceInfoHelper::FetchingDeviceInfo);
+        advanceState();
+    });
+}
+
 void VCPDeviceInfoHelper::fetchProtobufVersion()
 {
     auto *operation = m_rpc->systemProtobufVersion();
@@ -329,6 +437,18 @@ void VCPDeviceInfoHelper::syncTime()
     });
 }
 
+void VCPDeviceInfoHelper::finishOrStopRPCSession()
+{
+    // The session is kept open to be reused by the device unless it speaks another major version
+    if(m_rpc->versionMajor() == m_deviceInfo.protobuf.versionMajor) {
+        m_rpc->setMinorVersion(m_deviceInfo.protobuf.versionMinor);
+        finish();
+    } else {
+        setState(VCPDeviceInfoHelper::StoppingRPCSession);
+        stopRPCSession();
+    }
+}
+
 void VCPDeviceInfoHelper::stopRPCSession()
 {
     m_rpc->stopSession();
@@ -336,7 +456,9 @@ void VCPDeviceInfoHelper::stopRPCSession()
 
 void VCPDeviceInfoHelper::onSessionStatusChanged()
 {
-    if(m_rpc->isError()) {
+    if(state() == AbstractOperationHelper::Finished) {
+        return;
+    } else if(m_rpc->isError()) {
         finishWithError(m_rpc->error(), QStringLiteral("Protobuf session error: %1").arg(m_rpc->errorString()));
     } else if(state() == VCPDeviceInfoHelper::StartingRPCSession && m_rpc->isSessionUp()) {
         advanceState();
@@ -368,11 +490,34 @@ const QString &VCPDeviceInfoHelper::branchToChannelName(const QByteArray &branch
     }
 }
 
+QHash<QString, DeviceInfo> &VCPDeviceInfoHelper::deviceInfoCache()
+{
+    static QHash<QString, DeviceInfo> cache;
+    return cache;
+}
+
+bool VCPDeviceInfoHelper::hasCachedInfo() const
+{
+    const auto it = deviceInfoCache().constFind(m_deviceInfo.usbInfo.serialNumber());
+
+    if(it == deviceInfoCache().constEnd()) {
+        return false;
+    }
+
+    // The firmware can only be checked quickly with the property API
+    const auto &protobuf = it->protobuf;
+    return (protobuf.versionMajor == m_rpc->versionMajor()) && ((protobuf.versionMajor > 0) || (protobuf.versionMinor >= 14));
+}
+
 using namespace STM32;
 
 DFUDeviceInfoHelper::DFUDeviceInfoHelper(const USBDeviceInfo &info, QObject *parent):
     AbstractDeviceInfoHelper(parent)
 {
+    // Radio stack and FUS are updated in recovery mode without changing
+    // the firmware version, so the cached information cannot be trusted anymore
+    VCPDeviceInfoHelper::clearCache();
+
     m_deviceInfo.usbInfo = info;
     m_deviceInfo.systemLocation = QStringLiteral("S/N:%1").arg(info.serialNumber());
     m_deviceInfo.storage.isExternalPresent = false;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QHash>
 #include <QObject>
 #include <QByteArray>
 
@@ -8,6 +9,7 @@
 
 class QTimer;
 class QSerialPort;
+class QSerialPortInfo;
 
 namespace Flipper {
 namespace Zero {
@@ -25,6 +27,10 @@ public:
     static AbstractDeviceInfoHelper *create(const USBDeviceInfo &info, QObject *parent = nullptr);
     const DeviceInfo &result() const;
 
+    // Returns the RPC session left running after a successful query, if any.
+    // The caller takes ownership of the session.
+    virtual ProtobufSession *takeSession();
+
 protected:
     DeviceInfo m_deviceInfo;
 };
@@ -36,6 +42,7 @@ class VCPDeviceInfoHelper : public AbstractDeviceInfoHelper
     enum OperationState {
         FindingSerialPort = AbstractOperationHelper::User,
         StartingRPCSession,
+        ValidatingCachedInfo,
         FetchingProtobufVersion,
         FetchingDeviceInfo,
         CheckingSDCard,
@@ -48,11 +55,18 @@ class VCPDeviceInfoHelper : public AbstractDeviceInfoHelper
 public:
     VCPDeviceInfoHelper(const USBDeviceInfo &info, QObject *parent = nullptr);
 
+    ProtobufSession *takeSession() override;
+
+    // Forget everything known about the previously seen devices
+    static void clearCache();
+
 private:
     void nextStateLogic() override;
 
     void findSerialPort();
+    void findSerialPortBySerialNumber();
     void startRPCSession();
+    void validateCachedInfo();
     void fetchProtobufVersion();
     void fetchDeviceInfo();
     void fetchDeviceInfoLegacy();
@@ -61,13 +75,20 @@ private:
     void checkManifest();
     void getTimeSkew();
     void syncTime();
+    void finishOrStopRPCSession();
     void stopRPCSession();
 
 private slots:
+    void onSerialPortFound(const QSerialPortInfo &portInfo);
     void onSessionStatusChanged();
 
 private:
     static const QString &branchToChannelName(const QByteArray &branchName);
+    // Device information from the previous connections, by USB serial number
+    static QHash<QString, DeviceInfo> &deviceInfoCache();
+
+    bool hasCachedInfo() const;
+
     ProtobufSession *m_rpc;
 };
 
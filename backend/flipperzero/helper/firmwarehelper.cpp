@@ -178,9 +178,8 @@ void FirmwareHelper::fetchFile(FileIndex index, const Updates::FileInfo &fileInf
         return;
     }
 
-    const auto fileName = QUrl(fileInfo.url()).fileName();
-
-    auto *file = globalTempDirs->createFile(fileName, this);
+    // Not named after the remote file, as several devices may be fetching it at the same time
+    auto *file = globalTempDirs->createTempFile(this);
     auto *fetcher = new RemoteFileFetcher(fileInfo, file, this);
 
     if(fetcher->isError()) {
@@ -0,0 +1,69 @@
+#include "localsockettransport.h"
+
+#include <QLocalSocket>
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(LOG_SESSION)
+
+using namespace Flipper;
+using namespace Zero;
+
+LocalSocketTransport::LocalSocketTransport(const QString &serverName, ProtobufPluginInterface *plugin, QObject *parent):
+    ProtobufTransport(plugin, parent),
+    m_serverName(serverName),
+    m_socket(nullptr)
+{}
+
+void LocalSocketTransport::open()
+{
+    m_socket = new QLocalSocket(this);
+
+    connect(m_socket, &QLocalSocket::connected, this, &LocalSocketTransport::onSocketConnected);
+    connect(m_socket, &QLocalSocket::disconnected, this, &LocalSocketTransport::onSocketDisconnected);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    connect(m_socket, &QLocalSocket::errorOccurred, this, &LocalSocketTransport::onSocketErrorOccured);
+#else
+    connect(m_socket, QOverload<QLocalSocket::LocalSocketError>::of(&QLocalSocket::error), this, &LocalSocketTransport::onSocketErrorOccured);
+#endif
+
+    m_socket->connectToServer(m_serverName);
+}
+
+bool LocalSocketTransport::flush()
+{
+    return m_socket->flush() || m_socket->error() == QLocalSocket::UnknownSocketError;
+}
+
+void LocalSocketTransport::onSocketConnected()
+{
+    setDevice(m_socket);
+    emit opened();
+}
+
+void LocalSocketTransport::onSocketDisconnected()
+{
+    if(!device()) {
+        return;
+    }
+
+    qCInfo(LOG_SESSION) << "Local connection was lost.";
+    m_socket->disconnect(this);
+
+    close();
+    m_socket = nullptr;
+
+    emit connectionLost();
+}
+
+void LocalSocketTransport::onSocketErrorOccured()
+{
+    if(device()) {
+        // Errors after connecting are followed by disconnected()
+        return;
+    }
+
+    emit errorOccured(BackendError::SerialAccessError, QStringLiteral("Failed to connect to %1: %2").arg(m_serverName, m_socket->errorString()));
+
+    m_socket->deleteLater();
+    m_socket = nullptr;
+}
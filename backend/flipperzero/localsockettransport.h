@@ -0,0 +1,38 @@
+#pragma once
+
+#include "protobuftransport.h"
+
+#include <QString>
+
+class QLocalSocket;
+
+namespace Flipper {
+namespace Zero {
+
+// Talks to a local server speaking the same protocol, e.g. the device emulator
+class LocalSocketTransport : public ProtobufTransport
+{
+    Q_OBJECT
+
+public:
+    LocalSocketTransport(const QString &serverName, ProtobufPluginInterface *plugin, QObject *parent = nullptr);
+
+public slots:
+    void open() override;
+
+protected:
+    bool flush() override;
+
+private slots:
+    void onSocketConnected();
+    void onSocketDisconnected();
+    void onSocketErrorOccured();
+
+private:
+    QString m_serverName;
+    QLocalSocket *m_socket;
+};
+
+}
+}
+
@@ -0,0 +1,182 @@
+#include "protobufpluginregistry.h"
+
+#include <algorithm>
+
+#include <QDir>
+#include <QDebug>
+#include <QPluginLoader>
+#include <QMutexLocker>
+#include <QLoggingCategory>
+#include <QCoreApplication>
+
+#include "protobufplugininterface.h"
+
+#if defined(QT_STATIC)
+Q_IMPORT_PLUGIN(ProtobufPlugin)
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(LOG_SESSION)
+
+using namespace Flipper;
+using namespace Zero;
+
+ProtobufPluginRegistry::ProtobufPluginRegistry():
+    m_isDiscovered(false)
+{}
+
+ProtobufPluginRegistry *ProtobufPluginRegistry::instance()
+{
+    static auto *registry = new ProtobufPluginRegistry();
+    return registry;
+}
+
+const QVector<uint32_t> ProtobufPluginRegistry::supportedVersions()
+{
+    QMutexLocker locker(&m_mutex);
+    discover();
+
+    return m_entries.keys().toVector();
+}
+
+ProtobufPluginInterface *ProtobufPluginRegistry::acquire(uint32_t versionMajor, QString *errorString)
+{
+    QMutexLocker locker(&m_mutex);
+    discover();
+
+    if(m_entries.isEmpty()) {
+        if(errorString) {
+            *errorString = QStringLiteral("Cannot find protobuf support plugins");
+        }
+
+        return nullptr;
+    }
+
+    const auto it = m_entries.find(versionMajor);
+
+    if(it == m_entries.end()) {
+        if(errorString) {
+            *errorString = QStringLiteral("Protocol version %1 is not supported yet. Please update the application.").arg(versionMajor);
+        }
+
+        return nullptr;
+
+    } else if(!it->plugin && !load(it.value(), errorString)) {
+        return nullptr;
+    }
+
+    ++it->refCount;
+    return it->plugin;
+}
+
+void ProtobufPluginRegistry::release(ProtobufPluginInterface *plugin)
+{
+    if(!plugin) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    for(auto &entry : m_entries) {
+        if(entry.plugin == plugin) {
+            // The plugin stays loaded, unloading it while another session
+            // still holds objects created by it is a sure way to crash
+            entry.refCount = qMax(0, entry.refCount - 1);
+            return;
+        }
+    }
+
+    qCWarning(LOG_SESSION) << "Attempting to release an unknown protobuf plugin";
+}
+
+int ProtobufPluginRegistry::refCount(uint32_t versionMajor)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.value(versionMajor).refCount;
+}
+
+#if !defined(QT_STATIC)
+const QString ProtobufPluginRegistry::pluginFileName(uint32_t versionMajor)
+{
+#if defined(Q_OS_WINDOWS)
+    return QStringLiteral("flipperproto%1.dll").arg(versionMajor);
+#elif defined(Q_OS_MAC)
+    return QStringLiteral("libflipperproto%1.dylib").arg(versionMajor);
+#elif defined(Q_OS_LINUX)
+    return QStringLiteral("libflipperproto%1.so").arg(versionMajor);
+#else
+#error "Unsupported OS"
+#endif
+}
+#endif
+
+void ProtobufPluginRegistry::discover()
+{
+    if(m_isDiscovered) {
+        return;
+    }
+
+    m_isDiscovered = true;
+
+#if defined(QT_STATIC)
+    const auto staticInstances = QPluginLoader::staticInstances();
+
+    for(auto *instance : staticInstances) {
+        if(auto *protobufPlugin = qobject_cast<ProtobufPluginInterface*>(instance)) {
+            Entry entry;
+            entry.plugin = protobufPlugin;
+            m_entries.insert(protobufPlugin->versionMajor(), entry);
+        }
+    }
+#else
+    const auto libraryPaths = QCoreApplication::libraryPaths();
+
+    // Versions are expected to be consecutive, starting from 0
+    for(uint32_t i = 0;; ++i) {
+        const auto fileName = pluginFileName(i);
+        const auto it = std::find_if(libraryPaths.cbegin(), libraryPaths.cend(), [&fileName](const QString &path) {
+            return QDir(path).exists(fileName);
+        });
+
+        if(it == libraryPaths.cend()) {
+            break;
+        }
+
+        Entry entry;
+        entry.fileName = QDir(*it).absoluteFilePath(fileName);
+        m_entries.insert(i, entry);
+    }
+#endif
+
+    qCDebug(LOG_SESSION) << "Found protobuf plugins for versions:" << m_entries.keys();
+}
+
+bool ProtobufPluginRegistry::load(Entry &entry, QString *errorString)
+{
+#if defined(QT_STATIC)
+    Q_UNUSED(entry)
+
+    if(errorString) {
+        *errorString = QStringLiteral("Static protobuf plugin is not available");
+    }
+
+    return false;
+#else
+    if(!entry.loader) {
+        // Never deleted nor unloaded, lives as long as the application does
+        entry.loader = new QPluginLoader(entry.fileName);
+    }
+
+    entry.plugin = qobject_cast<ProtobufPluginInterface*>(entry.loader->instance());
+
+    if(!entry.plugin) {
+        if(errorString) {
+            *errorString = QStringLiteral("Failed to load protobuf plugin: %1").arg(entry.loader->errorString());
+        }
+
+        return false;
+    }
+
+    qCDebug(LOG_SESSION).noquote() << "Loaded protobuf plugin" << entry.fileName;
+    return true;
+#endif
+}
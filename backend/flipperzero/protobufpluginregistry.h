@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QMap>
+#include <QMutex>
+#include <QVector>
+#include <QString>
+
+class QPluginLoader;
+class ProtobufPluginInterface;
+
+namespace Flipper {
+namespace Zero {
+
+// Process-wide set of the protobuf plugins, shared by all RPC sessions.
+// Plugins are discovered once and stay loaded for the lifetime of the application.
+class ProtobufPluginRegistry
+{
+    ProtobufPluginRegistry();
+
+public:
+    static ProtobufPluginRegistry *instance();
+
+    const QVector<uint32_t> supportedVersions();
+
+    // Returns nullptr if the plugin is missing or cannot be loaded
+    ProtobufPluginInterface *acquire(uint32_t versionMajor, QString *errorString = nullptr);
+    void release(ProtobufPluginInterface *plugin);
+
+    int refCount(uint32_t versionMajor);
+
+private:
+    struct Entry {
+        QString fileName;
+        QPluginLoader *loader = nullptr;
+        ProtobufPluginInterface *plugin = nullptr;
+        int refCount = 0;
+    };
+
+#if !defined(QT_STATIC)
+    static const QString pluginFileName(uint32_t versionMajor);
+#endif
+
+    void discover();
+    bool load(Entry &entry, QString *errorString);
+
+    QMutex m_mutex;
+    bool m_isDiscovered;
+    QMap<uint32_t, Entry> m_entries;
+};
+
+}
+}
+
+#define globalProtobufPlugins (Flipper::Zero::ProtobufPluginRegistry::instance())
@@ -1,17 +1,15 @@
 #include "protobufsession.h"
 
-#include <QDir>
 #include <QDebug>
 #include <QTimer>
-#include <QSerialPort>
-#include <QPluginLoader>
+#include <QThread>
 #include <QLoggingCategory>
-#include <QCoreApplication>
 
 #include "protobufplugininterface.h"
+#include "protobufpluginregistry.h"
 #include "mainresponseinterface.h"
-
-#include "helper/serialinithelper.h"
+#include "serialtransport.h"
+#include "localsockettransport.h"
 
 #include "rpc/storageinfooperation.h"
 #include "rpc/storagestatoperation.h"
@@ -40,12 +38,20 @@
 
 #include "rpc/propertygetoperation.h"
 
-#if defined(QT_STATIC)
-Q_IMPORT_PLUGIN(ProtobufPlugin)
-#endif
-
 Q_LOGGING_CATEGORY(LOG_SESSION, "RPC")
 
+// Maximum number of independent requests awaiting a response at the same time
+static constexpr int DEFAULT_PIPELINE_DEPTH = 8;
+
+// Stop encoding new requests when this many bytes are waiting to be sent...
+static constexpr qint64 WRITE_HIGH_WATERMARK = 8 * 1024;
+// ...and resume when the transport has drained its buffer down to this level.
+// Kept low so that interactive requests do not wait long behind bulk data.
+static constexpr qint64 WRITE_LOW_WATERMARK = 2 * 1024;
+
+// Enough for the largest storage write chunk with some room for the header
+static constexpr int ENCODE_BUFFER_SIZE = Flipper::Zero::StorageWriteTuner::MAX_CHUNK_SIZE + 512;
+
 using namespace Flipper;
 using namespace Zero;
 
@@ -53,21 +59,24 @@ ProtobufSession::ProtobufSession(const QSerialPortInfo &portInfo, QObject *paren
     QObject(parent),
     m_sessionState(Stopped),
     m_portInfo(portInfo),
-    m_serialPort(nullptr),
-#if !defined(QT_STATIC)
-    m_loader(new QPluginLoader(this)),
-#endif
-    m_plugin(nullptr),
-    m_currentOperation(nullptr),
+    m_transportThread(new QThread(this)),
+    m_transport(nullptr),
     m_bytesToWrite(0),
+    m_plugin(nullptr),
+    m_pipelineDepth(DEFAULT_PIPELINE_DEPTH),
+    m_metrics(new RpcMetrics(this)),
     m_counter(0),
     m_versionMajor(0),
     m_versionMinor(0)
-{}
+{
+    m_transportThread->setObjectName(QStringLiteral("RPC transport"));
+}
 
 ProtobufSession::~ProtobufSession()
 {
-    stopSession();
+    // Cannot wait for doStopSession() here
+    stopTransport();
+    releaseProtobufPlugin();
 }
 
 ProtobufPluginInterface *ProtobufSession::pluginInstance() const
@@ -85,6 +94,16 @@ void ProtobufSession::setSerialPort(const QSerialPortInfo &portInfo)
     m_portInfo = portInfo;
 }
 
+void ProtobufSession::setLocalServer(const QString &serverName)
+{
+    m_serverName = serverName;
+}
+
+uint32_t ProtobufSession::versionMajor() const
+{
+    return m_versionMajor;
+}
+
 void ProtobufSession::setMajorVersion(int versionMajor)
 {
     m_versionMajor = versionMajor;
@@ -99,6 +118,79 @@ void ProtobufSession::setMinorVersion(int versionMinor)
     }
 }
 
+int ProtobufSession::pipelineDepth() const
+{
+    return m_pipelineDepth;
+}
+
+void ProtobufSession::setPipelineDepth(int depth)
+{
+    // Depth of 1 means strictly sequential operation
+    m_pipelineDepth = qMax(1, depth);
+}
+
+const StorageWriteParameters ProtobufSession::storageWriteParameters() const
+{
+    return m_writeTuner.parameters();
+}
+
+RpcMetrics *ProtobufSession::metrics() const
+{
+    return m_metrics;
+}
+
+bool ProtobufSession::adoptSession(ProtobufSession *other)
+{
+    if(m_sessionState != Stopped) {
+        qCWarning(LOG_SESSION) << "Cannot adopt a session while running";
+        return false;
+
+    } else if((other->m_sessionState != Idle) || !other->m_transport) {
+        qCWarning(LOG_SESSION) << "Only an idle session can be adopted";
+        return false;
+    }
+
+    other->m_transport->disconnect(other);
+
+    // The transport lives in its thread, so both move over together
+    qSwap(m_transportThread, other->m_transportThread);
+    m_transportThread->setParent(this);
+    other->m_transportThread->setParent(other);
+
+    m_transport = other->m_transport;
+    other->m_transport = nullptr;
+
+    // The plugin reference is handed over as well
+    m_plugin = other->m_plugin;
+    other->m_plugin = nullptr;
+
+    m_portInfo = other->m_portInfo;
+    m_serverName = other->m_serverName;
+    m_versionMajor = other->m_versionMajor;
+    m_versionMinor = other->m_versionMinor;
+    m_counter = other->m_counter;
+    m_bytesToWrite = other->m_bytesToWrite;
+
+    clearError();
+    m_writeQueue.clear();
+    m_writeTuner.reset();
+
+    connectTransport();
+
+    other->setSessionState(Stopped);
+
+    qCInfo(LOG_SESSION) << "RPC session adopted successfully.";
+
+    if(!isQueueEmpty()) {
+        setSessionState(Running);
+        QTimer::singleShot(0, this, &ProtobufSession::processQueue);
+    } else {
+        setSessionState(Idle);
+    }
+
+    return true;
+}
+
 SystemRebootOperation *ProtobufSession::rebootToOS()
 {
     return enqueueOperation(new SystemRebootOperation(getAndIncrementCounter(), SystemRebootOperation::RebootModeOS, this));
@@ -146,77 +238,77 @@ SystemProtobufVersionOperation *ProtobufSession::systemProtobufVersion()
 
 StorageListOperation *ProtobufSession::storageList(const QByteArray &path)
 {
-    return enqueueOperation(new StorageListOperation(getAndIncrementCounter(), path, this));
+    return enqueueOperation(new StorageListOperation(getAndIncrementCounter(), path, this), AbstractProtobufOperation::Bulk);
 }
 
 StorageInfoOperation *ProtobufSession::storageInfo(const QByteArray &path)
 {
-    return enqueueOperation(new StorageInfoOperation(getAndIncrementCounter(), path, this));
+    return enqueueOperation(new StorageInfoOperation(getAndIncrementCounter(), path, this), AbstractProtobufOperation::Bulk);
 }
 
 StorageStatOperation *ProtobufSession::storageStat(const QByteArray &path)
 {
-    return enqueueOperation(new StorageStatOperation(getAndIncrementCounter(), path, this));
+    return enqueueOperation(new StorageStatOperation(getAndIncrementCounter(), path, this), AbstractProtobufOperation::Bulk);
 }
 
 StorageMkdirOperation *ProtobufSession::storageMkdir(const QByteArray &path)
 {
-    return enqueueOperation(new StorageMkdirOperation(getAndIncrementCounter(), path, this));
+    return enqueueOperation(new StorageMkdirOperation(getAndIncrementCounter(), path, this), AbstractProtobufOperation::Bulk);
 }
 
 StorageRenameOperation *ProtobufSession::storageRename(const QByteArray &oldPath, const QByteArray &newPath)
 {
-    return enqueueOperation(new StorageRenameOperation(getAndIncrementCounter(), oldPath, newPath, this));
+    return enqueueOperation(new StorageRenameOperation(getAndIncrementCounter(), oldPath, newPath, this), AbstractProtobufOperation::Bulk);
 }
 
 StorageRemoveOperation *ProtobufSession::storageRemove(const QByteArray &path, bool recursive)
 {
-    return enqueueOperation(new StorageRemoveOperation(getAndIncrementCounter(), path, recursive, this));
+    return enqueueOperation(new StorageRemoveOperation(getAndIncrementCounter(), path, recursive, this), AbstractProtobufOperation::Bulk);
 }
 
 StorageReadOperation *ProtobufSession::storageRead(const QByteArray &path, QIODevice *file)
 {
-    return enqueueOperation(new StorageReadOperation(getAndIncrementCounter(), path, file, this));
+    return enqueueOperation(new StorageReadOperation(getAndIncrementCounter(), path, file, this), AbstractProtobufOperation::Bulk);
 }
 
 StorageWriteOperation *ProtobufSession::storageWrite(const QByteArray &path, QIODevice *file)
 {
-    return enqueueOperation(new StorageWriteOperation(getAndIncrementCounter(), path, file, this));
+    return enqueueOperation(new StorageWriteOperation(getAndIncrementCounter(), path, file, &m_writeTuner, this), AbstractProtobufOperation::Bulk);
 }
 
 StorageMd5SumOperation *ProtobufSession::storageMd5Sum(const QByteArray &path)
 {
-    return enqueueOperation(new StorageMd5SumOperation(getAndIncrementCounter(), path, this));
+    return enqueueOperation(new StorageMd5SumOperation(getAndIncrementCounter(), path, this), AbstractProtobufOperation::Bulk);
 }
 
 GuiStartScreenStreamOperation *ProtobufSession::guiStartScreenStream()
 {
-    return enqueueOperation(new GuiStartScreenStreamOperation(getAndIncrementCounter(), this));
+    return enqueueOperation(new GuiStartScreenStreamOperation(getAndIncrementCounter(), this), AbstractProtobufOperation::Interactive);
 }
 
 GuiStopScreenStreamOperation *ProtobufSession::guiStopScreenStream()
 {
-    return enqueueOperation(new GuiStopScreenStreamOperation(getAndIncrementCounter(), this));
+    return enqueueOperation(new GuiStopScreenStreamOperation(getAndIncrementCounter(), this), AbstractProtobufOperation::Interactive);
 }
 
 GuiStartVirtualDisplayOperation *ProtobufSession::guiStartVirtualDisplay(const QByteArray &screenData)
 {
-    return enqueueOperation(new GuiStartVirtualDisplayOperation(getAndIncrementCounter(), screenData, this));
+    return enqueueOperation(new GuiStartVirtualDisplayOperation(getAndIncrementCounter(), screenData, this), AbstractProtobufOperation::Interactive);
 }
 
 GuiStopVirtualDisplayOperation *ProtobufSession::guiStopVirtualDisplay()
 {
-    return enqueueOperation(new GuiStopVirtualDisplayOperation(getAndIncrementCounter(), this));
+    return enqueueOperation(new GuiStopVirtualDisplayOperation(getAndIncrementCounter(), this), AbstractProtobufOperation::Interactive);
 }
 
 GuiSendInputOperation *ProtobufSession::guiSendInput(int key, int type)
 {
-    return enqueueOperation(new GuiSendInputOperation(getAndIncrementCounter(), key, type, this));
+    return enqueueOperation(new GuiSendInputOperation(getAndIncrementCounter(), key, type, this), AbstractProtobufOperation::Interactive);
 }
 
 GuiScreenFrameOperation *ProtobufSession::guiSendScreenFrame(const QByteArray &screenData)
 {
-    return enqueueOperation(new GuiScreenFrameOperation(getAndIncrementCounter(), screenData, this));
+    return enqueueOperation(new GuiScreenFrameOperation(getAndIncrementCounter(), screenData, this), AbstractProtobufOperation::Interactive);
 }
 
 PropertyGetOperation *ProtobufSession::propertyGet(const QByteArray &key)
@@ -232,41 +324,19 @@ void ProtobufSession::startSession()
     }
 
     clearError();
-    m_receivedData.clear();
+    m_writeQueue.clear();
+    m_bytesToWrite = 0;
+    m_writeTuner.reset();
 
     qCInfo(LOG_SESSION) << "Starting RPC session...";
     setSessionState(Starting);
 
-    if(!loadProtobufPlugin()) {
+    if(!acquireProtobufPlugin()) {
         stopEarly(BackendError::UnknownError, QStringLiteral("Suitable protocol plugin is not available"));
         return;
     }
 
-    auto *helper = new SerialInitHelper(m_portInfo, this);
-    connect(helper, &SerialInitHelper::finished, this, [=]() {
-        helper->deleteLater();
-
-        if(helper->isError()) {
-            qCCritical(LOG_SESSION).noquote() << "Failed to start RPC session:" << helper->errorString();
-            stopEarly(helper->error(), helper->errorString());
-            return;
-        }
-
-        m_serialPort = helper->serialPort();
-
-        connect(m_serialPort, &QSerialPort::readyRead, this, &ProtobufSession::onSerialPortReadyRead);
-        connect(m_serialPort, &QSerialPort::bytesWritten, this, &ProtobufSession::onSerialPortBytesWriten);
-        connect(m_serialPort, &QSerialPort::errorOccurred, this, &ProtobufSession::onSerialPortErrorOccured);
-
-        qCInfo(LOG_SESSION) << "RPC session started successfully.";
-
-        if(!m_queue.isEmpty()) {
-            setSessionState(Running);
-            QTimer::singleShot(0, this, &ProtobufSession::processQueue);
-        } else {
-            setSessionState(Idle);
-        }
-    });
+    startTransport();
 }
 
 void ProtobufSession::stopSession()
@@ -279,151 +349,248 @@ void ProtobufSession::stopSession()
     QTimer::singleShot(0, this, &ProtobufSession::doStopSession);
 }
 
-void ProtobufSession::onSerialPortReadyRead()
+void ProtobufSession::onTransportOpened()
 {
-    if(!isSessionUp()) {
-        m_serialPort->clear();
-        return;
-#if !defined(QT_STATIC)
-    } else if(!m_loader->isLoaded()) {
-        // For some weird reason the plugin can be unloaded by connecting
-        // multiple devices (although the docs say it shouldn't)
-        loadProtobufPlugin();
-#endif
+    qCInfo(LOG_SESSION) << "RPC session started successfully.";
+
+    if(!isQueueEmpty()) {
+        setSessionState(Running);
+        QTimer::singleShot(0, this, &ProtobufSession::processQueue);
+    } else {
+        setSessionState(Idle);
     }
+}
 
-    m_receivedData.append(m_serialPort->readAll());
-    auto *response = m_plugin->decode(m_receivedData, this);
+void ProtobufSession::onTransportErrorOccured(BackendError::ErrorType error, const QString &errorString)
+{
+    if(m_sessionState == Starting) {
+        qCCritical(LOG_SESSION).noquote() << "Failed to start RPC session:" << errorString;
+        stopTransport();
+        releaseProtobufPlugin();
+        stopEarly(error, errorString);
 
-    if(!response) {
+    } else if(isSessionUp()) {
+        qCCritical(LOG_SESSION).noquote() << "Transport error:" << errorString;
+        setError(error, errorString);
+        stopSession();
+    }
+}
+
+void ProtobufSession::onTransportConnectionLost()
+{
+    stopSession();
+}
+
+void ProtobufSession::onTransportBytesWritten(qint64 nbytes)
+{
+    m_bytesToWrite = qMax<qint64>(0, m_bytesToWrite - nbytes);
+
+    if(!isSessionUp() || m_writeQueue.isEmpty()) {
+        return;
+    } else if(m_bytesToWrite <= WRITE_LOW_WATERMARK) {
+        processWriteQueue();
+    }
+}
+
+void ProtobufSession::onResponseReceived(QObject *response, qint64 frameSize, qint64 decodeTime)
+{
+    // Responses are decoded in the transport thread and arrive here one by one
+    if(!isSessionUp()) {
+        releaseResponse(response);
         return;
     }
 
     auto *mainResponse = qobject_cast<MainResponseInterface*>(response);
-    m_receivedData.remove(0, (int)mainResponse->encodedSize());
+    auto *operation = m_inFlight.value(mainResponse->id());
 
-    if(m_currentOperation && mainResponse->id() == m_currentOperation->id()) {
-        processMatchedResponse(response);
+    if(operation) {
+        m_metrics->responseReceived(operation->id(), frameSize, decodeTime);
+        processMatchedResponse(operation, response);
     } else if(mainResponse->id() == 0) {
         processBroadcastResponse(response);
     } else {
         processUnmatchedResponse(response);
     }
 
-    response->deleteLater();
-
-    if(!m_receivedData.isEmpty()) {
-        // m_receivedData can contain more than 1 full message
-        QTimer::singleShot(0, this, &ProtobufSession::onSerialPortReadyRead);
-    }
+    // Nobody is supposed to keep the response past this point
+    releaseResponse(response);
 }
 
-void ProtobufSession::onSerialPortBytesWriten(qint64 nbytes)
+void ProtobufSession::processQueue()
 {
-    Q_UNUSED(nbytes)
-}
+    if(!isSessionUp()) {
+        return;
+    }
 
-void ProtobufSession::onSerialPortErrorOccured()
-{
-    qCInfo(LOG_SESSION) << "Serial connection was lost.";
+    // Go through the lanes by priority, a lower priority lane only gets its turn
+    // when everything in the lanes above it has been started
+    for(auto &queue : m_queues) {
+        while(!queue.isEmpty() && canStartOperation(queue.head())) {
+            auto *operation = queue.dequeue();
+            m_inFlight.insert(operation->id(), operation);
+            m_metrics->operationStarted(operation);
 
-    disconnect(m_serialPort, &QSerialPort::readyRead, this, &ProtobufSession::onSerialPortReadyRead);
-    disconnect(m_serialPort, &QSerialPort::bytesWritten, this, &ProtobufSession::onSerialPortBytesWriten);
-    disconnect(m_serialPort, &QSerialPort::errorOccurred, this, &ProtobufSession::onSerialPortErrorOccured);
+            qCInfo(LOG_SESSION).noquote() << prettyOperationDescription(operation) << "START";
 
-    stopSession();
+            connect(operation, &AbstractOperation::finished, this, &ProtobufSession::onOperationFinished);
+            operation->start();
+
+            if(operation->isError()) {
+                continue;
+            } else if(operation->dataSink()) {
+                addDataSink(operation);
+            }
+
+            if(!writeToPort(operation)) {
+                return;
+            }
+        }
+
+        if(!queue.isEmpty()) {
+            break;
+        }
+    }
+
+    if(isQueueEmpty() && m_inFlight.isEmpty()) {
+        setSessionState(Idle);
+    }
 }
 
-void ProtobufSession::processQueue()
+bool ProtobufSession::canStartOperation(AbstractProtobufOperation *operation) const
 {
-    if(m_queue.isEmpty()) {
-        setSessionState(Idle);
-        return;
+    if(m_inFlight.isEmpty()) {
+        return true;
+    } else if(m_inFlight.size() >= m_pipelineDepth) {
+        return false;
+    } else if(operation->priority() == AbstractProtobufOperation::Interactive) {
+        // Gui requests do not interfere with the device state of other requests,
+        // so they are allowed to go in between the chunks of bulk operations
+        return true;
+    } else if(!operation->isPipelinable()) {
+        return false;
     }
 
-    m_currentOperation = m_queue.dequeue();
-    qCInfo(LOG_SESSION).noquote() << prettyOperationDescription() << "START";
+    // Only share the link with operations that allow it as well
+    return std::all_of(m_inFlight.cbegin(), m_inFlight.cend(), [](AbstractProtobufOperation *op) {
+        return op->isPipelinable() || op->priority() == AbstractProtobufOperation::Interactive;
+    });
+}
 
-    connect(m_currentOperation, &AbstractOperation::finished, this, &ProtobufSession::onCurrentOperationFinished);
-    m_currentOperation->start();
+bool ProtobufSession::writeToPort(AbstractProtobufOperation *operation)
+{
+    // Higher priority operations jump ahead of the ones with data still to be sent
+    const auto it = std::find_if(m_writeQueue.begin(), m_writeQueue.end(), [operation](AbstractProtobufOperation *op) {
+        return op->priority() > operation->priority();
+    });
 
-    if(!m_currentOperation->isError()) {
-        writeToPort();
-    }
+    m_writeQueue.insert(it, operation);
+    return processWriteQueue();
 }
 
-void ProtobufSession::writeToPort()
+bool ProtobufSession::processWriteQueue()
 {
-    if(!m_currentOperation || !m_plugin) {
-        return;
-#if !defined(QT_STATIC)
-    } else if(!m_loader->isLoaded()) {
-        // For some weird reason the plugin can be unloaded by connecting
-        // multiple devices (although the docs say it shouldn't)
-        loadProtobufPlugin();
-#endif
+    if(!m_plugin || !m_transport) {
+        return false;
     }
 
-    bool success;
+    while(!m_writeQueue.isEmpty()) {
+        // Multi-part operations yield after each request, so that anything
+        // with higher priority put into the queue meanwhile goes out first
+        auto *operation = m_writeQueue.head();
 
-    do {
-        const auto &buf = m_currentOperation->encodeRequest(m_plugin);
-        const auto bytesWritten = m_serialPort->write(buf);
+        if(operation->priority() != AbstractProtobufOperation::Interactive &&
+           m_bytesToWrite >= WRITE_HIGH_WATERMARK) {
+            // Wait for onTransportBytesWritten() to resume writing
+            break;
+        }
 
-        success = bytesWritten >= 0;
+        auto &buf = encodeBuffer();
 
-        if(!success) {
-            break;
-        } else if(bytesWritten != buf.size()) {
-            // TODO: Check for full system serial buffer
-            qCCritical(LOG_SESSION) << "Serial buffer overflow";
-            break;
+        if(!operation->encodeRequest(m_plugin, buf)) {
+            m_writeQueue.dequeue();
+            operation->abort(QStringLiteral("Failed to encode request"));
+            continue;
+
+        } else if(!operation->hasMoreData()) {
+            m_writeQueue.dequeue();
         }
 
-    } while(m_currentOperation->hasMoreData());
+        // Write errors are reported back asynchronously by the transport
+        m_bytesToWrite += buf.size();
+        m_metrics->requestSent(operation->id(), buf.size());
+        QMetaObject::invokeMethod(m_transport, "write", Qt::QueuedConnection, Q_ARG(QByteArray, buf));
+    }
 
-    success &= m_serialPort->flush();
+    return true;
+}
 
-    if(!success) {
-        setError(BackendError::SerialError, m_serialPort->errorString());
-        stopSession();
-        return;
+QByteArray &ProtobufSession::encodeBuffer()
+{
+    // A buffer can be reused as soon as the transport has let go of its copy,
+    // so only a handful of them are ever allocated during the session
+    for(auto &buf : m_encodeBuffers) {
+        if(buf.isDetached() || buf.isEmpty()) {
+            return buf;
+        }
     }
+
+    m_encodeBuffers.append(QByteArray());
+
+    auto &buf = m_encodeBuffers.last();
+    buf.reserve(ENCODE_BUFFER_SIZE);
+
+    return buf;
 }
 
 void ProtobufSession::doStopSession()
 {
     qCInfo(LOG_SESSION) << "Stopping RPC session...";
 
-    if(m_currentOperation) {
-        m_currentOperation->abort(QStringLiteral("RPC session was stopped with operations still running"));
-    }
+    // abort() removes the operation from m_inFlight, so iterate over a copy
+    const auto inFlight = m_inFlight.values();
 
-    if(m_serialPort) {
-        m_serialPort->close();
-        m_serialPort->deleteLater();
+    for(auto *operation : inFlight) {
+        operation->abort(QStringLiteral("RPC session was stopped with operations still running"));
     }
 
-    unloadProtobufPlugin();
+    stopTransport();
+    releaseProtobufPlugin();
+
+    m_encodeBuffers.clear();
 
     qCInfo(LOG_SESSION) << "RPC session stopped successfully.";
 
     setSessionState(Stopped);
 }
 
-void ProtobufSession::onCurrentOperationFinished()
+void ProtobufSession::onOperationFinished()
 {
-    if(m_currentOperation->isError()) {
-        qCCritical(LOG_SESSION).noquote() << prettyOperationDescription() << "ERROR:" << m_currentOperation->errorString();
+    auto *operation = qobject_cast<AbstractProtobufOperation*>(sender());
+
+    if(!operation || !m_inFlight.remove(operation->id())) {
+        return;
+    }
+
+    // Do not encode any more requests for a finished operation
+    m_writeQueue.removeOne(operation);
 
-        clearOperationQueue();
+    if(operation->dataSink()) {
+        removeDataSink(operation);
+    }
+
+    m_metrics->operationFinished(operation);
+
+    if(operation->isError()) {
+        qCCritical(LOG_SESSION).noquote() << prettyOperationDescription(operation) << "ERROR:" << operation->errorString();
+
+        // Operations already on the wire will be finished normally
+        clearOperationQueue(operation->priority());
 
     } else {
-        qCInfo(LOG_SESSION).noquote() << prettyOperationDescription() << "SUCCESS";
+        qCInfo(LOG_SESSION).noquote() << prettyOperationDescription(operation) << "SUCCESS";
     }
 
-    m_currentOperation->deleteLater();
-    m_currentOperation = nullptr;
+    operation->deleteLater();
 
     QTimer::singleShot(0, this, &ProtobufSession::processQueue);
 }
@@ -438,117 +605,106 @@ void ProtobufSession::setSessionState(SessionState newState)
     emit sessionStateChanged();
 }
 
-#if !defined(QT_STATIC)
-const QString ProtobufSession::protobufPluginFileName(uint32_t versionMajor)
+bool ProtobufSession::acquireProtobufPlugin()
 {
-#if defined(Q_OS_WINDOWS)
-    return QStringLiteral("flipperproto%1.dll").arg(versionMajor);
-#elif defined(Q_OS_MAC)
-    return QStringLiteral("libflipperproto%1.dylib").arg(versionMajor);
-#elif defined(Q_OS_LINUX)
-    return QStringLiteral("libflipperproto%1.so").arg(versionMajor);
-#else
-#error "Unsupported OS"
-#endif
+    QString errorString;
+    m_plugin = globalProtobufPlugins->acquire(m_versionMajor, &errorString);
+
+    if(!m_plugin) {
+        qCCritical(LOG_SESSION).noquote() << errorString;
+        return false;
+    }
+
+    // The plugin instance is shared between all sessions using the same major version
+    m_plugin->setMinorVersion(m_versionMinor);
+    return true;
 }
-#endif
 
-QVector<uint32_t> ProtobufSession::supportedProtobufVersions()
+void ProtobufSession::releaseProtobufPlugin()
 {
-    QVector<uint32_t> ret;
+    globalProtobufPlugins->release(m_plugin);
+    m_plugin = nullptr;
+}
 
-#if defined(QT_STATIC)
-    const auto staticInstances = QPluginLoader::staticInstances();
+void ProtobufSession::stopEarly(BackendError::ErrorType error, const QString &errorString)
+{
+    setError(error, errorString);
+    setSessionState(Stopped);
+}
 
-    for(const auto *instance: staticInstances) {
-        if(const auto *protobufPlugin = qobject_cast<const ProtobufPluginInterface*>(instance)) {
-            ret.append(protobufPlugin->versionMajor());
-        }
+void ProtobufSession::startTransport()
+{
+    // Serial I/O and response decoding happen in a separate thread so that
+    // a busy GUI thread does not stall the link and vice versa
+    if(m_serverName.isEmpty()) {
+        m_transport = new SerialTransport(m_portInfo, m_plugin);
+    } else {
+        m_transport = new LocalSocketTransport(m_serverName, m_plugin);
     }
 
-    std::sort(ret.begin(), ret.end());
-#else
-    const auto libraryPaths = QCoreApplication::libraryPaths();
+    m_transport->moveToThread(m_transportThread);
 
-    for(uint32_t i = 0;; ++i) {
-        for(const auto &path : libraryPaths) {
-            const QDir libraryDir(path);
+    connect(m_transportThread, &QThread::finished, m_transport, &QObject::deleteLater);
 
-            if(libraryDir.exists(protobufPluginFileName(i))) {
-                ret.append(i);
-                break;
-            }
-        }
+    connectTransport();
 
-        if(!ret.contains(i)) {
-            break;
-        }
-    }
-#endif
-    return ret;
+    m_transportThread->start();
+    QMetaObject::invokeMethod(m_transport, "open", Qt::QueuedConnection);
 }
 
-bool ProtobufSession::loadProtobufPlugin()
+void ProtobufSession::stopTransport()
 {
-    const auto supportedVersions = supportedProtobufVersions();
-
-    if(supportedVersions.isEmpty()) {
-        qCCritical(LOG_SESSION) << "Cannot find protobuf support plugins";
-        return false;
-    } else if(!supportedVersions.contains(m_versionMajor)) {
-        qCCritical(LOG_SESSION).noquote() << "Protocol version" << m_versionMajor
-                                          << "is not supported yet. Please update the application.";
-        return false;
+    if(!m_transport) {
+        return;
     }
 
-#if defined(QT_STATIC)
-    const auto staticInstances = QPluginLoader::staticInstances();
+    m_transport->disconnect(this);
+    QMetaObject::invokeMethod(m_transport, "close", Qt::BlockingQueuedConnection);
 
-    for(auto *instance : staticInstances) {
-        if(auto *protobufPlugin = qobject_cast<ProtobufPluginInterface*>(instance)) {
-            if(protobufPlugin->versionMajor() == m_versionMajor) {
-                m_plugin = protobufPlugin;
-                break;
-            }
-        }
-    }
-#else
-    m_loader->setFileName(protobufPluginFileName(m_versionMajor));
-    m_plugin = qobject_cast<ProtobufPluginInterface*>(m_loader->instance());
+    m_transportThread->quit();
+    m_transportThread->wait();
 
-    if(!m_plugin) {
-        qCCritical(LOG_SESSION) << "Failed to load protobuf plugin:" << m_loader->errorString();
-        return false;
-    }
-#endif
-
-    m_plugin->setMinorVersion(m_versionMinor);
-    return true;
+    m_transport = nullptr;
 }
 
-void ProtobufSession::unloadProtobufPlugin()
+void ProtobufSession::connectTransport()
 {
-    m_plugin = nullptr;
+    connect(m_transport, &ProtobufTransport::opened, this, &ProtobufSession::onTransportOpened);
+    connect(m_transport, &ProtobufTransport::errorOccured, this, &ProtobufSession::onTransportErrorOccured);
+    connect(m_transport, &ProtobufTransport::connectionLost, this, &ProtobufSession::onTransportConnectionLost);
+    connect(m_transport, &ProtobufTransport::bytesWritten, this, &ProtobufSession::onTransportBytesWritten);
+    connect(m_transport, &ProtobufTransport::responseReceived, this, &ProtobufSession::onResponseReceived);
+}
 
-#if defined(QT_SHARED)
-    if(!m_loader->isLoaded()) {
+void ProtobufSession::addDataSink(AbstractProtobufOperation *operation)
+{
+    if(!m_transport) {
         return;
     }
 
-    qCDebug(LOG_SESSION) << "Attempting to unload protobuf plugin...";
+    auto *transport = m_transport;
+    const auto id = operation->id();
+    auto *sink = operation->dataSink();
 
-    if(!m_loader->unload()) {
-        qCDebug(LOG_SESSION) << "Cannot unload protobuf plugin. This is probably OK.";
-    } else {
-        qCDebug(LOG_SESSION) << "Unloaded protobuf plugin.";
-    }
-#endif
+    // Queued before the request itself, so the sink is in place when the response arrives
+    QMetaObject::invokeMethod(m_transport, [=]() {
+        transport->addDataSink(id, sink);
+    }, Qt::QueuedConnection);
 }
 
-void ProtobufSession::stopEarly(BackendError::ErrorType error, const QString &errorString)
+void ProtobufSession::removeDataSink(AbstractProtobufOperation *operation)
 {
-    setError(error, errorString);
-    setSessionState(Stopped);
+    if(!m_transport) {
+        return;
+    }
+
+    auto *transport = m_transport;
+    const auto id = operation->id();
+
+    // Blocking, as the device can be closed or destroyed right after the operation has finished
+    QMetaObject::invokeMethod(m_transport, [=]() {
+        transport->removeDataSink(id);
+    }, Qt::BlockingQueuedConnection);
 }
 
 uint32_t ProtobufSession::getAndIncrementCounter()
@@ -561,21 +717,41 @@ uint32_t ProtobufSession::getAndIncrementCounter()
     return m_counter;
 }
 
-void ProtobufSession::clearOperationQueue()
+void ProtobufSession::clearOperationQueue(AbstractProtobufOperation::Priority priority)
 {
-    while(!m_queue.isEmpty()) {
-        m_queue.dequeue()->deleteLater();
+    auto &queue = m_queues[priority];
+
+    while(!queue.isEmpty()) {
+        auto *operation = queue.dequeue();
+        m_metrics->operationDropped(operation);
+        operation->deleteLater();
     }
 }
 
-const QString ProtobufSession::prettyOperationDescription() const
+bool ProtobufSession::isQueueEmpty() const
 {
-    return QStringLiteral("(%1) %2").arg(m_currentOperation->id()).arg(m_currentOperation->description());
+    return std::all_of(std::begin(m_queues), std::end(m_queues), [](const QQueue<AbstractProtobufOperation*> &queue) {
+        return queue.isEmpty();
+    });
+}
+
+const QString ProtobufSession::prettyOperationDescription(AbstractProtobufOperation *operation)
+{
+    return QStringLiteral("(%1) %2").arg(operation->id()).arg(operation->description());
+}
+
+void ProtobufSession::releaseResponse(QObject *response)
+{
+    if(m_plugin) {
+        m_plugin->release(response);
+    } else {
+        delete response;
+    }
 }
 
-void ProtobufSession::processMatchedResponse(QObject *response)
+void ProtobufSession::processMatchedResponse(AbstractProtobufOperation *operation, QObject *response)
 {
-    m_currentOperation->feedResponse(response);
+    operation->feedResponse(response);
 }
 
 void ProtobufSession::processBroadcastResponse(QObject *response)
@@ -596,13 +772,19 @@ void ProtobufSession::processErrorResponse(QObject *response)
 }
 
 template<class T>
-T *ProtobufSession::enqueueOperation(T *operation)
+T *ProtobufSession::enqueueOperation(T *operation, AbstractProtobufOperation::Priority priority)
 {
-    m_queue.enqueue(operation);
+    operation->setPriority(priority);
+    m_queues[priority].enqueue(operation);
+    m_metrics->operationQueued(operation);
 
     if(m_sessionState == Idle) {
         QTimer::singleShot(0, this, &ProtobufSession::processQueue);
         setSessionState(Running);
+
+    } else if(m_sessionState == Running && m_inFlight.size() < m_pipelineDepth) {
+        // There might be room for this operation in the pipeline
+        QTimer::singleShot(0, this, &ProtobufSession::processQueue);
     }
 
     return operation;
@@ -1,20 +1,23 @@
 #pragma once
 
+#include <QHash>
 #include <QQueue>
+#include <QVector>
 #include <QObject>
 #include <QSerialPortInfo>
 
 #include "failable.h"
+#include "rpcmetrics.h"
+#include "rpc/abstractprotobufoperation.h"
+#include "storagewritetuner.h"
 
+class QThread;
 class QIODevice;
-class QPluginLoader;
 class ProtobufPluginInterface;
 
 namespace Flipper {
 namespace Zero {
 
-class AbstractProtobufOperation;
-
 class SystemRebootOperation;
 class SystemDeviceInfoOperation;
 class SystemGetDateTimeOperation;
@@ -42,9 +45,12 @@ class GuiStopVirtualDisplayOperation;
 
 class PropertyGetOperation;
 
+class ProtobufTransport;
+
 class ProtobufSession : public QObject, public Failable
 {
     Q_OBJECT
+    Q_PROPERTY(QAbstractListModel* metrics READ metrics CONSTANT)
 
 public:
     enum SessionState {
@@ -62,10 +68,24 @@ public:
     bool isSessionUp() const;
 
     void setSerialPort(const QSerialPortInfo &portInfo);
+    // Connect to a local server (e.g. the emulator) instead of the serial port
+    void setLocalServer(const QString &serverName);
 
+    uint32_t versionMajor() const;
     void setMajorVersion(int versionMajor);
     void setMinorVersion(int versionMinor);
 
+    int pipelineDepth() const;
+    void setPipelineDepth(int depth);
+
+    const StorageWriteParameters storageWriteParameters() const;
+
+    RpcMetrics *metrics() const;
+
+    // Takes over the connection of another idle session, leaving it stopped.
+    // Only possible while this session is stopped.
+    bool adoptSession(ProtobufSession *other);
+
     // Operations
     SystemRebootOperation *rebootToOS();
     SystemRebootOperation *rebootToRecovery();
@@ -105,55 +125,70 @@ public slots:
     void stopSession();
 
 private slots:
-    void onSerialPortReadyRead();
-    void onSerialPortBytesWriten(qint64 nbytes);
-    void onSerialPortErrorOccured();
+    void onTransportOpened();
+    void onTransportErrorOccured(BackendError::ErrorType error, const QString &errorString);
+    void onTransportConnectionLost();
+    void onTransportBytesWritten(qint64 nbytes);
+    void onResponseReceived(QObject *response, qint64 frameSize, qint64 decodeTime);
 
     void processQueue();
-    void writeToPort();
     void doStopSession();
 
-    void onCurrentOperationFinished();
+    void onOperationFinished();
 
 private:
-#if !defined(QT_STATIC)
-    static const QString protobufPluginFileName(uint32_t versionMajor);
-#endif
-    static QVector<uint32_t> supportedProtobufVersions();
-
     void setSessionState(SessionState newState);
 
-    bool loadProtobufPlugin();
-    void unloadProtobufPlugin();
+    bool acquireProtobufPlugin();
+    void releaseProtobufPlugin();
 
     void stopEarly(BackendError::ErrorType error, const QString &errorString);
 
-    const QString prettyOperationDescription() const;
+    void startTransport();
+    void stopTransport();
+    void connectTransport();
+
+    void addDataSink(AbstractProtobufOperation *operation);
+    void removeDataSink(AbstractProtobufOperation *operation);
+
+    static const QString prettyOperationDescription(AbstractProtobufOperation *operation);
+
+    bool canStartOperation(AbstractProtobufOperation *operation) const;
+    bool writeToPort(AbstractProtobufOperation *operation);
+    bool processWriteQueue();
+    QByteArray &encodeBuffer();
 
     uint32_t getAndIncrementCounter();
 
     template<class T>
-    T* enqueueOperation(T *operation);
-    void clearOperationQueue();
+    T* enqueueOperation(T *operation, AbstractProtobufOperation::Priority priority = AbstractProtobufOperation::Control);
+    void clearOperationQueue(AbstractProtobufOperation::Priority priority);
+    bool isQueueEmpty() const;
 
-    void processMatchedResponse(QObject *response);
+    void releaseResponse(QObject *response);
+    void processMatchedResponse(AbstractProtobufOperation *operation, QObject *response);
     void processBroadcastResponse(QObject *response);
     void processUnmatchedResponse(QObject *response);
     void processErrorResponse(QObject *response);
 
     SessionState m_sessionState;
     QSerialPortInfo m_portInfo;
-    QSerialPort *m_serialPort;
-    QByteArray m_receivedData;
+    QString m_serverName;
+
+    QThread *m_transportThread;
+    ProtobufTransport *m_transport;
+    qint64 m_bytesToWrite;
+    QVector<QByteArray> m_encodeBuffers;
 
-#if !defined(QT_STATIC)
-    QPluginLoader *m_loader;
-#endif
     ProtobufPluginInterface *m_plugin;
-    QQueue<AbstractProtobufOperation*> m_queue;
-    AbstractProtobufOperation *m_currentOperation;
+    QQueue<AbstractProtobufOperation*> m_queues[AbstractProtobufOperation::PriorityCount];
+    QHash<uint32_t, AbstractProtobufOperation*> m_inFlight;
+    QQueue<AbstractProtobufOperation*> m_writeQueue;
+    int m_pipelineDepth;
+
+    StorageWriteTuner m_writeTuner;
+    RpcMetrics *m_metrics;
 
-    qint64 m_bytesToWrite;
     uint32_t m_counter;
     uint32_t m_versionMajor;
     uint32_t m_versionMinor;
@@ -0,0 +1,105 @@
+#include "protobuftransport.h"
+
+#include <QIODevice>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+
+#include "protobufplugininterface.h"
+
+Q_DECLARE_LOGGING_CATEGORY(LOG_SESSION)
+
+using namespace Flipper;
+using namespace Zero;
+
+ProtobufTransport::ProtobufTransport(ProtobufPluginInterface *plugin, QObject *parent):
+    QObject(parent),
+    m_plugin(plugin),
+    m_device(nullptr)
+{
+    qRegisterMetaType<BackendError::ErrorType>();
+}
+
+void ProtobufTransport::close()
+{
+    if(!m_device) {
+        return;
+    }
+
+    m_device->disconnect(this);
+    m_device->close();
+    m_device->deleteLater();
+    m_device = nullptr;
+}
+
+void ProtobufTransport::write(const QByteArray &data)
+{
+    if(!m_device) {
+        return;
+    }
+
+    const auto bytesWritten = m_device->write(data);
+
+    if(bytesWritten != data.size()) {
+        emit errorOccured(BackendError::SerialError, QStringLiteral("Failed to write to device: %1").arg(m_device->errorString()));
+    } else if(!flush()) {
+        emit errorOccured(BackendError::SerialError, m_device->errorString());
+    }
+}
+
+void ProtobufTransport::addDataSink(uint32_t id, QIODevice *sink)
+{
+    m_dataSinks.insert(id, sink);
+}
+
+void ProtobufTransport::removeDataSink(uint32_t id)
+{
+    m_dataSinks.remove(id);
+}
+
+QIODevice *ProtobufTransport::device() const
+{
+    return m_device;
+}
+
+void ProtobufTransport::setDevice(QIODevice *device)
+{
+    m_device = device;
+    m_receivedData.clear();
+
+    connect(m_device, &QIODevice::readyRead, this, &ProtobufTransport::onDeviceReadyRead);
+    connect(m_device, &QIODevice::bytesWritten, this, &ProtobufTransport::bytesWritten);
+}
+
+void ProtobufTransport::onDeviceReadyRead()
+{
+    m_receivedData.append(m_device);
+
+    // Drain every complete message at once instead of rescheduling for each of them
+    QElapsedTimer decodeTimer;
+
+    while(m_receivedData.hasCompleteFrame()) {
+        const auto frameSize = m_receivedData.nextFrameSize();
+
+        decodeTimer.start();
+        auto *response = m_dataSinks.isEmpty() ? m_plugin->decode(m_receivedData.data()) :
+                                                 m_plugin->decode(m_receivedData.data(), m_dataSinks);
+        const auto decodeTime = decodeTimer.nsecsElapsed() / 1000;
+
+        m_receivedData.consume(frameSize);
+
+        if(!response) {
+            qCWarning(LOG_SESSION) << "Failed to decode message of" << frameSize << "bytes, skipping";
+            continue;
+        }
+
+        // Responses have no parent and are never used with signals or events, so they
+        // need no thread affinity. The session hands them back to the plugin when done.
+        emit responseReceived(response, frameSize, decodeTime);
+    }
+
+    if(m_receivedData.hasInvalidFrame()) {
+        // There is no telling where the next frame starts, so give up on the stream
+        m_receivedData.clear();
+        emit errorOccured(BackendError::ProtocolError, QStringLiteral("Received a malformed frame size prefix"));
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+
+#include "backenderror.h"
+#include "receivebuffer.h"
+
+class QIODevice;
+class ProtobufPluginInterface;
+
+namespace Flipper {
+namespace Zero {
+
+// Lives in the session's transport thread, owns the connection to the device
+// and turns the incoming byte stream into decoded responses
+class ProtobufTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    ProtobufTransport(ProtobufPluginInterface *plugin, QObject *parent = nullptr);
+    virtual ~ProtobufTransport() {}
+
+public slots:
+    virtual void open() = 0;
+    virtual void close();
+    void write(const QByteArray &data);
+
+    // Storage read data for the given id goes straight to the device, bypassing the response
+    void addDataSink(uint32_t id, QIODevice *sink);
+    void removeDataSink(uint32_t id);
+
+signals:
+    void opened();
+    void errorOccured(BackendError::ErrorType error, const QString &errorString);
+    void connectionLost();
+    // Size of the encoded message in bytes and time it took to decode in microseconds
+    void responseReceived(QObject *response, qint64 frameSize, qint64 decodeTime);
+    void bytesWritten(qint64 nbytes);
+
+protected:
+    QIODevice *device() const;
+    void setDevice(QIODevice *device);
+
+    virtual bool flush() = 0;
+
+private slots:
+    void onDeviceReadyRead();
+
+private:
+    ProtobufPluginInterface *m_plugin;
+    QIODevice *m_device;
+    ReceiveBuffer m_receivedData;
+    QHash<uint32_t, QIODevice*> m_dataSinks;
+};
+
+}
+}
+
@@ -0,0 +1,124 @@
+#include "receivebuffer.h"
+
+#include <QIODevice>
+
+static constexpr int INITIAL_CAPACITY = 16 * 1024;
+static constexpr int VARINT_MAX_SIZE = 10;
+// Far above anything the firmware sends, a bigger frame means the stream is out of sync
+static constexpr qint64 MAX_FRAME_SIZE = 1024 * 1024;
+static constexpr qint64 INVALID_FRAME_SIZE = -2;
+
+using namespace Flipper;
+using namespace Zero;
+
+ReceiveBuffer::ReceiveBuffer():
+    m_readPos(0)
+{
+    // Reserved capacity is kept on truncate()
+    m_buffer.reserve(INITIAL_CAPACITY);
+}
+
+qint64 ReceiveBuffer::append(QIODevice *device)
+{
+    const auto bytesAvailable = device->bytesAvailable();
+
+    if(bytesAvailable <= 0) {
+        return bytesAvailable;
+    }
+
+    compact();
+
+    // Read straight into the buffer instead of going through readAll()
+    const auto oldSize = m_buffer.size();
+    m_buffer.resize(oldSize + (int)bytesAvailable);
+
+    const auto bytesRead = device->read(m_buffer.data() + oldSize, bytesAvailable);
+    m_buffer.resize(oldSize + (int)qMax<qint64>(bytesRead, 0));
+
+    return bytesRead;
+}
+
+void ReceiveBuffer::append(const QByteArray &data)
+{
+    compact();
+    m_buffer.append(data);
+}
+
+void ReceiveBuffer::consume(qint64 size)
+{
+    m_readPos += size;
+
+    if(m_readPos >= m_buffer.size()) {
+        clear();
+    }
+}
+
+void ReceiveBuffer::clear()
+{
+    m_buffer.truncate(0);
+    m_readPos = 0;
+}
+
+bool ReceiveBuffer::isEmpty() const
+{
+    return size() == 0;
+}
+
+qint64 ReceiveBuffer::size() const
+{
+    return m_buffer.size() - m_readPos;
+}
+
+const QByteArray ReceiveBuffer::data() const
+{
+    return QByteArray::fromRawData(m_buffer.constData() + m_readPos, (int)size());
+}
+
+qint64 ReceiveBuffer::nextFrameSize() const
+{
+    const auto *p = (const uchar*)m_buffer.constData() + m_readPos;
+    const auto count = qMin<qint64>(size(), VARINT_MAX_SIZE);
+
+    quint64 payloadSize = 0;
+
+    for(qint64 i = 0; i < count; ++i) {
+        const auto bits = (quint64)(p[i] & 0x7f);
+
+        // Checked before shifting, so that an overlong prefix cannot wrap around
+        if(bits > (quint64)(MAX_FRAME_SIZE >> (7 * i))) {
+            return INVALID_FRAME_SIZE;
+        }
+
+        payloadSize |= bits << (7 * i);
+
+        if(!(p[i] & 0x80)) {
+            return payloadSize > (quint64)MAX_FRAME_SIZE ? INVALID_FRAME_SIZE : i + 1 + (qint64)payloadSize;
+        }
+    }
+
+    // No varint is longer than that
+    return count == VARINT_MAX_SIZE ? INVALID_FRAME_SIZE : -1;
+}
+
+bool ReceiveBuffer::hasCompleteFrame() const
+{
+    const auto frameSize = nextFrameSize();
+    return frameSize > 0 && frameSize <= size();
+}
+
+bool ReceiveBuffer::hasInvalidFrame() const
+{
+    return nextFrameSize() == INVALID_FRAME_SIZE;
+}
+
+void ReceiveBuffer::compact()
+{
+    // Only move the unread tail when it is smaller than the consumed part,
+    // this keeps the total amount of copying linear in the amount of data received
+    if(m_readPos == 0 || m_readPos < m_buffer.size() / 2) {
+        return;
+    }
+
+    m_buffer.remove(0, (int)m_readPos);
+    m_readPos = 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QByteArray>
+
+class QIODevice;
+
+namespace Flipper {
+namespace Zero {
+
+class ReceiveBuffer
+{
+public:
+    ReceiveBuffer();
+
+    qint64 append(QIODevice *device);
+    void append(const QByteArray &data);
+    void consume(qint64 size);
+    void clear();
+
+    bool isEmpty() const;
+    qint64 size() const;
+
+    // Zero-copy view, valid until the next call to a non-const method
+    const QByteArray data() const;
+
+    // Size of the next length-delimited frame including its prefix, -1 if unknown yet
+    // and -2 if the prefix is malformed or announces an unreasonably large frame
+    qint64 nextFrameSize() const;
+    bool hasCompleteFrame() const;
+    bool hasInvalidFrame() const;
+
+private:
+    void compact();
+
+    QByteArray m_buffer;
+    qint64 m_readPos;
+};
+
+}
+}
+
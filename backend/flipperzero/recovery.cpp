@@ -1,8 +1,11 @@
 #include "recovery.h"
 
+#include <QMutexLocker>
+
 #include "devicestate.h"
 #include "dfusefile.h"
 #include "debug.h"
+#include "preferences.h"
 
 #include "device/stm32wb55.h"
 
@@ -22,7 +25,11 @@ using namespace WB55;
 Recovery::Recovery(DeviceState *deviceState, QObject *parent):
     QObject(parent),
     m_deviceState(deviceState)
-{}
+{
+    // The open handle is of no use after the device has re-enumerated
+    connect(m_deviceState, &DeviceState::isOnlineChanged, this, &Recovery::onDeviceStateChanged);
+    connect(m_deviceState, &DeviceState::deviceInfoChanged, this, &Recovery::onDeviceStateChanged);
+}
 
 Recovery::~Recovery()
 {}
@@ -36,12 +43,10 @@ bool Recovery::exitRecoveryMode()
 {
     m_deviceState->setStatusString(QStringLiteral("Exiting recovery mode..."));
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
-    const auto success = device.beginTransaction() && device.leave();
+    const auto device = openDevice();
+    const auto success = device && device->leave();
 
-    begin_ignore_block();
-    device.endTransaction();
-    end_ignore_block();
+    closeDevice();
 
     if(!success) {
         setErrorString("Failed to exit recovery mode");
@@ -58,14 +63,14 @@ bool Recovery::setBootMode(BootMode mode)
 
     m_deviceState->setStatusString(msg);
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    const auto device = openDevice();
 
-    if(!device.beginTransaction()) {
+    if(!device) {
         setErrorString("Can't set boot mode: Failed to initiate transaction.");
         return false;
     }
 
-    auto ob = device.optionBytes();
+    auto ob = device->optionBytes();
 
     if(!ob.isValid()) {
         setErrorString("Can't set boot mode: Failed to read option bytes.");
@@ -75,15 +80,14 @@ bool Recovery::setBootMode(BootMode mode)
     ob.setValue("nBOOT0", mode == BootMode::Normal);
     ob.setValue("nSWBOOT0", mode == BootMode::Normal);
 
-    const auto success = device.setOptionBytes(ob);
+    const auto success = device->setOptionBytes(ob);
 
     if(!success) {
         setErrorString("Can't set boot mode: Failed to set option bytes");
     }
 
-    begin_ignore_block();
-    device.endTransaction();
-    end_ignore_block();
+    // Writing the option bytes resets the device
+    closeDevice();
 
     return success;
 }
@@ -97,21 +101,18 @@ Recovery::WirelessStatus Recovery::wirelessStatus()
         return WirelessStatus::Invalid;
     }
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    const auto device = openDevice();
 
-    if(!device.beginTransaction()) {
+    if(!device) {
         debug_msg("Failed to get FUS status. This is normal if the device has just rebooted.");
         return WirelessStatus::Invalid;
     }
 
-    const auto state = device.FUSGetState();
+    const auto state = device->FUSGetState();
     if(!state.isValid()) {
         debug_msg("Failed to get FUS status. This is normal if the device has just rebooted.");
-        return WirelessStatus::Invalid;
-    }
-
-    if(!device.endTransaction()) {
-        debug_msg("Failed to get FUS status. This is normal if the device has just rebooted.");
+        // The handle may have gone stale
+        closeDevice();
         return WirelessStatus::Invalid;
     }
 
@@ -122,6 +123,8 @@ Recovery::WirelessStatus Recovery::wirelessStatus()
 
     if((status == FUSState::Idle) && (error == FUSState::NoError)) {
         return WirelessStatus::FUSRunning;
+    } else if((status == FUSState::FWUpgradeOngoing) || (status == FUSState::FUSUpgradeOngoing) || (status == FUSState::ServiceOngoing)) {
+        return WirelessStatus::FUSBusy;
     } else if(status == FUSState::ErrorOccured) {
          if(error == FUSState::NotRunning)
             return WirelessStatus::WSRunning;
@@ -133,18 +136,23 @@ Recovery::WirelessStatus Recovery::wirelessStatus()
     }
 }
 
+void Recovery::onDeviceStateChanged()
+{
+    closeDevice();
+}
+
 bool Recovery::startFUS()
 {
     m_deviceState->setStatusString("Starting firmware upgrade service (FUS)...");
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    const auto device = openDevice();
 
-    if(!device.beginTransaction()) {
+    if(!device) {
         setErrorString("Can't start FUS: Failed to initiate transaction.");
         return false;
     }
 
-    auto state = device.FUSGetState();
+    auto state = device->FUSGetState();
     auto success = state.isValid();
 
     if(!success) {
@@ -152,14 +160,14 @@ bool Recovery::startFUS()
 
     } else if((state.status() == FUSState::Idle) && (state.error() == FUSState::NoError)) {
         debug_msg("FUS is already RUNNING, rebooting for consistency...");
-        success = device.leave();
+        success = device->leave();
 
     } else if((state.status() == FUSState::ErrorOccured) && (state.error() == FUSState::NotRunning)) {
         debug_msg(QString("FUS appears NOT to be running: %1, %2.").arg(state.statusString(), state.errorString()));
 
         // Send a second GET_STATE to actually start FUS
         begin_ignore_block();
-        state = device.FUSGetState();
+        state = device->FUSGetState();
         end_ignore_block();
 
     } else {
@@ -167,9 +175,7 @@ bool Recovery::startFUS()
         success = false;
     }
 
-    begin_ignore_block();
-    device.endTransaction();
-    end_ignore_block();
+    closeDevice();
 
     // At this point, there is no way to know whether FUS has actually started, but things are looking as expected.
     return success;
@@ -180,10 +186,10 @@ bool Recovery::startWirelessStack()
 {
     m_deviceState->setStatusString("Attempting to start the Wireless Stack...");
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    const auto device = openDevice();
+    const auto success = device && device->FUSStartWirelessStack();
 
-    auto success = device.beginTransaction() && device.FUSStartWirelessStack();
-    check_continue(device.endTransaction(), "^^^ It's probably nothing at this point... ^^^");
+    closeDevice();
 
     if(!success) {
         setErrorString("Failed to start wireless stack.");
@@ -196,9 +202,8 @@ bool Recovery::deleteWirelessStack()
 {
     m_deviceState->setStatusString("Deleting old co-processor firmware...");
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
-
-    const auto success = device.beginTransaction() && device.FUSFwDelete() && device.endTransaction();
+    const auto device = openDevice();
+    const auto success = device && device->FUSFwDelete();
 
     if(!success) {
         setErrorString("Can't delete old co-processor firmware: Failed to initiate wireless stack firmware removal.");
@@ -222,15 +227,29 @@ bool Recovery::downloadFirmware(QIODevice *file)
     }
 
     DfuseFile fw(file);
-    DfuseDevice dev(m_deviceState->deviceInfo().usbInfo);
-
     file->close();
 
-    connect(&dev, &DfuseDevice::progressChanged, this, [=](int operation, double progress) {
+    const auto device = openDevice();
+
+    if(!device) {
+        setErrorString("Can't flash firmware: Failed to initiate transaction.");
+        return false;
+    }
+
+    const auto connection = connect(device.data(), &DfuseDevice::progressChanged, this, [=](int operation, double progress) {
         m_deviceState->setProgress(progress / 2.0 + (operation == DfuseDevice::Download ? 50 : 0));
     });
 
-    const auto success = dev.beginTransaction() && dev.download(&fw) && dev.endTransaction();
+    bool success;
+
+    if(globalPrefs->differentialFlashing()) {
+        // The rewritten pages are checked along with the rest if the whole image is verified later
+        success = device->downloadDifferential(&fw, !globalPrefs->verifyFirmware());
+    } else {
+        success = device->download(&fw);
+    }
+
+    disconnect(connection);
 
     if(!success) {
         setErrorString("Can't flash firmware: An error has occurred during the operation.");
@@ -255,47 +274,78 @@ bool Recovery::downloadWirelessStack(QIODevice *file, uint32_t addr)
         m_deviceState->setStatusString("Flashing co-processor firmware image...");
     }
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    const auto device = openDevice();
 
-    if(!device.beginTransaction()) {
+    if(!device) {
         setErrorString("Can't flash co-processor firmware image: Failed to initiate transaction.");
         return false;
     }
 
-    if(!addr) {
-        const auto ob = device.optionBytes();
-
-        if(!ob.isValid()) {
-            setErrorString("Can't flash co-processor firmware image: Failed to read Option Bytes.");
-            return false;
-        }
-
-        const auto origin = device.partitionOrigin((uint8_t)STM32WB55::Partition::Flash);
-        const auto pageSize = (uint32_t)0x1000; // TODO: do not hardcode page size
-
-        addr = (origin + (pageSize * ob.value("SFSA")) - file->bytesAvailable()) & (~(pageSize - 1));
+    if(addr) {
+        debug_msg(QString("Target address for co-processor firmware image has been OVERRIDDEN to 0x%1").arg(QString::number(addr, 16)));
 
-        debug_msg(QString("SFSA value is 0x%1").arg(QString::number(ob.value("SFSA"), 16)));
-        debug_msg(QString("Target address for co-processor firmware image is 0x%1").arg(QString::number(addr, 16)));
+    } else if(!(addr = wirelessStackAddress(device.data(), file->bytesAvailable()))) {
+        setErrorString("Can't flash co-processor firmware image: Failed to read Option Bytes.");
+        return false;
 
     } else {
-        debug_msg(QString("Target address for co-processor firmware image has been OVERRIDDEN to 0x%1").arg(QString::number(addr, 16)));
+        debug_msg(QString("Target address for co-processor firmware image is 0x%1").arg(QString::number(addr, 16)));
     }
 
-    connect(&device, &DfuseDevice::progressChanged, this, [=](int operation, double progress) {
+    const auto connection = connect(device.data(), &DfuseDevice::progressChanged, this, [=](int operation, double progress) {
         m_deviceState->setProgress(progress / 2.0 + (operation == DfuseDevice::Download ? 50 : 0));
     });
 
     bool success;
 
-    if(!(success = device.erase(addr, file->bytesAvailable()))) {
+    if(!(success = device->erase(addr, file->bytesAvailable()))) {
         setErrorString("Can't flash co-processor firmware image: Failed to erase the internal memory.");
-    } else if(!(success = device.download(file, addr, 0))) {
+    } else if(!(success = device->download(file, addr, 0))) {
         setErrorString("Can't flash co-processor firmware image: Failed to write the internal memory.");
-    } else if(!(success = device.endTransaction())) {
-        setErrorString("Can't flash co-processor firmware image: Failed to end transaction.");
     } else {}
 
+    disconnect(connection);
+    file->close();
+
+    return success;
+}
+
+bool Recovery::verifyWirelessStack(QIODevice *file, uint32_t addr)
+{
+    if(!file->open(QIODevice::ReadOnly)) {
+        setErrorString("Can't verify co-processor firmware image: Failed to open file.");
+        return false;
+    } else {
+        m_deviceState->setStatusString("Verifying co-processor firmware image...");
+    }
+
+    const auto device = openDevice();
+
+    if(!device) {
+        setErrorString("Can't verify co-processor firmware image: Failed to initiate transaction.");
+        file->close();
+        return false;
+    }
+
+    // Must end up at the same address as when it was written
+    if(!addr && !(addr = wirelessStackAddress(device.data(), file->bytesAvailable()))) {
+        setErrorString("Can't verify co-processor firmware image: Failed to read Option Bytes.");
+        file->close();
+        return false;
+    }
+
+    const auto connection = connect(device.data(), &DfuseDevice::progressChanged, this, [=](int operation, double progress) {
+        Q_UNUSED(operation)
+        m_deviceState->setProgress(progress);
+    });
+
+    const auto success = device->verify(file, addr, 0);
+
+    if(!success) {
+        setErrorString("Co-processor firmware image verification failed: The internal memory does not match the file.");
+    }
+
+    disconnect(connection);
     file->close();
 
     return success;
@@ -305,10 +355,8 @@ bool Recovery::upgradeWirelessStack()
 {
     debug_msg("Sending FW_UPGRADE command...");
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
-
-    const auto success = device.beginTransaction() && device.FUSFwUpgrade();
-    check_continue(device.endTransaction(), "^^^ It's probably nothing at this point... ^^^");
+    const auto device = openDevice();
+    const auto success = device && device->FUSFwUpgrade();
 
     if(!success) {
         setErrorString("Can't upgrade Co-Processor firmware: Failed to initiate installation.");
@@ -321,19 +369,14 @@ bool Recovery::upgradeWirelessStack()
 
 bool Recovery::checkWirelessStack()
 {
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    const auto device = openDevice();
 
-    if(!device.beginTransaction()) {
+    if(!device) {
         setErrorString(QStringLiteral("Failed to read co-processor firmware version info"));
         return false;
     }
 
-    const auto versionInfo = device.versionInfo();
-
-    if(!device.endTransaction()) {
-        setErrorString(QStringLiteral("Failed to read co-processor firmware version info"));
-        return false;
-    }
+    const auto versionInfo = device->versionInfo();
 
     qCDebug(CATEGORY_DEBUG).noquote() << "FUS version:" << versionInfo.FUSVersion;
     qCDebug(CATEGORY_DEBUG).noquote() << "Wireless Stack version:" << versionInfo.WirelessVersion;
@@ -341,6 +384,41 @@ bool Recovery::checkWirelessStack()
     return versionInfo.WirelessVersion != QStringLiteral("0.0.0");
 }
 
+bool Recovery::verifyFirmware(QIODevice *file)
+{
+    if(!file->open(QIODevice::ReadOnly)) {
+        setErrorString("Can't verify firmware: Failed to open the file.");
+        return false;
+    } else {
+        m_deviceState->setStatusString("Verifying firmware...");
+    }
+
+    DfuseFile fw(file);
+    file->close();
+
+    const auto device = openDevice();
+
+    if(!device) {
+        setErrorString("Can't verify firmware: Failed to initiate transaction.");
+        return false;
+    }
+
+    const auto connection = connect(device.data(), &DfuseDevice::progressChanged, this, [=](int operation, double progress) {
+        Q_UNUSED(operation)
+        m_deviceState->setProgress(progress);
+    });
+
+    const auto success = device->verify(&fw);
+
+    if(!success) {
+        setErrorString("Firmware verification failed: The internal memory does not match the file.");
+    }
+
+    disconnect(connection);
+
+    return success;
+}
+
 bool Recovery::downloadOptionBytes(QIODevice *file)
 {
     m_deviceState->setStatusString("Downloading Option Bytes...");
@@ -351,10 +429,10 @@ bool Recovery::downloadOptionBytes(QIODevice *file)
 
     check_return_bool(loaded.isValid(), "Failed to load option bytes from file");
 
-    STM32WB55 device(m_deviceState->deviceInfo().usbInfo);
+    const auto device = openDevice();
 
-    check_return_bool(device.beginTransaction(), "Failed to initiate transaction");
-    const OptionBytes actual = device.optionBytes();
+    check_return_bool(device, "Failed to initiate transaction");
+    const OptionBytes actual = device->optionBytes();
 
     const auto diff = actual.compare(loaded);
 
@@ -363,7 +441,7 @@ bool Recovery::downloadOptionBytes(QIODevice *file)
     if(diff.isEmpty()) {
         debug_msg("Option Bytes OK");
 
-        success = device.leave();
+        success = device->leave();
 
         if(!success) {
             setErrorString("Can't set boot mode: Failed to leave the Recovery mode.");
@@ -377,16 +455,15 @@ bool Recovery::downloadOptionBytes(QIODevice *file)
 
         debug_msg("Writing corrected Option Bytes...");
 
-        success = device.setOptionBytes(actual.corrected(diff));
+        success = device->setOptionBytes(actual.corrected(diff));
 
         if(!success) {
             setErrorString("Can't set boot mode: Failed to set option bytes");
         }
     }
 
-    begin_ignore_block();
-    device.endTransaction();
-    end_ignore_block();
+    // Either way, the device resets
+    closeDevice();
 
     if(success) {
         m_deviceState->setStatusString(QStringLiteral("Exiting recovery mode..."));
@@ -394,3 +471,57 @@ bool Recovery::downloadOptionBytes(QIODevice *file)
 
     return success;
 }
+
+QSharedPointer<STM32WB55> Recovery::openDevice()
+{
+    QMutexLocker locker(&m_deviceMutex);
+
+    if(m_device) {
+        return m_device;
+
+    } else if(!m_deviceState->isOnline()) {
+        debug_msg("Can't open the device: it is offline at the moment.");
+        return QSharedPointer<STM32WB55>();
+    }
+
+    const auto deleter = [](STM32WB55 *device) {
+        begin_ignore_block();
+        device->endTransaction();
+        end_ignore_block();
+
+        delete device;
+    };
+
+    const QSharedPointer<STM32WB55> device(new STM32WB55(m_deviceState->deviceInfo().usbInfo), deleter);
+
+    if(!device->beginTransaction()) {
+        return QSharedPointer<STM32WB55>();
+    }
+
+    m_device = device;
+    return m_device;
+}
+
+void Recovery::closeDevice()
+{
+    QMutexLocker locker(&m_deviceMutex);
+    // Whoever is still using it keeps it alive until done
+    m_device.reset();
+}
+
+uint32_t Recovery::wirelessStackAddress(STM32WB55 *device, qint64 size)
+{
+    const auto ob = device->optionBytes();
+
+    if(!ob.isValid()) {
+        return 0;
+    }
+
+    const auto origin = device->partitionOrigin((uint8_t)STM32WB55::Partition::Flash);
+    const auto pageSize = (uint32_t)0x1000; // TODO: do not hardcode page size
+
+    debug_msg(QString("SFSA value is 0x%1").arg(QString::number(ob.value("SFSA"), 16)));
+
+    // The image goes right below the secure flash area
+    return (origin + (pageSize * ob.value("SFSA")) - size) & (~(pageSize - 1));
+}
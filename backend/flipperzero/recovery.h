@@ -1,12 +1,18 @@
 #pragma once
 
+#include <QMutex>
 #include <QObject>
+#include <QSharedPointer>
 
 #include "failable.h"
 #include "usbdeviceinfo.h"
 
 class QIODevice;
 
+namespace STM32 {
+class STM32WB55;
+}
+
 namespace Flipper {
 namespace Zero {
 
@@ -25,6 +31,7 @@ public:
     enum class WirelessStatus {
         WSRunning,
         FUSRunning,
+        FUSBusy,
         ErrorOccured,
         UnhandledState,
         Invalid
@@ -50,8 +57,23 @@ public:
     bool downloadOptionBytes(QIODevice *file);
     bool downloadWirelessStack(QIODevice *file, uint32_t addr = 0);
 
+    bool verifyFirmware(QIODevice *file);
+    bool verifyWirelessStack(QIODevice *file, uint32_t addr = 0);
+
+private slots:
+    void onDeviceStateChanged();
+
 private:
+    // The device stays open between the calls until it resets or re-enumerates
+    QSharedPointer<STM32::STM32WB55> openDevice();
+    void closeDevice();
+
+    uint32_t wirelessStackAddress(STM32::STM32WB55 *device, qint64 size);
+
     DeviceState *m_deviceState;
+
+    QSharedPointer<STM32::STM32WB55> m_device;
+    QMutex m_deviceMutex;
 };
 
 }
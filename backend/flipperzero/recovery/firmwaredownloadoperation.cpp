@@ -6,6 +6,8 @@
 #include "flipperzero/devicestate.h"
 #include "flipperzero/recovery.h"
 
+#include "preferences.h"
+
 using namespace Flipper;
 using namespace Zero;
 
@@ -24,7 +26,10 @@ void FirmwareDownloadOperation::nextStateLogic()
     if(operationState() == AbstractOperation::Ready) {
         setOperationState(State::DownloadingFirmware);
         downloadFirmware();
-    } else if(operationState() == State::DownloadingFirmware) {
+    } else if((operationState() == State::DownloadingFirmware) && globalPrefs->verifyFirmware()) {
+        setOperationState(State::VerifyingFirmware);
+        verifyFirmware();
+    } else if((operationState() == State::DownloadingFirmware) || (operationState() == State::VerifyingFirmware)) {
         finish();
     } else {
         finishWithError(BackendError::RecoveryError, QStringLiteral("Unexpected state."));
@@ -51,3 +56,24 @@ void FirmwareDownloadOperation::downloadFirmware()
     watcher->setFuture(QtConcurrent::run(&Recovery::downloadFirmware, recovery(), m_file));
 #endif
 }
+
+void FirmwareDownloadOperation::verifyFirmware()
+{
+    auto *watcher = new QFutureWatcher<bool>(this);
+
+    connect(watcher, &QFutureWatcherBase::finished, this, [=]() {
+        if(watcher->result()) {
+            advanceOperationState();
+        } else {
+            finishWithError(BackendError::RecoveryError, recovery()->errorString());
+        }
+
+        watcher->deleteLater();
+    });
+
+#if QT_VERSION < 0x060000
+    watcher->setFuture(QtConcurrent::run(recovery(), &Recovery::verifyFirmware, m_file));
+#else
+    watcher->setFuture(QtConcurrent::run(&Recovery::verifyFirmware, recovery(), m_file));
+#endif
+}
@@ -12,7 +12,8 @@ class FirmwareDownloadOperation : public AbstractRecoveryOperation
     Q_OBJECT
 
     enum State {
-        DownloadingFirmware = AbstractOperation::User
+        DownloadingFirmware = AbstractOperation::User,
+        VerifyingFirmware
     };
 
 public:
@@ -24,6 +25,7 @@ private slots:
 
 private:
     void downloadFirmware();
+    void verifyFirmware();
 
     QIODevice *m_file;
 };
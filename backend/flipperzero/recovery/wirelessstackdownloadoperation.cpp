@@ -10,6 +10,8 @@
 #include "flipperzero/devicestate.h"
 #include "flipperzero/recovery.h"
 
+#include "preferences.h"
+
 Q_DECLARE_LOGGING_CATEGORY(LOG_RECOVERY)
 
 using namespace Flipper;
@@ -18,18 +20,22 @@ using namespace Zero;
 static constexpr int INSTALL_TRY_COUNT = 3;
 static constexpr int CHECK_TRY_COUNT = 3;
 static constexpr int TIMER_INTERVAL_MS = 1000;
+static constexpr int POLL_INTERVAL_MIN_MS = 100;
+static constexpr int POLL_INTERVAL_MAX_MS = 1000;
 
 WirelessStackDownloadOperation::WirelessStackDownloadOperation(Recovery *recovery, QIODevice *file, uint32_t targetAddress, QObject *parent):
     AbstractRecoveryOperation(recovery, parent),
     m_file(file),
     m_loopTimer(new QTimer(this)),
     m_targetAddress(targetAddress),
+    m_pollInterval(POLL_INTERVAL_MIN_MS),
+    m_lastStatus(Recovery::WirelessStatus::Invalid),
     m_installTryCount(INSTALL_TRY_COUNT)
 {
-    m_loopTimer->setInterval(TIMER_INTERVAL_MS);
+    m_loopTimer->setSingleShot(true);
 
     connect(m_loopTimer, &QTimer::timeout, this, &WirelessStackDownloadOperation::nextStateLogic);
-    connect(this, &AbstractOperation::finished, m_loopTimer, &QTimer::stop);
+    connect(this, &AbstractOperation::finished, this, &WirelessStackDownloadOperation::stopPolling);
 }
 
 const QString WirelessStackDownloadOperation::description() const
@@ -53,7 +59,11 @@ void WirelessStackDownloadOperation::nextStateLogic()
             downloadWirelessStack();
         }
 
-    } else if(operationState() == DownloadingWirelessStack) {
+    } else if((operationState() == DownloadingWirelessStack) && globalPrefs->verifyFirmware()) {
+        setOperationState(VerifyingWirelessStack);
+        verifyWirelessStack();
+
+    } else if((operationState() == DownloadingWirelessStack) || (operationState() == VerifyingWirelessStack)) {
         setOperationState(UpgradingWirelessStack);
         upgradeWirelessStack();
 
@@ -108,7 +118,7 @@ void WirelessStackDownloadOperation::deleteWirelessStack()
     if(!recovery()->deleteWirelessStack()) {
         finishWithError(BackendError::RecoveryError, recovery()->errorString());
     } else {
-        m_loopTimer->start();
+        startPolling();
     }
 }
 
@@ -117,12 +127,14 @@ bool WirelessStackDownloadOperation::isWirelessStackDeleted()
     const auto status = recovery()->wirelessStatus();
 
     const auto waitNext = (status == Recovery::WirelessStatus::Invalid) ||
+                          (status == Recovery::WirelessStatus::FUSBusy) ||
                           (status == Recovery::WirelessStatus::UnhandledState);
     if(waitNext) {
+        pollAgain(status);
         return false;
     }
 
-    m_loopTimer->stop();
+    stopPolling();
 
     const auto errorOccured = (status == Recovery::WirelessStatus::WSRunning) ||
                               (status == Recovery::WirelessStatus::ErrorOccured);
@@ -153,12 +165,32 @@ void WirelessStackDownloadOperation::downloadWirelessStack()
 #endif
 }
 
+void WirelessStackDownloadOperation::verifyWirelessStack()
+{
+    auto *watcher = new QFutureWatcher<bool>(this);
+
+    connect(watcher, &QFutureWatcherBase::finished, this, [=]() {
+        if(watcher->result()) {
+            advanceOperationState();
+        } else {
+            finishWithError(BackendError::RecoveryError, recovery()->errorString());
+        }
+
+        watcher->deleteLater();
+    });
+#if QT_VERSION < 0x060000
+    watcher->setFuture(QtConcurrent::run(recovery(), &Recovery::verifyWirelessStack, m_file, m_targetAddress));
+#else
+    watcher->setFuture(QtConcurrent::run(&Recovery::verifyWirelessStack, recovery(), m_file, m_targetAddress));
+#endif
+}
+
 void WirelessStackDownloadOperation::upgradeWirelessStack()
 {
     if(!recovery()->upgradeWirelessStack()) {
         finishWithError(BackendError::RecoveryError, recovery()->errorString());
     } else {
-        m_loopTimer->start();
+        startPolling();
     }
 }
 
@@ -167,12 +199,14 @@ bool WirelessStackDownloadOperation::isWirelessStackUpgraded()
     const auto status = recovery()->wirelessStatus();
 
     const auto waitNext = (status == Recovery::WirelessStatus::Invalid) ||
+                          (status == Recovery::WirelessStatus::FUSBusy) ||
                           (status == Recovery::WirelessStatus::UnhandledState);
     if(waitNext) {
+        pollAgain(status);
         return false;
     }
 
-    m_loopTimer->stop();
+    stopPolling();
 
     const auto errorOccured = (status == Recovery::WirelessStatus::ErrorOccured);
     if(errorOccured) {
@@ -185,7 +219,7 @@ bool WirelessStackDownloadOperation::isWirelessStackUpgraded()
 void WirelessStackDownloadOperation::checkWirelessStack()
 {
     m_checkTryCount = CHECK_TRY_COUNT;
-    m_loopTimer->start();
+    m_loopTimer->start(TIMER_INTERVAL_MS);
 
     advanceOperationState();
 }
@@ -199,6 +233,7 @@ void WirelessStackDownloadOperation::tryAgain()
 {
     if(--m_checkTryCount > 0) {
         qCDebug(LOG_RECOVERY) << "Wireless stack check seems to have failed, retrying...";
+        m_loopTimer->start(TIMER_INTERVAL_MS);
 
     } else if(--m_installTryCount > 0) {
         qCDebug(LOG_RECOVERY) << "Wireless stack installation seems to have failed, retrying...";
@@ -212,3 +247,31 @@ void WirelessStackDownloadOperation::tryAgain()
         finishWithError(BackendError::RecoveryError, QStringLiteral("Could not install wireless stack after several tries, giving up"));
     }
 }
+
+void WirelessStackDownloadOperation::startPolling()
+{
+    m_pollInterval = POLL_INTERVAL_MIN_MS;
+    m_lastStatus = Recovery::WirelessStatus::Invalid;
+
+    m_loopTimer->start(m_pollInterval);
+}
+
+void WirelessStackDownloadOperation::pollAgain(Recovery::WirelessStatus status)
+{
+    if((status == Recovery::WirelessStatus::Invalid) && !deviceState()->isOnline()) {
+        // Rebooting, will poll as soon as the device is back
+        m_loopTimer->stop();
+        return;
+    }
+
+    // Poll often right after a change, back off while FUS keeps being busy
+    m_pollInterval = (status == m_lastStatus) ? qMin(m_pollInterval * 2, POLL_INTERVAL_MAX_MS) : POLL_INTERVAL_MIN_MS;
+    m_lastStatus = status;
+
+    m_loopTimer->start(m_pollInterval);
+}
+
+void WirelessStackDownloadOperation::stopPolling()
+{
+    m_loopTimer->stop();
+}
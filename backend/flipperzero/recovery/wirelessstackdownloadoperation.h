@@ -1,6 +1,7 @@
 #pragma once
 
 #include "abstractrecoveryoperation.h"
+#include "flipperzero/recovery.h"
 
 class QTimer;
 class QIODevice;
@@ -16,6 +17,7 @@ class WirelessStackDownloadOperation : public AbstractRecoveryOperation
         StartingFUS = AbstractOperation::User,
         DeletingWirelessStack,
         DownloadingWirelessStack,
+        VerifyingWirelessStack,
         UpgradingWirelessStack,
         CheckingWirelessStack
     };
@@ -33,15 +35,22 @@ private:
     void deleteWirelessStack();
     bool isWirelessStackDeleted();
     void downloadWirelessStack();
+    void verifyWirelessStack();
     void upgradeWirelessStack();
     bool isWirelessStackUpgraded();
     void checkWirelessStack();
     bool isWirelessStackOK();
     void tryAgain();
 
+    void startPolling();
+    void pollAgain(Recovery::WirelessStatus status);
+    void stopPolling();
+
     QIODevice *m_file;
     QTimer *m_loopTimer;
     uint32_t m_targetAddress;
+    int m_pollInterval;
+    Recovery::WirelessStatus m_lastStatus;
     int m_installTryCount;
     int m_checkTryCount;
 };
@@ -9,7 +9,8 @@ using namespace Zero;
 
 AbstractProtobufOperation::AbstractProtobufOperation(uint32_t id, QObject *parent):
     AbstractOperation(parent),
-    m_id(id)
+    m_id(id),
+    m_priority(Control)
 {}
 
 AbstractProtobufOperation::~AbstractProtobufOperation()
@@ -20,15 +21,32 @@ uint32_t AbstractProtobufOperation::id() const
     return m_id;
 }
 
+AbstractProtobufOperation::Priority AbstractProtobufOperation::priority() const
+{
+    return m_priority;
+}
+
+void AbstractProtobufOperation::setPriority(Priority priority)
+{
+    m_priority = priority;
+}
+
 bool AbstractProtobufOperation::hasMoreData() const
 {
     // Default implementation for single-part operations
     return false;
 }
 
-bool AbstractProtobufOperation::isFinished() const
+QIODevice *AbstractProtobufOperation::dataSink() const
 {
-    return operationState() == AbstractOperation::Finished;
+    // Default implementation for operations that process the responses themselves
+    return nullptr;
+}
+
+bool AbstractProtobufOperation::isPipelinable() const
+{
+    // Default implementation for operations that must have the link to themselves
+    return false;
 }
 
 void AbstractProtobufOperation::start()
@@ -67,6 +85,13 @@ void AbstractProtobufOperation::feedResponse(QObject *response)
     }
 }
 
+bool AbstractProtobufOperation::encodeRequest(ProtobufPluginInterface *encoder, QByteArray &buffer)
+{
+    // Default implementation for operations with small requests
+    buffer = encodeRequest(encoder);
+    return !buffer.isEmpty();
+}
+
 bool AbstractProtobufOperation::begin()
 {
     // Empty default implementation
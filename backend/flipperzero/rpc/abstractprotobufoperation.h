@@ -2,6 +2,7 @@
 
 #include "abstractoperation.h"
 
+class QIODevice;
 class ProtobufPluginInterface;
 
 namespace Flipper {
@@ -16,12 +17,25 @@ class AbstractProtobufOperation : public AbstractOperation
     };
 
 public:
+    enum Priority {
+        Interactive = 0,
+        Control,
+        Bulk,
+        PriorityCount
+    };
+
     AbstractProtobufOperation(uint32_t id, QObject *parent = nullptr);
     virtual ~AbstractProtobufOperation();
 
     uint32_t id() const;
+
+    Priority priority() const;
+    void setPriority(Priority priority);
+
     virtual bool hasMoreData() const;
-    bool isFinished() const;
+    // Device to receive the payload of the responses directly during decoding
+    virtual QIODevice *dataSink() const;
+    virtual bool isPipelinable() const;
 
     void start() override;
     void finishLater();
@@ -30,11 +44,14 @@ public:
     virtual void feedResponse(QObject *response);
 
     virtual const QByteArray encodeRequest(ProtobufPluginInterface *encoder) = 0;
+    // Encode into a buffer provided by the session, which is reused between requests
+    virtual bool encodeRequest(ProtobufPluginInterface *encoder, QByteArray &buffer);
 
 private:
     virtual bool begin();
     virtual bool processResponse(QObject *response);
     uint32_t m_id;
+    Priority m_priority;
 };
 
 }
@@ -17,6 +17,11 @@ const QString PropertyGetOperation::description() const
     return QStringLiteral("Property Get");
 }
 
+bool PropertyGetOperation::isPipelinable() const
+{
+    return true;
+}
+
 const QByteArray PropertyGetOperation::value(const QByteArray &key) const
 {
     return m_data.value(key);
@@ -20,6 +20,11 @@ const QString StorageInfoOperation::description() const
     return QStringLiteral("Storage Info @%1").arg(QString(m_path));
 }
 
+bool StorageInfoOperation::isPipelinable() const
+{
+    return true;
+}
+
 bool StorageInfoOperation::isPresent() const
 {
     return m_isPresent;
@@ -12,6 +12,7 @@ class StorageInfoOperation : public AbstractProtobufOperation
 public:
     StorageInfoOperation(uint32_t id, const QByteArray &path, QObject *parent = nullptr);
     const QString description() const override;
+    bool isPipelinable() const override;
 
     bool isPresent() const;
     quint64 sizeFree() const;
@@ -19,6 +19,11 @@ const QString StorageListOperation::description() const
     return QStringLiteral("Storage List @%1").arg(QString(m_path));
 }
 
+bool StorageListOperation::isPipelinable() const
+{
+    return true;
+}
+
 const FileInfoList &StorageListOperation::files() const
 {
     return m_result;
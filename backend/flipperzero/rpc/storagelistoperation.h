@@ -13,6 +13,7 @@ class StorageListOperation : public AbstractProtobufOperation
 public:
     StorageListOperation(uint32_t id, const QByteArray &path, QObject *parent = nullptr);
     const QString description() const override;
+    bool isPipelinable() const override;
     const FileInfoList &files() const;
     bool hasPath() const;
 
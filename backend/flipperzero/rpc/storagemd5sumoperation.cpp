@@ -17,6 +17,11 @@ const QString StorageMd5SumOperation::description() const
     return QStringLiteral("Storage Md5Sum @%1").arg(QString(path()));
 }
 
+bool StorageMd5SumOperation::isPipelinable() const
+{
+    return true;
+}
+
 const QByteArray StorageMd5SumOperation::encodeRequest(ProtobufPluginInterface *encoder)
 {
     return encoder->storageMd5Sum(id(), path());
@@ -13,6 +13,7 @@ public:
     StorageMd5SumOperation(uint32_t id, const QByteArray &path, QObject *parent = nullptr);
 
     const QString description() const override;
+    bool isPipelinable() const override;
     const QByteArray encodeRequest(ProtobufPluginInterface *encoder) override;
 
     const QByteArray &md5Sum() const;
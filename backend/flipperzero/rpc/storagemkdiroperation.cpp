@@ -14,6 +14,11 @@ const QString StorageMkdirOperation::description() const
     return QStringLiteral("Storage MkDir @%1").arg(QString(path()));
 }
 
+bool StorageMkdirOperation::isPipelinable() const
+{
+    return true;
+}
+
 const QByteArray StorageMkdirOperation::encodeRequest(ProtobufPluginInterface *encoder)
 {
     return encoder->storageMkDir(id(), path());
@@ -12,6 +12,7 @@ class StorageMkdirOperation : public AbstractStorageOperation
 public:
     StorageMkdirOperation(uint32_t id, const QByteArray &path, QObject *parent = nullptr);
     const QString description() const override;
+    bool isPipelinable() const override;
     const QByteArray encodeRequest(ProtobufPluginInterface *encoder) override;
 };
 
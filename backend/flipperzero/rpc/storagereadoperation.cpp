@@ -16,11 +16,7 @@ StorageReadOperation::StorageReadOperation(uint32_t id, const QByteArray &path,
     m_subRequest(NoRequest),
     m_fileSizeTotal(0),
     m_fileSizeReceived(0)
-{
-    connect(this, &AbstractOperation::finished, m_file, [=]() {
-        m_file->close();
-    });
-}
+{}
 
 const QString StorageReadOperation::description() const
 {
@@ -32,6 +28,11 @@ bool StorageReadOperation::hasMoreData() const
     return m_subRequest != StorageRead;
 }
 
+QIODevice *StorageReadOperation::dataSink() const
+{
+    return m_file;
+}
+
 // Custom feedResponse() implementation to accommodate the stat request
 void StorageReadOperation::feedResponse(QObject *response)
 {
@@ -41,7 +42,7 @@ void StorageReadOperation::feedResponse(QObject *response)
         finishWithError(BackendError::ProtocolError, QStringLiteral("Device replied with error: %1").arg(mainResponse->errorString()));
     } else if(!processResponse(response)) {
         finishWithError(BackendError::ProtocolError, QStringLiteral("Operation finished with error: %1").arg(mainResponse->errorString()));
-    } else if(qobject_cast<StorageReadResponseInterface*>(response) && !mainResponse->hasNext()) {
+    } else if(mainResponse->type() == MainResponseInterface::StorageRead && !mainResponse->hasNext()) {
         finish();
     } else {
         startTimeout();
@@ -65,6 +66,12 @@ const QByteArray StorageReadOperation::encodeRequest(ProtobufPluginInterface *en
 
 bool StorageReadOperation::begin()
 {
+    // The file is written to from the transport thread during the operation. Connected here rather
+    // than in the constructor so that the session gets to take the data sink back before it is closed.
+    connect(this, &AbstractOperation::finished, m_file, [=]() {
+        m_file->close();
+    });
+
     const auto success = m_file->open(QIODevice::WriteOnly);
 
     if(!success) {
@@ -77,7 +84,20 @@ bool StorageReadOperation::begin()
 bool StorageReadOperation::processResponse(QObject *response)
 {
     if(auto *storageReadResponse = qobject_cast<StorageReadResponseInterface*>(response)) {
-        if(storageReadResponse->hasFile()) {
+        if(storageReadResponse->isStreamed()) {
+            // The data is already in the file
+            const auto size = storageReadResponse->streamedSize();
+
+            if(size < 0) {
+                return false;
+            }
+
+            m_fileSizeReceived += size;
+            setProgress(m_fileSizeReceived * 100.0 / m_fileSizeTotal);
+
+            return true;
+
+        } else if(storageReadResponse->hasFile()) {
             const auto &data = storageReadResponse->file().data;
 
             m_fileSizeReceived += data.size();
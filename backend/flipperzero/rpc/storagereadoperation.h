@@ -23,6 +23,7 @@ public:
     StorageReadOperation(uint32_t id, const QByteArray &path, QIODevice *file, QObject *parent = nullptr);
     const QString description() const override;
     bool hasMoreData() const override;
+    QIODevice *dataSink() const override;
     void feedResponse(QObject *response) override;
     const QByteArray encodeRequest(ProtobufPluginInterface *encoder) override;
 
@@ -16,6 +16,11 @@ const QString StorageRemoveOperation::description() const
     return QStringLiteral("Storage Remove @%1").arg(QString(m_path));
 }
 
+bool StorageRemoveOperation::isPipelinable() const
+{
+    return true;
+}
+
 const QByteArray StorageRemoveOperation::encodeRequest(ProtobufPluginInterface *encoder)
 {
     return encoder->storageRemove(id(), m_path, m_recursive);
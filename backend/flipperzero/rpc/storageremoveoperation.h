@@ -12,6 +12,7 @@ class StorageRemoveOperation : public AbstractProtobufOperation
 public:
     StorageRemoveOperation(uint32_t id, const QByteArray &path, bool recursive, QObject *parent = nullptr);
     const QString description() const override;
+    bool isPipelinable() const override;
     const QByteArray encodeRequest(ProtobufPluginInterface *encoder) override;
 
 private:
@@ -16,6 +16,11 @@ const QString StorageRenameOperation::description() const
     return QStringLiteral("Storage Rename @%1 -> %2").arg(QString(m_oldPath), QString(m_newPath));
 }
 
+bool StorageRenameOperation::isPipelinable() const
+{
+    return true;
+}
+
 const QByteArray StorageRenameOperation::encodeRequest(ProtobufPluginInterface *encoder)
 {
     return encoder->storageRename(id(), m_oldPath, m_newPath);
@@ -12,6 +12,7 @@ class StorageRenameOperation : public AbstractProtobufOperation
 public:
     StorageRenameOperation(uint32_t id, const QByteArray &oldPath, const QByteArray &newPath, QObject *parent = nullptr);
     const QString description() const override;
+    bool isPipelinable() const override;
 
     const QByteArray encodeRequest(ProtobufPluginInterface *encoder) override;
 
@@ -20,6 +20,11 @@ const QString StorageStatOperation::description() const
     return QStringLiteral("Storage Stat @%1").arg(QString(m_fileName));
 }
 
+bool StorageStatOperation::isPipelinable() const
+{
+    return true;
+}
+
 const QByteArray &StorageStatOperation::fileName() const
 {
     return m_fileName;
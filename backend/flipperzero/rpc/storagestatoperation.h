@@ -20,6 +20,7 @@ public:
 
     StorageStatOperation(uint32_t id, const QByteArray &fileName, QObject *parent = nullptr);
     const QString description() const override;
+    bool isPipelinable() const override;
 
     const QByteArray &fileName() const;
     bool hasFile() const;
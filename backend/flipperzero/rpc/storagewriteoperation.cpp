@@ -6,18 +6,23 @@
 #include "statusresponseinterface.h"
 #include "mainresponseinterface.h"
 
-static constexpr qint64 CHUNK_SIZE = 1024;
-static constexpr qint64 CHUNKS_PER_PING_CAP = 1000;
+// Files smaller than that don't get progress reports at all
+static constexpr qint64 PING_FILE_SIZE_THRESHOLD = 100 * 1024;
 
 using namespace Flipper;
 using namespace Zero;
 
-StorageWriteOperation::StorageWriteOperation(uint32_t id, const QByteArray &path, QIODevice *file, QObject *parent):
+StorageWriteOperation::StorageWriteOperation(uint32_t id, const QByteArray &path, QIODevice *file, StorageWriteTuner *tuner, QObject *parent):
     AbstractStorageOperation(id, path, parent),
     m_file(file),
+    m_tuner(tuner),
     m_subRequest(StorageWrite),
-    m_chunksPerPing(0),
-    m_chunksWritten(0)
+    m_isPingEnabled(false),
+    m_fileSize(0),
+    m_chunksWritten(0),
+    m_bytesWritten(0),
+    m_bytesAcked(0),
+    m_lastAckTime(0)
 {
     connect(this, &AbstractOperation::finished, m_file, [=]() {
         m_file->close();
@@ -43,7 +48,7 @@ void StorageWriteOperation::feedResponse(QObject *response)
         finishWithError(BackendError::ProtocolError, QStringLiteral("Device replied with error: %1").arg(mainResponse->errorString()));
     } else if(!processResponse(response)) {
         finishWithError(BackendError::ProtocolError, QStringLiteral("Operation finished with error: %1").arg(mainResponse->errorString()));
-    } else if(!qobject_cast<StatusPingResponseInterface*>(response)) {
+    } else if(mainResponse->type() != MainResponseInterface::StatusPing) {
         finish();
     } else {
         startTimeout();
@@ -51,25 +56,43 @@ void StorageWriteOperation::feedResponse(QObject *response)
 }
 
 const QByteArray StorageWriteOperation::encodeRequest(ProtobufPluginInterface *encoder)
+{
+    QByteArray buf;
+    encodeRequest(encoder, buf);
+    return buf;
+}
+
+bool StorageWriteOperation::encodeRequest(ProtobufPluginInterface *encoder, QByteArray &buffer)
 {
     if(m_subRequest == StorageWrite) {
-        // Never true for files smaller than 100 chunks
-        // Such small files don't get progress reports at all
-        if(++m_chunksWritten == m_chunksPerPing) {
+        // The ping cadence is re-evaluated after each ping response
+        if(m_isPingEnabled && ++m_chunksWritten >= m_tuner->chunksPerPing()) {
             m_chunksWritten = 0;
             m_subRequest = StatusPing;
         }
 
-        const auto buf = m_file->read(CHUNK_SIZE);
-        const auto hasNext = m_file->bytesAvailable() > 0;
-        return encoder->storageWrite(id(), path(), buf, hasNext);
+        const auto bytesAvailable = m_file->bytesAvailable();
+        const auto chunkSize = qMin(m_tuner->chunkSize(), bytesAvailable);
+        const auto hasNext = bytesAvailable > chunkSize;
+
+        m_bytesWritten += chunkSize;
+        // The chunk is read from the file directly into the buffer
+        return encoder->storageWrite(buffer, id(), path(), m_file, chunkSize, hasNext);
 
     } else if(m_subRequest == StatusPing) {
         m_subRequest = StorageWrite;
-        return encoder->statusPing(id());
+        m_pendingPings.enqueue({m_bytesWritten, m_elapsedTimer.elapsed()});
+
+        buffer = encoder->statusPing(id());
+        return !buffer.isEmpty();
     }
 
-    return QByteArray();
+    return false;
+}
+
+const StorageWriteParameters StorageWriteOperation::parameters() const
+{
+    return m_tuner->parameters();
 }
 
 bool StorageWriteOperation::begin()
@@ -79,20 +102,35 @@ bool StorageWriteOperation::begin()
         return false;
     }
 
-    const auto fileSize = m_file->bytesAvailable();
-
-    if(fileSize >= CHUNK_SIZE * 100) {
-        // Insert a ping for roughly each 1% of the file size
-        m_chunksPerPing = qMin<qint64>(fileSize / (CHUNK_SIZE * 100), CHUNKS_PER_PING_CAP);
-        m_percentPerPing = 100.0 * (double)(CHUNK_SIZE * m_chunksPerPing) / fileSize;
-    }
+    m_fileSize = m_file->bytesAvailable();
+    m_isPingEnabled = m_fileSize >= PING_FILE_SIZE_THRESHOLD;
 
+    m_elapsedTimer.start();
     return true;
 }
 
 bool StorageWriteOperation::processResponse(QObject *response)
 {
-    setProgress(m_chunksPerPing ? progress() + m_percentPerPing : 100.0);
-    return qobject_cast<StatusPingResponseInterface*>(response) ||
-           qobject_cast<EmptyResponseInterface*>(response);
+    if(qobject_cast<StatusPingResponseInterface*>(response)) {
+        if(m_pendingPings.isEmpty()) {
+            return false;
+        }
+
+        const auto ping = m_pendingPings.dequeue();
+        const auto now = m_elapsedTimer.elapsed();
+
+        m_tuner->addSample(ping.bytesWritten - m_bytesAcked, now - m_lastAckTime, now - ping.timestamp);
+
+        m_bytesAcked = ping.bytesWritten;
+        m_lastAckTime = now;
+
+        setProgress(100.0 * m_bytesAcked / m_fileSize);
+        return true;
+
+    } else if(qobject_cast<EmptyResponseInterface*>(response)) {
+        setProgress(100.0);
+        return true;
+    }
+
+    return false;
 }
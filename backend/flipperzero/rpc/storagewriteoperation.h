@@ -2,7 +2,11 @@
 
 #include "abstractstorageoperation.h"
 
+#include <QQueue>
 #include <QByteArray>
+#include <QElapsedTimer>
+
+#include "flipperzero/storagewritetuner.h"
 
 class QIODevice;
 
@@ -18,23 +22,39 @@ class StorageWriteOperation : public AbstractStorageOperation
         StatusPing
     };
 
+    struct PendingPing {
+        qint64 bytesWritten;
+        qint64 timestamp;
+    };
+
 public:
-    StorageWriteOperation(uint32_t id, const QByteArray &path, QIODevice *file, QObject *parent = nullptr);
+    StorageWriteOperation(uint32_t id, const QByteArray &path, QIODevice *file, StorageWriteTuner *tuner, QObject *parent = nullptr);
     const QString description() const override;
     bool hasMoreData() const override;
     void feedResponse(QObject *response) override;
     const QByteArray encodeRequest(ProtobufPluginInterface *encoder) override;
+    bool encodeRequest(ProtobufPluginInterface *encoder, QByteArray &buffer) override;
+
+    const StorageWriteParameters parameters() const;
 
 private:
     bool begin() override;
     bool processResponse(QObject *response) override;
 
     QIODevice *m_file;
+    StorageWriteTuner *m_tuner;
 
     RequestType m_subRequest;
-    qint64 m_chunksPerPing;
+    bool m_isPingEnabled;
+
+    qint64 m_fileSize;
     qint64 m_chunksWritten;
-    double m_percentPerPing;
+    qint64 m_bytesWritten;
+    qint64 m_bytesAcked;
+    qint64 m_lastAckTime;
+
+    QElapsedTimer m_elapsedTimer;
+    QQueue<PendingPing> m_pendingPings;
 };
 
 }
@@ -0,0 +1,334 @@
+#include "rpcmetrics.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <QTextStream>
+
+#include "rpc/abstractprotobufoperation.h"
+
+using namespace Flipper;
+using namespace Zero;
+
+LatencyHistogram::LatencyHistogram()
+{
+    clear();
+}
+
+void LatencyHistogram::record(qint64 usec)
+{
+    usec = qMax<qint64>(0, usec);
+
+    // Bucket n holds the values in range [2^(n-1), 2^n)
+    int bucket = 0;
+    for(auto v = usec; v && bucket < BUCKET_COUNT - 1; v >>= 1) {
+        ++bucket;
+    }
+
+    ++m_buckets[bucket];
+    m_sum += usec;
+    m_min = m_count ? qMin(m_min, usec) : usec;
+    m_max = m_count ? qMax(m_max, usec) : usec;
+    ++m_count;
+}
+
+void LatencyHistogram::clear()
+{
+    std::fill(std::begin(m_buckets), std::end(m_buckets), 0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+qint64 LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+qint64 LatencyHistogram::sum() const
+{
+    return m_sum;
+}
+
+qint64 LatencyHistogram::min() const
+{
+    return m_min;
+}
+
+qint64 LatencyHistogram::max() const
+{
+    return m_max;
+}
+
+qint64 LatencyHistogram::mean() const
+{
+    return m_count ? m_sum / m_count : 0;
+}
+
+qint64 LatencyHistogram::percentile(double fraction) const
+{
+    if(!m_count) {
+        return 0;
+    }
+
+    const auto target = qMax<qint64>(1, std::ceil(m_count * fraction));
+    qint64 seen = 0;
+
+    for(auto i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i];
+
+        if(seen >= target) {
+            const auto upperBound = i ? (qint64(1) << i) - 1 : 0;
+            return qBound(m_min, upperBound, m_max);
+        }
+    }
+
+    return m_max;
+}
+
+RpcMetrics::RpcMetrics(QObject *parent):
+    QAbstractListModel(parent)
+{
+    m_clock.start();
+}
+
+void RpcMetrics::operationQueued(AbstractProtobufOperation *operation)
+{
+    m_timings[operation->id()].queuedAt = now();
+}
+
+void RpcMetrics::operationStarted(AbstractProtobufOperation *operation)
+{
+    m_timings[operation->id()].startedAt = now();
+}
+
+void RpcMetrics::operationDropped(AbstractProtobufOperation *operation)
+{
+    m_timings.remove(operation->id());
+}
+
+void RpcMetrics::operationFinished(AbstractProtobufOperation *operation)
+{
+    const auto it = m_timings.constFind(operation->id());
+
+    if(it == m_timings.constEnd() || it->startedAt < 0) {
+        return;
+    }
+
+    const auto timing = it.value();
+    m_timings.erase(it);
+
+    const auto name = operationName(operation);
+    const auto isNew = !m_rows.contains(name);
+
+    if(isNew) {
+        beginInsertRows(QModelIndex(), m_entries.size(), m_entries.size());
+    }
+
+    auto &e = entry(name);
+
+    ++e.count;
+
+    if(operation->error() == BackendError::TimeoutError) {
+        ++e.timeoutCount;
+    } else if(operation->isError()) {
+        ++e.errorCount;
+    }
+
+    e.bytesOut += timing.bytesOut;
+    e.bytesIn += timing.bytesIn;
+
+    if(timing.queuedAt >= 0) {
+        e.queueWait.record(timing.startedAt - timing.queuedAt);
+    }
+
+    if(timing.firstResponseAt >= 0) {
+        e.firstResponse.record(timing.firstResponseAt - timing.startedAt);
+    }
+
+    if(timing.bytesIn) {
+        e.decodeTime.record(timing.decodeTime);
+    }
+
+    e.duration.record(now() - timing.startedAt);
+
+    if(isNew) {
+        endInsertRows();
+    } else {
+        const auto idx = index(m_rows.value(name));
+        emit dataChanged(idx, idx);
+    }
+}
+
+void RpcMetrics::requestSent(uint32_t id, qint64 size)
+{
+    const auto it = m_timings.find(id);
+
+    if(it != m_timings.end()) {
+        it->bytesOut += size;
+    }
+}
+
+void RpcMetrics::responseReceived(uint32_t id, qint64 size, qint64 decodeTime)
+{
+    const auto it = m_timings.find(id);
+
+    if(it == m_timings.end()) {
+        return;
+    } else if(it->firstResponseAt < 0) {
+        it->firstResponseAt = now();
+    }
+
+    it->bytesIn += size;
+    it->decodeTime += decodeTime;
+}
+
+void RpcMetrics::reset()
+{
+    // Timings of the operations in progress are kept
+    beginResetModel();
+    m_entries.clear();
+    m_rows.clear();
+    endResetModel();
+}
+
+const QString RpcMetrics::summary() const
+{
+    QString ret;
+    QTextStream s(&ret);
+
+    s << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11")
+         .arg(QStringLiteral("Operation"), -24)
+         .arg(QStringLiteral("Count"), 6)
+         .arg(QStringLiteral("Err"), 4)
+         .arg(QStringLiteral("T/O"), 4)
+         .arg(QStringLiteral("Out, B"), 10)
+         .arg(QStringLiteral("In, B"), 10)
+         .arg(QStringLiteral("Wait p50"), 9)
+         .arg(QStringLiteral("First p50"), 9)
+         .arg(QStringLiteral("Dur p50"), 9)
+         .arg(QStringLiteral("Dur p95"), 9)
+         .arg(QStringLiteral("Decode"), 9) << '\n';
+
+    for(const auto &e : m_entries) {
+        s << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11")
+             .arg(e.name, -24)
+             .arg(e.count, 6)
+             .arg(e.errorCount, 4)
+             .arg(e.timeoutCount, 4)
+             .arg(e.bytesOut, 10)
+             .arg(e.bytesIn, 10)
+             .arg(toMsec(e.queueWait.percentile(0.5)), 9, 'f', 2)
+             .arg(toMsec(e.firstResponse.percentile(0.5)), 9, 'f', 2)
+             .arg(toMsec(e.duration.percentile(0.5)), 9, 'f', 2)
+             .arg(toMsec(e.duration.percentile(0.95)), 9, 'f', 2)
+             .arg(toMsec(e.decodeTime.mean()), 9, 'f', 3) << '\n';
+    }
+
+    s << QStringLiteral("(times in milliseconds, decode time is mean per operation)");
+    return ret;
+}
+
+int RpcMetrics::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return m_entries.size();
+}
+
+QVariant RpcMetrics::data(const QModelIndex &index, int role) const
+{
+    const auto row = index.row();
+
+    if(row < 0 || row >= m_entries.size()) {
+        return QVariant();
+    }
+
+    const auto &e = m_entries.at(row);
+
+    switch(role) {
+    case NameRole:
+        return e.name;
+    case CountRole:
+        return e.count;
+    case ErrorCountRole:
+        return e.errorCount;
+    case TimeoutCountRole:
+        return e.timeoutCount;
+    case BytesOutRole:
+        return e.bytesOut;
+    case BytesInRole:
+        return e.bytesIn;
+    case ThroughputRole:
+        // Bytes per second, both directions combined
+        return e.duration.sum() ? (e.bytesOut + e.bytesIn) * 1000000.0 / e.duration.sum() : 0.0;
+    case QueueWaitRole:
+        return toMsec(e.queueWait.percentile(0.5));
+    case FirstResponseRole:
+        return toMsec(e.firstResponse.percentile(0.5));
+    case DurationRole:
+        return toMsec(e.duration.percentile(0.5));
+    case DurationP95Role:
+        return toMsec(e.duration.percentile(0.95));
+    case DecodeTimeRole:
+        return toMsec(e.decodeTime.mean());
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> RpcMetrics::roleNames() const
+{
+    return {
+        {NameRole, QByteArrayLiteral("name")},
+        {CountRole, QByteArrayLiteral("count")},
+        {ErrorCountRole, QByteArrayLiteral("errorCount")},
+        {TimeoutCountRole, QByteArrayLiteral("timeoutCount")},
+        {BytesOutRole, QByteArrayLiteral("bytesOut")},
+        {BytesInRole, QByteArrayLiteral("bytesIn")},
+        {ThroughputRole, QByteArrayLiteral("throughput")},
+        {QueueWaitRole, QByteArrayLiteral("queueWait")},
+        {FirstResponseRole, QByteArrayLiteral("firstResponse")},
+        {DurationRole, QByteArrayLiteral("duration")},
+        {DurationP95Role, QByteArrayLiteral("durationP95")},
+        {DecodeTimeRole, QByteArrayLiteral("decodeTime")}
+    };
+}
+
+const QString RpcMetrics::operationName(AbstractProtobufOperation *operation)
+{
+    // Flipper::Zero::StorageReadOperation -> StorageRead
+    auto name = QString::fromLatin1(operation->metaObject()->className());
+    name = name.mid(name.lastIndexOf(QLatin1Char(':')) + 1);
+
+    if(name.endsWith(QStringLiteral("Operation"))) {
+        name.chop(9);
+    }
+
+    return name;
+}
+
+double RpcMetrics::toMsec(qint64 usec)
+{
+    return usec / 1000.0;
+}
+
+qint64 RpcMetrics::now() const
+{
+    return m_clock.nsecsElapsed() / 1000;
+}
+
+RpcMetrics::Entry &RpcMetrics::entry(const QString &name)
+{
+    const auto it = m_rows.constFind(name);
+
+    if(it != m_rows.constEnd()) {
+        return m_entries[it.value()];
+    }
+
+    m_rows.insert(name, m_entries.size());
+    m_entries.append(Entry());
+    m_entries.last().name = name;
+
+    return m_entries.last();
+}
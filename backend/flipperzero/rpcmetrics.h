@@ -0,0 +1,118 @@
+#pragma once
+
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QAbstractListModel>
+
+namespace Flipper {
+namespace Zero {
+
+class AbstractProtobufOperation;
+
+// Fixed-size histogram with power-of-two buckets, values in microseconds
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(qint64 usec);
+    void clear();
+
+    qint64 count() const;
+    qint64 sum() const;
+    qint64 min() const;
+    qint64 max() const;
+    qint64 mean() const;
+
+    // Upper bound of the bucket containing the given fraction of samples
+    qint64 percentile(double fraction) const;
+
+private:
+    static constexpr int BUCKET_COUNT = 40;
+
+    qint64 m_buckets[BUCKET_COUNT];
+    qint64 m_count;
+    qint64 m_sum;
+    qint64 m_min;
+    qint64 m_max;
+};
+
+// Per-operation type latency and throughput statistics of an RPC session
+class RpcMetrics : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum FieldRole {
+        NameRole = Qt::UserRole,
+        CountRole,
+        ErrorCountRole,
+        TimeoutCountRole,
+        BytesOutRole,
+        BytesInRole,
+        ThroughputRole,
+        QueueWaitRole,
+        FirstResponseRole,
+        DurationRole,
+        DurationP95Role,
+        DecodeTimeRole
+    };
+
+    Q_ENUM(FieldRole)
+
+    RpcMetrics(QObject *parent = nullptr);
+
+    void operationQueued(AbstractProtobufOperation *operation);
+    void operationStarted(AbstractProtobufOperation *operation);
+    void operationDropped(AbstractProtobufOperation *operation);
+    void operationFinished(AbstractProtobufOperation *operation);
+
+    void requestSent(uint32_t id, qint64 size);
+    void responseReceived(uint32_t id, qint64 size, qint64 decodeTime);
+
+    Q_INVOKABLE void reset();
+    Q_INVOKABLE const QString summary() const;
+
+    // Model API functions
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+private:
+    struct Timing {
+        qint64 queuedAt = -1;
+        qint64 startedAt = -1;
+        qint64 firstResponseAt = -1;
+        qint64 bytesOut = 0;
+        qint64 bytesIn = 0;
+        qint64 decodeTime = 0;
+    };
+
+    struct Entry {
+        QString name;
+        qint64 count = 0;
+        qint64 errorCount = 0;
+        qint64 timeoutCount = 0;
+        qint64 bytesOut = 0;
+        qint64 bytesIn = 0;
+        LatencyHistogram queueWait;
+        LatencyHistogram firstResponse;
+        LatencyHistogram duration;
+        LatencyHistogram decodeTime;
+    };
+
+    static const QString operationName(AbstractProtobufOperation *operation);
+    static double toMsec(qint64 usec);
+
+    qint64 now() const;
+    Entry &entry(const QString &name);
+
+    QElapsedTimer m_clock;
+    QHash<uint32_t, Timing> m_timings;
+    QVector<Entry> m_entries;
+    QHash<QString, int> m_rows;
+};
+
+}
+}
@@ -21,8 +21,7 @@ using namespace Zero;
 static constexpr int SCREEN_FRAME_WIDTH = 128;
 static constexpr int SCREEN_FRAME_HEIGHT = 64;
 
-// ScreenStream and VirtualDisplay formats differ
-static QByteArray transposeImage(const QByteArray &in, int width, int height)
+QByteArray ScreenStreamer::transposeImage(const QByteArray &in, int width, int height)
 {
     QByteArray out((width * height) / 8, 0x0);
 
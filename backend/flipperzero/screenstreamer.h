@@ -33,6 +33,9 @@ public:
 
     ScreenStreamer(QObject *parent = nullptr);
 
+    // ScreenStream and VirtualDisplay formats differ
+    static QByteArray transposeImage(const QByteArray &in, int width, int height);
+
     void setDevice(FlipperZero *device);
     Q_INVOKABLE void sendInputEvent(InputEvent::Key key, InputEvent::Type type);
 
@@ -0,0 +1,57 @@
+#include "serialtransport.h"
+
+#include <QSerialPort>
+#include <QLoggingCategory>
+
+#include "helper/serialinithelper.h"
+
+Q_DECLARE_LOGGING_CATEGORY(LOG_SESSION)
+
+using namespace Flipper;
+using namespace Zero;
+
+SerialTransport::SerialTransport(const QSerialPortInfo &portInfo, ProtobufPluginInterface *plugin, QObject *parent):
+    ProtobufTransport(plugin, parent),
+    m_portInfo(portInfo)
+{}
+
+void SerialTransport::open()
+{
+    auto *helper = new SerialInitHelper(m_portInfo, this);
+    connect(helper, &SerialInitHelper::finished, this, [=]() {
+        helper->deleteLater();
+
+        if(helper->isError()) {
+            emit errorOccured(helper->error(), helper->errorString());
+            return;
+        }
+
+        auto *port = helper->serialPort();
+        connect(port, &QSerialPort::errorOccurred, this, &SerialTransport::onSerialPortErrorOccured);
+
+        setDevice(port);
+        emit opened();
+    });
+}
+
+bool SerialTransport::flush()
+{
+    return serialPort()->flush() || serialPort()->error() == QSerialPort::NoError;
+}
+
+void SerialTransport::onSerialPortErrorOccured()
+{
+    if(serialPort()->error() == QSerialPort::NoError) {
+        return;
+    }
+
+    qCInfo(LOG_SESSION) << "Serial connection was lost.";
+    close();
+
+    emit connectionLost();
+}
+
+QSerialPort *SerialTransport::serialPort() const
+{
+    return qobject_cast<QSerialPort*>(device());
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "protobuftransport.h"
+
+#include <QSerialPortInfo>
+
+class QSerialPort;
+
+namespace Flipper {
+namespace Zero {
+
+class SerialTransport : public ProtobufTransport
+{
+    Q_OBJECT
+
+public:
+    SerialTransport(const QSerialPortInfo &portInfo, ProtobufPluginInterface *plugin, QObject *parent = nullptr);
+
+public slots:
+    void open() override;
+
+protected:
+    bool flush() override;
+
+private slots:
+    void onSerialPortErrorOccured();
+
+private:
+    QSerialPort *serialPort() const;
+
+    QSerialPortInfo m_portInfo;
+};
+
+}
+}
+
@@ -0,0 +1,82 @@
+#include "storagewritetuner.h"
+
+// Used when the device is too slow to keep up with the full size chunks
+static constexpr qint64 MIN_CHUNK_SIZE = 512;
+
+// Used until there is at least one measurement
+static constexpr qint64 DEFAULT_CHUNKS_PER_PING = 16;
+static constexpr qint64 CHUNKS_PER_PING_CAP = 1000;
+
+// Aim for a ping round trip every PING_INTERVAL_MS
+static constexpr double PING_INTERVAL_MS = 200.0;
+// Device is considered overrun if it takes longer than that to reply to a ping
+static constexpr double MAX_ACK_LATENCY_MS = 2000.0;
+
+// Smoothing factor for the running averages
+static constexpr double EWMA_ALPHA = 0.25;
+
+using namespace Flipper;
+using namespace Zero;
+
+StorageWriteTuner::StorageWriteTuner()
+{
+    reset();
+}
+
+qint64 StorageWriteTuner::chunkSize() const
+{
+    return m_chunkSize;
+}
+
+qint64 StorageWriteTuner::chunksPerPing() const
+{
+    return m_chunksPerPing;
+}
+
+const StorageWriteParameters StorageWriteTuner::parameters() const
+{
+    return {m_chunkSize, m_chunksPerPing, m_throughput, m_ackLatency};
+}
+
+void StorageWriteTuner::addSample(qint64 bytesAcked, qint64 elapsedMsecs, qint64 ackLatencyMsecs)
+{
+    if(bytesAcked <= 0 || elapsedMsecs <= 0) {
+        return;
+    }
+
+    const auto throughput = bytesAcked * 1000.0 / elapsedMsecs;
+
+    if(m_throughput > 0) {
+        m_throughput += EWMA_ALPHA * (throughput - m_throughput);
+        m_ackLatency += EWMA_ALPHA * (ackLatencyMsecs - m_ackLatency);
+    } else {
+        m_throughput = throughput;
+        m_ackLatency = ackLatencyMsecs;
+    }
+
+    if(m_ackLatency > MAX_ACK_LATENCY_MS && m_chunkSize > MIN_CHUNK_SIZE) {
+        // Back off and stay there for the rest of the session
+        m_chunkSize = MIN_CHUNK_SIZE;
+    }
+
+    updateChunksPerPing();
+}
+
+void StorageWriteTuner::reset()
+{
+    m_chunkSize = MAX_CHUNK_SIZE;
+    m_chunksPerPing = DEFAULT_CHUNKS_PER_PING;
+
+    m_throughput = 0;
+    m_ackLatency = 0;
+}
+
+void StorageWriteTuner::updateChunksPerPing()
+{
+    if(m_throughput <= 0) {
+        return;
+    }
+
+    const auto bytesPerPing = m_throughput * PING_INTERVAL_MS / 1000.0;
+    m_chunksPerPing = qBound<qint64>(1, (qint64)(bytesPerPing / m_chunkSize), CHUNKS_PER_PING_CAP);
+}
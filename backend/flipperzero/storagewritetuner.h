@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QtGlobal>
+
+namespace Flipper {
+namespace Zero {
+
+struct StorageWriteParameters {
+    qint64 chunkSize;
+    qint64 chunksPerPing;
+    double throughput; // bytes per second
+    double ackLatency; // milliseconds
+};
+
+// Adapts the ping cadence of storage writes to the measured throughput.
+// The chunk size only goes down from its default if the device falls behind.
+class StorageWriteTuner
+{
+public:
+    // Largest request payload the firmware is known to decode from its RPC buffer
+    static constexpr qint64 MAX_CHUNK_SIZE = 1024;
+
+    StorageWriteTuner();
+
+    qint64 chunkSize() const;
+    qint64 chunksPerPing() const;
+    const StorageWriteParameters parameters() const;
+
+    void addSample(qint64 bytesAcked, qint64 elapsedMsecs, qint64 ackLatencyMsecs);
+    void reset();
+
+private:
+    void updateChunksPerPing();
+
+    qint64 m_chunkSize;
+    qint64 m_chunksPerPing;
+
+    double m_throughput;
+    double m_ackLatency;
+};
+
+}
+}
@@ -1,7 +1,10 @@
 #include "fullupdateoperation.h"
 
 #include <QDebug>
+#include <QDateTime>
+#include <QFileInfo>
 #include <QDirIterator>
+#include <QCryptographicHash>
 #include <QLoggingCategory>
 
 #include "flipperzero/devicestate.h"
@@ -28,6 +31,13 @@ static inline const QString getBaseName(const QString &url)
     return url.mid(start, end - start);
 }
 
+// Bundles with the same name but different contents get different directories
+static inline const QString getDirectoryName(const QString &baseName, const QByteArray &contentKey)
+{
+    const auto hash = QCryptographicHash::hash(contentKey, QCryptographicHash::Sha1).toHex().left(12);
+    return QStringLiteral("%1-%2").arg(baseName, QString::fromLatin1(hash));
+}
+
 using namespace Flipper;
 using namespace Zero;
 
@@ -144,7 +154,10 @@ void FullUpdateOperation::fetchUpdateFile()
     }
 
     m_updateFile = globalTempDirs->createTempFile(this);
-    m_updateDirectory = globalTempDirs->subdir(getBaseName(fileInfo.url()));
+
+    // Without a checksum there is no telling whether two downloads are the same
+    const auto contentKey = fileInfo.sha256().isEmpty() ? m_updateFile->fileName().toUtf8() : fileInfo.sha256();
+    m_updateDirectory = globalTempDirs->subdir(getDirectoryName(getBaseName(fileInfo.url()), contentKey));
 
     auto *fetcher = new RemoteFileFetcher(this);
     if(!fetcher->fetch(fileInfo, m_updateFile)) {
@@ -170,7 +183,13 @@ void FullUpdateOperation::fetchUpdateFile()
 void FullUpdateOperation::prepareLocalUpdate()
 {
     deviceState()->setStatusString(QStringLiteral("Preparing local firmware update..."));
-    m_updateDirectory = globalTempDirs->subdir(getBaseName(m_updateFile->fileName()));
+
+    // A rebuilt bundle may keep its name, so tell the versions apart by size and time
+    const QFileInfo fileInfo(*m_updateFile);
+    const auto contentKey = QStringLiteral("%1:%2:%3").arg(fileInfo.absoluteFilePath()).arg(fileInfo.size())
+                                                      .arg(fileInfo.lastModified().toMSecsSinceEpoch()).toUtf8();
+
+    m_updateDirectory = globalTempDirs->subdir(getDirectoryName(getBaseName(m_updateFile->fileName()), contentKey));
     advanceOperationState();
 }
 
@@ -179,12 +198,28 @@ void FullUpdateOperation::extractUpdate()
     deviceState()->setStatusString(QStringLiteral("Extracting firmware update ..."));
     deviceState()->setProgress(-1.0);
 
+    const auto directoryPath = m_updateDirectory.absolutePath();
+
+    if(extractedDirectories().contains(directoryPath)) {
+        qCDebug(CATEGORY_DEBUG) << "Update package has been already extracted, skipping...";
+        advanceOperationState();
+        return;
+
+    } else if(auto *uncompressor = extractions().value(directoryPath)) {
+        waitForExtraction(uncompressor);
+        return;
+    }
+
     auto *uncompressor = new TarZipUncompressor(m_updateFile, m_updateDirectory, this);
+    extractions().insert(directoryPath, uncompressor);
 
     connect(uncompressor, &TarZipUncompressor::finished, this, [=]() {
+        extractions().remove(directoryPath);
+
         if(uncompressor->isError()) {
             finishWithError(uncompressor->error(), uncompressor->errorString());
         } else {
+            extractedDirectories().insert(directoryPath);
             advanceOperationState();
         }
 
@@ -192,6 +227,38 @@ void FullUpdateOperation::extractUpdate()
     });
 }
 
+QHash<QString, QPointer<TarZipUncompressor>> &FullUpdateOperation::extractions()
+{
+    static QHash<QString, QPointer<TarZipUncompressor>> uncompressors;
+    return uncompressors;
+}
+
+QSet<QString> &FullUpdateOperation::extractedDirectories()
+{
+    static QSet<QString> directories;
+    return directories;
+}
+
+void FullUpdateOperation::waitForExtraction(TarZipUncompressor *uncompressor)
+{
+    qCDebug(CATEGORY_DEBUG) << "Update package is being extracted for another device, waiting...";
+
+    connect(uncompressor, &TarZipUncompressor::finished, this, [=]() {
+        uncompressor->disconnect(this);
+
+        if(uncompressor->isError()) {
+            finishWithError(uncompressor->error(), uncompressor->errorString());
+        } else {
+            advanceOperationState();
+        }
+    });
+
+    connect(uncompressor, &QObject::destroyed, this, [=]() {
+        // The other operation has been aborted midway, start over
+        extractUpdate();
+    });
+}
+
 void FullUpdateOperation::readUpdateFiles()
 {
     deviceState()->setStatusString(QStringLiteral("Reading firmware update ..."));
@@ -4,11 +4,15 @@
 
 #include <QDir>
 #include <QUrl>
+#include <QSet>
+#include <QHash>
+#include <QPointer>
 #include <QFileInfoList>
 
 #include "flipperupdates.h"
 
 class QFile;
+class TarZipUncompressor;
 
 namespace Flipper {
 namespace Zero {
@@ -53,6 +57,12 @@ private:
     void uploadUpdateFiles();
     void startUpdate();
 
+    // Update bundles being extracted, shared by the operations running on different devices
+    static QHash<QString, QPointer<TarZipUncompressor>> &extractions();
+    static QSet<QString> &extractedDirectories();
+
+    void waitForExtraction(TarZipUncompressor *uncompressor);
+
     QFile *m_updateFile;
     QDir m_updateDirectory;
     QList<QUrl> m_fileUrls;
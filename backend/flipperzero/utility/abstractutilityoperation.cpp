@@ -1,8 +1,12 @@
 #include "abstractutilityoperation.h"
 
 #include <QTimer>
+#include <QLoggingCategory>
 
 #include "flipperzero/devicestate.h"
+#include "flipperzero/protobufsession.h"
+
+Q_DECLARE_LOGGING_CATEGORY(LOG_UTILITY)
 
 using namespace Flipper;
 using namespace Zero;
@@ -37,3 +41,12 @@ void AbstractUtilityOperation::advanceOperationState()
 {
     QTimer::singleShot(0, this, &AbstractUtilityOperation::nextStateLogic);
 }
+
+void AbstractUtilityOperation::reportWriteParameters() const
+{
+    const auto params = m_rpc->storageWriteParameters();
+
+    qCDebug(LOG_UTILITY).noquote() << QStringLiteral("%1: write chunk size %2 bytes, %3 chunks per ping, %4 KiB/s, ack latency %5 ms")
+                                      .arg(description()).arg(params.chunkSize).arg(params.chunksPerPing)
+                                      .arg(params.throughput / 1024.0, 0, 'f', 1).arg(params.ackLatency, 0, 'f', 0);
+}
@@ -23,6 +23,7 @@ public:
 
 protected:
     void advanceOperationState();
+    void reportWriteParameters() const;
 
 private slots:
     virtual void nextStateLogic() = 0;
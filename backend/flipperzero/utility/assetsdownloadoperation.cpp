@@ -44,7 +44,8 @@ AssetsDownloadOperation::AssetsDownloadOperation(ProtobufSession *rpc, DeviceSta
     AbstractUtilityOperation(rpc, deviceState, parent),
     m_compressedFile(compressedFile),
     m_uncompressedFile(new QFile(globalTempDirs->root().absoluteFilePath(QStringLiteral("qFlipper-databases.tar")), this)),
-    m_isDeviceManifestPresent(false)
+    m_isDeviceManifestPresent(false),
+    m_pendingCount(0)
 {}
 
 AssetsDownloadOperation::~AssetsDownloadOperation()
@@ -90,6 +91,7 @@ void AssetsDownloadOperation::nextStateLogic()
         writeFiles();
 
     } else if(operationState() == State::WritingFiles) {
+        reportWriteParameters();
         cleanup();
         finish();
     }
@@ -253,25 +255,31 @@ void AssetsDownloadOperation::deleteFiles()
     if(m_deleteList.isEmpty()) {
         qCDebug(CATEGORY_ASSETS) << "No files to delete, skipping to write";
         advanceOperationState();
+        return;
     }
 
     deviceState()->setStatusString(tr("Deleting unneeded files..."));
 
-    auto filesRemaining = m_deleteList.size();
-    const auto increment = 100.0 / filesRemaining;
+    m_pendingCount = m_deleteList.size();
+    const auto increment = 100.0 / m_pendingCount;
 
     for(const auto &fileInfo : qAsConst(m_deleteList)) {
-        const auto isLastFile = (--filesRemaining == 0);
         const auto fileName = QByteArrayLiteral("/ext/") + fileInfo.absolutePath.toLocal8Bit();
 
         auto *operation = rpc()->storageRemove(fileName);
 
         connect(operation, &AbstractOperation::finished, this, [=]() {
-            deviceState()->setProgress(100.0 - increment * filesRemaining);
+            // Pipelined siblings may still finish after an error
+            if(isFinished()) {
+                return;
+            }
+
+            --m_pendingCount;
+            deviceState()->setProgress(100.0 - increment * m_pendingCount);
 
             if(operation->isError()) {
                 finishWithError(operation->error(), operation->errorString());
-            } else if(isLastFile) {
+            } else if(!m_pendingCount) {
                 advanceOperationState();
             }
         });
@@ -283,16 +291,15 @@ void AssetsDownloadOperation::writeFiles()
     if(m_writeList.isEmpty()) {
         qCDebug(CATEGORY_ASSETS) << "No files to write, skipping to the end";
         advanceOperationState();
+        return;
     }
 
     deviceState()->setStatusString(tr("Installing databases..."));
 
-    auto filesRemaining = m_writeList.size();
-    const auto increment = 100.0 / filesRemaining;
+    m_pendingCount = m_writeList.size();
+    const auto increment = 100.0 / m_pendingCount;
 
     for(const auto &fileInfo : qAsConst(m_writeList)) {
-        --filesRemaining;
-
         AbstractOperation *op;
         const auto filePath = QByteArrayLiteral("/ext/") + fileInfo.absolutePath.toLocal8Bit();
 
@@ -322,11 +329,17 @@ void AssetsDownloadOperation::writeFiles()
         }
 
         connect(op, &AbstractOperation::finished, this, [=]() {
-            deviceState()->setProgress(100.0 - increment * filesRemaining);
+            // Pipelined siblings may still finish after an error
+            if(isFinished()) {
+                return;
+            }
+
+            --m_pendingCount;
+            deviceState()->setProgress(100.0 - increment * m_pendingCount);
 
             if(op->isError()) {
                 finishWithError(op->error(), op->errorString());
-            } else if(filesRemaining == 0) {
+            } else if(!m_pendingCount) {
                 advanceOperationState();
             }
         });
@@ -56,6 +56,7 @@ private:
 
     FileNode::FileInfoList m_deleteList;
     FileNode::FileInfoList m_writeList;
+    int m_pendingCount;
 };
 
 }
@@ -21,7 +21,8 @@ ChecksumVerifyOperation::ChecksumVerifyOperation(ProtobufSession *rpc, DeviceSta
                                                  const QList<QUrl> &urlsToCheck, const QByteArray &remoteRootPath, QObject *parent):
     AbstractUtilityOperation(rpc, deviceState, parent),
     m_remoteRootPath(remoteRootPath),
-    m_urlsToCheck(urlsToCheck)
+    m_urlsToCheck(urlsToCheck),
+    m_pendingCount(0)
 {}
 
 const QString ChecksumVerifyOperation::description() const
@@ -87,10 +88,15 @@ void ChecksumVerifyOperation::verifyMd5Sums()
         return sum + arg.fileInfo.size();
     });
 
-    auto filesRemaining = m_flatFileList.size();
+    m_pendingCount = m_flatFileList.size();
 
     setProgress(0.0);
 
+    if(!m_pendingCount) {
+        advanceOperationState();
+        return;
+    }
+
     for(const auto &entry : qAsConst(m_flatFileList)) {
         const auto &fileInfo = entry.fileInfo;
         const auto &topmostDir = entry.topmostDir;
@@ -99,12 +105,14 @@ void ChecksumVerifyOperation::verifyMd5Sums()
         const auto relativeLocalFilePath = topmostDir.relativeFilePath(absoluteLocalFilePath);
 
         const auto absoluteRemoteFilePath = m_remoteRootPath + QByteArrayLiteral("/") + relativeLocalFilePath.toLocal8Bit();
-        const auto isLastFile = (--filesRemaining == 0);
 
         auto *operation = rpc()->storageMd5Sum(absoluteRemoteFilePath);
 
         connect(operation, &AbstractOperation::finished, this, [=]() {
-            if(operation->isError()) {
+            // Pipelined siblings may still finish after an error
+            if(isFinished()) {
+                return;
+            } else if(operation->isError()) {
                 finishWithError(operation->error(), operation->errorString());
                 return;
             }
@@ -128,7 +136,7 @@ void ChecksumVerifyOperation::verifyMd5Sums()
 
             setProgress(progress() + 100.0 * fileInfo.size() / totalSize);
 
-            if(isLastFile) {
+            if(--m_pendingCount == 0) {
                 advanceOperationState();
             }
         });
@@ -42,6 +42,7 @@ private:
     QList<QUrl> m_urlsToCheck;
     QList<FileListElement> m_flatFileList;
     QList<QUrl> m_changedUrls;
+    int m_pendingCount;
 };
 
 }
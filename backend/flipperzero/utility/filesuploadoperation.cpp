@@ -16,7 +16,8 @@ FilesUploadOperation::FilesUploadOperation(ProtobufSession *rpc, DeviceState *de
     AbstractUtilityOperation(rpc, deviceState, parent),
     m_remotePath(remotePath),
     m_urlList(fileUrls),
-    m_totalSize(0)
+    m_totalSize(0),
+    m_pendingCount(0)
 {}
 
 const QString FilesUploadOperation::description() const
@@ -36,6 +37,7 @@ void FilesUploadOperation::nextStateLogic()
         writeFiles();
 
     } else if(operationState() == WritingFiles) {
+        reportWriteParameters();
         finish();
     }
 }
@@ -74,7 +76,6 @@ void FilesUploadOperation::readFileList()
 
 void FilesUploadOperation::writeFiles()
 {
-    auto fileCountLeft = m_fileList.size();
     auto fileProgress = 0.0;
 
     for(const auto &entry: qAsConst(m_fileList)) {
@@ -86,7 +87,6 @@ void FilesUploadOperation::writeFiles()
 
         const auto absoluteRemotePath = m_remotePath + QByteArrayLiteral("/") + relativeLocalPath.toLocal8Bit();
         const auto sizeRatio = (double)fileInfo.size() / m_totalSize;
-        const auto isLastEntry = (--fileCountLeft == 0);
 
         if(fileInfo.isFile()) {
             auto *file = new QFile(absoluteLocalPath, this);
@@ -96,25 +96,29 @@ void FilesUploadOperation::writeFiles()
                 setProgress(fileProgress + operation->progress() * sizeRatio);
             });
 
-            connect(operation, &AbstractOperation::finished, this, [=]() {
-                if(operation->isError()) {
-                    finishWithError(operation->error(), operation->errorString());
-                } else if(isLastEntry) {
-                    advanceOperationState();
-                }
-            });
+            connect(operation, &AbstractOperation::finished, this, &FilesUploadOperation::onEntryFinished);
+            ++m_pendingCount;
 
         } else if(fileInfo.isDir()) {
             auto *operation = rpc()->storageMkdir(absoluteRemotePath);
-            connect(operation, &AbstractOperation::finished, this, [=]() {
-                if(operation->isError()) {
-                    finishWithError(operation->error(), operation->errorString());
-                } else if(isLastEntry) {
-                    advanceOperationState();
-                }
-            });
+            connect(operation, &AbstractOperation::finished, this, &FilesUploadOperation::onEntryFinished);
+            ++m_pendingCount;
         }
 
         fileProgress += 100.0 * sizeRatio;
     }
 }
+
+void FilesUploadOperation::onEntryFinished()
+{
+    auto *operation = qobject_cast<AbstractOperation*>(sender());
+
+    // Pipelined siblings may still finish after an error
+    if(isFinished()) {
+        return;
+    } else if(operation->isError()) {
+        finishWithError(operation->error(), operation->errorString());
+    } else if(--m_pendingCount == 0) {
+        advanceOperationState();
+    }
+}
@@ -30,6 +30,7 @@ public:
 
 private slots:
     void nextStateLogic() override;
+    void onEntryFinished();
 
 private:
     void readFileList();
@@ -39,6 +40,7 @@ private:
     QList<QUrl> m_urlList;
     QList<FileListElement> m_fileList;
     qint64 m_totalSize;
+    int m_pendingCount;
 };
 
 }
@@ -25,7 +25,11 @@ const FileInfoList &GetFileTreeOperation::files() const
 
 void GetFileTreeOperation::nextStateLogic()
 {
-    if(operationState() == BasicOperationState::Ready) {
+    if(isFinished()) {
+        // Pipelined siblings may still finish after an error
+        return;
+
+    } else if(operationState() == BasicOperationState::Ready) {
         setOperationState(State::Running);
         listDirectory(m_rootPath);
 
@@ -20,7 +20,8 @@ UserRestoreOperation::UserRestoreOperation(ProtobufSession *rpc, DeviceState *de
     m_backupUrl(backupUrl),
     m_tempDir(QStringLiteral("%1/%2-backup-XXXXXX").arg(globalTempDirs->root().absolutePath(), deviceState->deviceInfo().name)),
     m_workDir(m_tempDir.path()),
-    m_remoteDirName(QByteArrayLiteral("/int"))
+    m_remoteDirName(QByteArrayLiteral("/int")),
+    m_pendingCount(0)
 {
     m_workDir.setFilter(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden);
     m_workDir.setSorting(QDir::Name | QDir::DirsFirst);
@@ -97,16 +98,18 @@ void UserRestoreOperation::deleteFiles()
 {
     deviceState()->setStatusString(tr("Cleaning up..."));
 
-    auto numFiles = m_files.size();
+    m_pendingCount = m_files.size();
     for(const auto &fileInfo : qAsConst(m_files)) {
         const auto filePath = QByteArrayLiteral("/") + m_workDir.relativeFilePath(fileInfo.absoluteFilePath()).toLocal8Bit();
-        const auto isLastFile = (--numFiles == 0);
 
         auto *op = rpc()->storageRemove(filePath);
         connect(op, &AbstractOperation::finished, this, [=]() {
-            if(op->isError()) {
+            // Pipelined siblings may still finish after an error
+            if(isFinished()) {
+                return;
+            } else if(op->isError()) {
                 finishWithError(BackendError::OperationError, op->errorString());
-            } else if(isLastFile) {
+            } else if(--m_pendingCount == 0) {
                 advanceOperationState();
             }
         });
@@ -117,11 +120,10 @@ void UserRestoreOperation::writeFiles()
 {
     deviceState()->setStatusString(tr("Restoring backup..."));
 
-    auto numFiles = m_files.size();
+    m_pendingCount = m_files.size();
 
     for(const auto &fileInfo: qAsConst(m_files)) {
         const auto filePath = QByteArrayLiteral("/") + m_workDir.relativeFilePath(fileInfo.absoluteFilePath()).toLocal8Bit();
-        const auto isLastFile = (--numFiles == 0);
 
         AbstractOperation *op;
 
@@ -141,13 +143,16 @@ void UserRestoreOperation::writeFiles()
         }
 
         connect(op, &AbstractOperation::finished, this, [=]() {
-            if(op->isError()) {
+            op->deleteLater();
+
+            // Pipelined siblings may still finish after an error
+            if(isFinished()) {
+                return;
+            } else if(op->isError()) {
                 finishWithError(BackendError::OperationError, op->errorString());
-            } else if(isLastFile) {
+            } else if(--m_pendingCount == 0) {
                 advanceOperationState();
             }
-
-            op->deleteLater();
         });
     }
 }
@@ -34,6 +34,7 @@ private:
     QDir m_workDir;
     QByteArray m_remoteDirName;
     QFileInfoList m_files;
+    int m_pendingCount;
 
     void uncompressArchive();
     void readBackupDir();
@@ -7,6 +7,8 @@
 #define CHECK_APPLICATION_UPDATES_KEY (QStringLiteral("CheckApplicatonUpdates"))
 #define SHOW_HIDDEN_FILES_KEY (QStringLiteral("ShowHiddenFiles"))
 #define LAST_FOLDER_URL_KEY (QStringLiteral("LastFolderUrl"))
+#define VERIFY_FIRMWARE_KEY (QStringLiteral("VerifyFirmware"))
+#define DIFFERENTIAL_FLASHING_KEY (QStringLiteral("DifferentialFlashing"))
 
 #define SET_DEFAULT_VALUE(key, value)\
     if(!m_settings.contains(key)) {\
@@ -21,6 +23,8 @@ Preferences::Preferences(QObject *parent):
     SET_DEFAULT_VALUE(CHECK_APPLICATION_UPDATES_KEY, true);
     SET_DEFAULT_VALUE(SHOW_HIDDEN_FILES_KEY, false);
     SET_DEFAULT_VALUE(LAST_FOLDER_URL_KEY, QStandardPaths::writableLocation(QStandardPaths::HomeLocation));
+    SET_DEFAULT_VALUE(VERIFY_FIRMWARE_KEY, false);
+    SET_DEFAULT_VALUE(DIFFERENTIAL_FLASHING_KEY, false);
 }
 
 Preferences *Preferences::instance()
@@ -93,6 +97,36 @@ void Preferences::setShowHiddenFiles(bool set)
     emit showHiddenFilesChanged();
 }
 
+bool Preferences::verifyFirmware() const
+{
+    return m_settings.value(VERIFY_FIRMWARE_KEY).toBool();
+}
+
+void Preferences::setVerifyFirmware(bool set)
+{
+    if(set == verifyFirmware()) {
+        return;
+    }
+
+    m_settings.setValue(VERIFY_FIRMWARE_KEY, set);
+    emit verifyFirmwareChanged();
+}
+
+bool Preferences::differentialFlashing() const
+{
+    return m_settings.value(DIFFERENTIAL_FLASHING_KEY).toBool();
+}
+
+void Preferences::setDifferentialFlashing(bool set)
+{
+    if(set == differentialFlashing()) {
+        return;
+    }
+
+    m_settings.setValue(DIFFERENTIAL_FLASHING_KEY, set);
+    emit differentialFlashingChanged();
+}
+
 QUrl Preferences::lastFolderUrl() const
 {
     return QUrl::fromLocalFile(m_settings.value(LAST_FOLDER_URL_KEY).toString());
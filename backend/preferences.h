@@ -11,6 +11,8 @@ class Preferences : public QObject
     Q_PROPERTY(QString appUpdateChannel READ applicationUpdateChannel WRITE setApplicationUpdateChannel NOTIFY applicationUpdateChannelChanged)
     Q_PROPERTY(bool checkAppUpdates READ checkApplicationUpdates WRITE setCheckApplicationUpdates NOTIFY checkApplicationUpdatesChanged)
     Q_PROPERTY(bool showHiddenFiles READ showHiddenFiles WRITE setShowHiddenFiles NOTIFY showHiddenFilesChanged)
+    Q_PROPERTY(bool verifyFirmware READ verifyFirmware WRITE setVerifyFirmware NOTIFY verifyFirmwareChanged)
+    Q_PROPERTY(bool differentialFlashing READ differentialFlashing WRITE setDifferentialFlashing NOTIFY differentialFlashingChanged)
 
     Preferences(QObject *parent = nullptr);
 
@@ -29,6 +31,12 @@ public:
     bool showHiddenFiles() const;
     void setShowHiddenFiles(bool set);
 
+    bool verifyFirmware() const;
+    void setVerifyFirmware(bool set);
+
+    bool differentialFlashing() const;
+    void setDifferentialFlashing(bool set);
+
     QUrl lastFolderUrl() const;
     void setLastFolderUrl(const QUrl &url);
 
@@ -37,6 +45,8 @@ signals:
     void applicationUpdateChannelChanged();
     void checkApplicationUpdatesChanged();
     void showHiddenFilesChanged();
+    void verifyFirmwareChanged();
+    void differentialFlashingChanged();
     void lastFolderUrlChanged();
 
 private:
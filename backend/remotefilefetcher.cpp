@@ -1,16 +1,23 @@
 #include "remotefilefetcher.h"
 
+#include <QLoggingCategory>
 #include <QNetworkAccessManager>
 #include <QCryptographicHash>
 #include <QNetworkReply>
 
 #include "debug.h"
 
+#define SHARED_FILE_CHUNK_SIZE (64 * 1024)
+
+Q_DECLARE_LOGGING_CATEGORY(CATEGORY_UPDATES)
+
 using namespace Flipper;
 
 RemoteFileFetcher::RemoteFileFetcher(QObject *parent):
     QObject(parent),
-    m_manager(new QNetworkAccessManager(this))
+    m_manager(new QNetworkAccessManager(this)),
+    m_outputFile(nullptr),
+    m_isSharedFileOwner(false)
 {}
 
 RemoteFileFetcher::RemoteFileFetcher(const QString &remoteUrl, QIODevice *outputFile, QObject *parent):
@@ -32,6 +39,7 @@ bool RemoteFileFetcher::fetch(const QString &remoteUrl, QIODevice *outputFile)
         return false;
     }
 
+    m_outputFile = outputFile;
     auto *reply = m_manager->get(QNetworkRequest(remoteUrl));
 
     if(reply->error() != QNetworkReply::NoError) {
@@ -71,6 +79,14 @@ bool RemoteFileFetcher::fetch(const QString &remoteUrl, QIODevice *outputFile)
             outputFile->close();
         }
 
+        if(m_isSharedFileOwner) {
+            m_isSharedFileOwner = false;
+            sharedDownloads().remove(m_expectedChecksum);
+
+            // Hand the file over before the caller gets to do anything with it
+            emit sharedFileReady();
+        }
+
         emit finished();
     });
 
@@ -83,10 +99,77 @@ bool RemoteFileFetcher::fetch(const QString &remoteUrl, QIODevice *outputFile)
 bool RemoteFileFetcher::fetch(const Flipper::Updates::FileInfo &fileInfo, QIODevice *outputFile)
 {
     m_expectedChecksum = fileInfo.sha256();
-    return fetch(fileInfo.url(), outputFile);
+
+    if(m_expectedChecksum.isEmpty()) {
+        return fetch(fileInfo.url(), outputFile);
+    }
+
+    if(auto *fetcher = sharedDownloads().value(m_expectedChecksum)) {
+        waitForSharedFile(fetcher, fileInfo, outputFile);
+        return true;
+    }
+
+    m_isSharedFileOwner = fetch(fileInfo.url(), outputFile);
+
+    if(m_isSharedFileOwner) {
+        sharedDownloads().insert(m_expectedChecksum, this);
+    }
+
+    return m_isSharedFileOwner;
 }
 
 void RemoteFileFetcher::onDownloadProgress(qint64 received, qint64 total)
 {
     emit progressChanged(((double)received / (double)total) * 100.0);
 }
+
+QHash<QByteArray, QPointer<RemoteFileFetcher>> &RemoteFileFetcher::sharedDownloads()
+{
+    static QHash<QByteArray, QPointer<RemoteFileFetcher>> downloads;
+    return downloads;
+}
+
+void RemoteFileFetcher::waitForSharedFile(RemoteFileFetcher *fetcher, const Updates::FileInfo &fileInfo, QIODevice *outputFile)
+{
+    qCDebug(CATEGORY_UPDATES).noquote() << "Waiting for an ongoing download of" << fileInfo.url();
+
+    connect(fetcher, &RemoteFileFetcher::progressChanged, this, &RemoteFileFetcher::progressChanged);
+
+    connect(fetcher, &RemoteFileFetcher::sharedFileReady, this, [=]() {
+        fetcher->disconnect(this);
+
+        if(fetcher->isError()) {
+            setError(fetcher->error(), fetcher->errorString());
+            emit finished();
+        } else {
+            copySharedFile(fetcher->m_outputFile, outputFile);
+        }
+    });
+
+    connect(fetcher, &QObject::destroyed, this, [=]() {
+        // The download was cancelled by its owner, do it ourselves
+        fetch(fileInfo, outputFile);
+    });
+}
+
+void RemoteFileFetcher::copySharedFile(QIODevice *sourceFile, QIODevice *outputFile)
+{
+    if(!sourceFile->open(QIODevice::ReadOnly)) {
+        setError(BackendError::DiskError, QStringLiteral("Failed to open file for reading: %1.").arg(sourceFile->errorString()));
+    } else if(!outputFile->open(QIODevice::WriteOnly)) {
+        setError(BackendError::DiskError, QStringLiteral("Failed to open file for writing: %1.").arg(outputFile->errorString()));
+    } else {
+        while(!sourceFile->atEnd()) {
+            if(outputFile->write(sourceFile->read(SHARED_FILE_CHUNK_SIZE)) < 0) {
+                setError(BackendError::DiskError, QStringLiteral("Failed to write to file: %1.").arg(outputFile->errorString()));
+                break;
+            }
+        }
+    }
+
+    sourceFile->close();
+    outputFile->close();
+
+    emit progressChanged(100.0);
+    emit finished();
+}
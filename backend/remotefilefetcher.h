@@ -1,6 +1,8 @@
 #pragma once
 
+#include <QHash>
 #include <QObject>
+#include <QPointer>
 
 #include "failable.h"
 #include "flipperupdates.h"
@@ -22,11 +24,22 @@ public:
 signals:
     void progressChanged(double);
     void finished();
+    // Emitted by the owner of a shared download right before finished()
+    void sharedFileReady();
 
 private slots:
     void onDownloadProgress(qint64 received, qint64 total);
 
 private:
+    // Files with a known checksum that are being downloaded. Fetchers asking for the same file
+    // meanwhile get a copy of it, e.g. when updating several devices at once
+    static QHash<QByteArray, QPointer<RemoteFileFetcher>> &sharedDownloads();
+
+    void waitForSharedFile(RemoteFileFetcher *fetcher, const Flipper::Updates::FileInfo &fileInfo, QIODevice *outputFile);
+    void copySharedFile(QIODevice *sourceFile, QIODevice *outputFile);
+
     QNetworkAccessManager *m_manager;
+    QIODevice *m_outputFile;
     QByteArray m_expectedChecksum;
+    bool m_isSharedFileOwner;
 };
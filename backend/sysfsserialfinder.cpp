@@ -0,0 +1,105 @@
+#include "sysfsserialfinder.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTimer>
+#include <QDebug>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QFileSystemWatcher>
+
+Q_DECLARE_LOGGING_CATEGORY(CATEGORY_DEBUG)
+
+static const auto DEVICE_DIR = QStringLiteral("/dev");
+
+SysfsSerialFinder::SysfsSerialFinder(const QString &sysfsPath, QObject *parent):
+    QObject(parent),
+    m_watcher(new QFileSystemWatcher(this)),
+    m_timer(new QTimer(this)),
+    m_sysfsPath(sysfsPath),
+    m_isFinished(false)
+{
+    // Same overall time limit as SerialFinder
+    m_timer->setSingleShot(true);
+    m_timer->start(1500);
+
+    connect(m_timer, &QTimer::timeout, this, &SysfsSerialFinder::onTimeout);
+    // Backed by inotify, new device nodes show up as directory changes
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &SysfsSerialFinder::findMatchingPort);
+
+    if(!m_watcher->addPath(DEVICE_DIR)) {
+        qCDebug(CATEGORY_DEBUG) << "Failed to watch" << DEVICE_DIR;
+    }
+
+    // The port might be there already
+    QTimer::singleShot(0, this, &SysfsSerialFinder::findMatchingPort);
+}
+
+void SysfsSerialFinder::setTimeout(int timeoutMs)
+{
+    m_timer->start(timeoutMs);
+}
+
+void SysfsSerialFinder::findMatchingPort()
+{
+    if(m_isFinished) {
+        return;
+    }
+
+    const auto name = ttyName();
+
+    if(name.isEmpty() || !QFile::exists(QDir(DEVICE_DIR).filePath(name))) {
+        return;
+    }
+
+    const QSerialPortInfo portInfo(name);
+
+    if(portInfo.isNull()) {
+        // The device node is there, but the port enumeration has not caught up yet
+        QTimer::singleShot(15, this, &SysfsSerialFinder::findMatchingPort);
+        return;
+    }
+
+    qCDebug(CATEGORY_DEBUG).noquote() << "Found serial port" << portInfo.systemLocation() << "in" << m_sysfsPath;
+    finish(portInfo);
+}
+
+void SysfsSerialFinder::onTimeout()
+{
+    qCDebug(CATEGORY_DEBUG).noquote() << "No serial port has appeared in" << m_sysfsPath;
+    finish(QSerialPortInfo());
+}
+
+const QString SysfsSerialFinder::ttyName() const
+{
+    // CDC ACM devices have their tty under an interface directory,
+    // e.g. /sys/bus/usb/devices/1-2.4/1-2.4:1.0/tty/ttyACM0
+    const QDir deviceDir(m_sysfsPath);
+    const auto interfaceFilter = QFileInfo(m_sysfsPath).fileName() + QStringLiteral(":*");
+    const auto interfaces = deviceDir.entryList({interfaceFilter}, QDir::Dirs | QDir::NoDotAndDotDot);
+
+    for(const auto &iface : interfaces) {
+        const QDir ttyDir(deviceDir.filePath(iface + QStringLiteral("/tty")));
+        const auto ttys = ttyDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+
+        if(!ttys.isEmpty()) {
+            return ttys.first();
+        }
+    }
+
+    return QString();
+}
+
+void SysfsSerialFinder::finish(const QSerialPortInfo &portInfo)
+{
+    if(m_isFinished) {
+        return;
+    }
+
+    m_isFinished = true;
+
+    m_timer->stop();
+    m_watcher->removePath(DEVICE_DIR);
+
+    emit finished(portInfo);
+}
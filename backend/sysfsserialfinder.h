@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QObject>
+#include <QSerialPortInfo>
+
+class QTimer;
+class QFileSystemWatcher;
+
+// Linux-only: finds the tty belonging to a USB device by looking into its sysfs directory.
+// Waits for the device node to appear in /dev instead of enumerating all serial ports repeatedly.
+class SysfsSerialFinder : public QObject
+{
+    Q_OBJECT
+
+public:
+    SysfsSerialFinder(const QString &sysfsPath, QObject *parent = nullptr);
+
+    void setTimeout(int timeoutMs);
+
+signals:
+    void finished(const QSerialPortInfo&);
+
+private slots:
+    void findMatchingPort();
+    void onTimeout();
+
+private:
+    const QString ttyName() const;
+    void finish(const QSerialPortInfo &portInfo);
+
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_timer;
+    QString m_sysfsPath;
+    bool m_isFinished;
+};
@@ -0,0 +1,8 @@
+QT -= gui
+
+include(../benchmarks.pri)
+
+TARGET = bench_archive
+
+SOURCES += \
+    tst_archive.cpp
@@ -0,0 +1,101 @@
+#include <QtTest>
+#include <QBuffer>
+#include <QTemporaryDir>
+
+#include "benchmarkdata.h"
+#include "benchmarkreport.h"
+
+#include "tararchive.h"
+#include "gzipuncompressor.h"
+
+// Roughly the shape of the assets bundle. Sizes that are multiples
+// of the tar block size are avoided on purpose, see TarArchive.
+static constexpr int DIR_COUNT = 20;
+static constexpr int FILES_PER_DIR = 25;
+static constexpr int FILE_SIZE = 3000;
+
+class ArchiveBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void gzipUncompress();
+    void tarIndex();
+    void tarFileData();
+
+private:
+    QTemporaryDir m_tempDir;
+    QByteArray m_tarData;
+    QByteArray m_gzipData;
+};
+
+void ArchiveBenchmark::initTestCase()
+{
+    QVERIFY(m_tempDir.isValid());
+    QVERIFY(BenchmarkData::createFileTree(QDir(m_tempDir.path()), DIR_COUNT, FILES_PER_DIR, FILE_SIZE));
+
+    m_tarData = BenchmarkData::tarDirectory(QDir(m_tempDir.path()));
+    QVERIFY(!m_tarData.isEmpty());
+
+    m_gzipData = BenchmarkData::gzipCompress(m_tarData);
+    QVERIFY(!m_gzipData.isEmpty());
+}
+
+void ArchiveBenchmark::gzipUncompress()
+{
+    BenchmarkRecorder recorder(m_tarData.size());
+
+    QBENCHMARK {
+        QByteArray out;
+        QBuffer inBuffer(&m_gzipData);
+        QBuffer outBuffer(&out);
+
+        GZipUncompressor uncompressor(&inBuffer, &outBuffer);
+        QSignalSpy spy(&uncompressor, &GZipUncompressor::finished);
+
+        QVERIFY(spy.wait(60000));
+        QVERIFY(!uncompressor.isError());
+        QCOMPARE(out.size(), m_tarData.size());
+
+        recorder.next();
+    }
+}
+
+void ArchiveBenchmark::tarIndex()
+{
+    BenchmarkRecorder recorder(m_tarData.size(), DIR_COUNT * FILES_PER_DIR);
+
+    QBENCHMARK {
+        QBuffer buffer(&m_tarData);
+        TarArchive archive(&buffer);
+
+        QVERIFY(!archive.isError());
+        recorder.next();
+    }
+}
+
+void ArchiveBenchmark::tarFileData()
+{
+    QBuffer buffer(&m_tarData);
+    TarArchive archive(&buffer);
+    QVERIFY(!archive.isError());
+
+    const auto files = archive.root()->toPreOrderList();
+    BenchmarkRecorder recorder(DIR_COUNT * FILES_PER_DIR * FILE_SIZE, DIR_COUNT * FILES_PER_DIR);
+
+    QBENCHMARK {
+        for(const auto &fileInfo : files) {
+            if(fileInfo.type == FileNode::Type::RegularFile) {
+                QCOMPARE(archive.fileData(fileInfo.absolutePath).size(), FILE_SIZE);
+            }
+        }
+
+        recorder.next();
+    }
+}
+
+BENCHMARK_MAIN(QCoreApplication, ArchiveBenchmark)
+
+#include "tst_archive.moc"
@@ -0,0 +1,50 @@
+# Common settings for the benchmark executables.
+# Run any of them with "-json <file>" to save the results for comparison between releases.
+
+QT += testlib
+
+include(../qflipper_common.pri)
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+win32:!win32-g++ {
+    PRE_TARGETDEPS += \
+        $$OUT_PWD/../../backend/backend.lib \
+        $$OUT_PWD/../../dfu/dfu.lib
+
+} else:unix|win32-g++ {
+    PRE_TARGETDEPS += \
+        $$OUT_PWD/../../backend/libbackend.a \
+        $$OUT_PWD/../../dfu/libdfu.a
+
+    contains(CONFIG, static): PRE_TARGETDEPS += \
+        $$OUT_PWD/../../plugins/libflipperproto0.a \
+        $$OUT_PWD/../../3rdparty/lib3rdparty.a
+}
+
+unix|win32 {
+    LIBS += \
+        -L$$OUT_PWD/../../backend/ -lbackend \
+        -L$$OUT_PWD/../../dfu/ -ldfu
+
+    contains(CONFIG, static): LIBS += \
+        -L$$OUT_PWD/../../plugins/ -lflipperproto0 \
+        -L$$OUT_PWD/../../3rdparty/ -l3rdparty
+}
+
+INCLUDEPATH += \
+    $$PWD/common \
+    $$PWD/../dfu \
+    $$PWD/../backend \
+    $$PWD/../plugins/protobufinterface
+
+SOURCES += \
+    $$PWD/common/allocationcounter.cpp \
+    $$PWD/common/benchmarkdata.cpp \
+    $$PWD/common/benchmarkreport.cpp
+
+HEADERS += \
+    $$PWD/common/allocationcounter.h \
+    $$PWD/common/benchmarkdata.h \
+    $$PWD/common/benchmarkreport.h
@@ -0,0 +1,8 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    archive \
+    filetree \
+    protobuf \
+    rpc \
+    screen
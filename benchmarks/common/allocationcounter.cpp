@@ -0,0 +1,83 @@
+#include "allocationcounter.h"
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+static std::atomic<bool> isCounting(false);
+static std::atomic<quint64> allocationCount(0);
+
+static inline void countAllocation()
+{
+    if(isCounting.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#if defined(__GLIBC__)
+// Interpose the C allocator, this also covers QByteArray, nanopb and operator new
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+}
+#else
+// Elsewhere only C++ allocations can be counted portably
+void *operator new(std::size_t size)
+{
+    countAllocation();
+
+    if(auto *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+void AllocationCounter::start()
+{
+    allocationCount.store(0);
+    isCounting.store(true);
+}
+
+quint64 AllocationCounter::stop()
+{
+    isCounting.store(false);
+    return allocationCount.load();
+}
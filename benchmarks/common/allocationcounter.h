@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Counts heap allocations made by the whole process while enabled
+namespace AllocationCounter {
+
+void start();
+quint64 stop();
+
+}
+
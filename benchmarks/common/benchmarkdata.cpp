@@ -0,0 +1,113 @@
+#include "benchmarkdata.h"
+
+#include <QFile>
+#include <QBuffer>
+#include <QSignalSpy>
+#include <QDirIterator>
+#include <QDateTime>
+#include <QCryptographicHash>
+
+#include <zlib.h>
+
+#include "tararchive.h"
+
+bool BenchmarkData::createFileTree(const QDir &dir, int dirCount, int filesPerDir, int fileSize)
+{
+    for(auto i = 0; i < dirCount; ++i) {
+        const auto dirName = QStringLiteral("dir%1").arg(i);
+
+        if(!dir.mkpath(dirName)) {
+            return false;
+        }
+
+        for(auto j = 0; j < filesPerDir; ++j) {
+            QFile file(dir.absoluteFilePath(QStringLiteral("%1/file%2.bin").arg(dirName).arg(j)));
+
+            if(!file.open(QIODevice::WriteOnly)) {
+                return false;
+            }
+
+            // Different contents in every file to keep the checksums honest
+            const QByteArray data(fileSize, (char)('a' + (i * filesPerDir + j) % 26));
+
+            if(file.write(data) != data.size()) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+QByteArray BenchmarkData::createManifest(const QDir &dir)
+{
+    QByteArray ret;
+
+    ret.append(QByteArrayLiteral("V:0\n"));
+    ret.append(QStringLiteral("T:%1\n").arg(QDateTime::currentSecsSinceEpoch()).toLatin1());
+
+    QDirIterator it(dir.absolutePath(), QDir::AllEntries | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+
+    while(it.hasNext()) {
+        const QFileInfo fileInfo(it.next());
+        const auto relativePath = dir.relativeFilePath(fileInfo.absoluteFilePath()).toUtf8();
+
+        if(fileInfo.isDir()) {
+            ret.append(QByteArrayLiteral("D:") + relativePath + '\n');
+            continue;
+        }
+
+        QFile file(fileInfo.absoluteFilePath());
+
+        if(!file.open(QIODevice::ReadOnly)) {
+            return QByteArray();
+        }
+
+        QCryptographicHash hash(QCryptographicHash::Md5);
+        hash.addData(&file);
+
+        ret.append(QByteArrayLiteral("F:") + hash.result().toHex() + ':' +
+                   QByteArray::number(fileInfo.size()) + ':' + relativePath + '\n');
+    }
+
+    return ret;
+}
+
+QByteArray BenchmarkData::tarDirectory(const QDir &dir)
+{
+    QByteArray ret;
+    QBuffer buffer(&ret);
+
+    TarArchive archive(dir, &buffer);
+    QSignalSpy spy(&archive, &TarArchive::ready);
+
+    if(archive.isError() || !spy.wait(60000) || archive.isError()) {
+        return QByteArray();
+    }
+
+    buffer.close();
+    return ret;
+}
+
+QByteArray BenchmarkData::gzipCompress(const QByteArray &data)
+{
+    z_stream stream = {};
+
+    // 16 + MAX_WBITS selects the gzip wrapper, as expected by GZipUncompressor
+    if(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return QByteArray();
+    }
+
+    QByteArray ret(deflateBound(&stream, data.size()), Qt::Uninitialized);
+
+    stream.next_in = (Bytef*)data.constData();
+    stream.avail_in = data.size();
+    stream.next_out = (Bytef*)ret.data();
+    stream.avail_out = ret.size();
+
+    const auto err = deflate(&stream, Z_FINISH);
+    ret.resize(stream.total_out);
+
+    deflateEnd(&stream);
+    return err == Z_STREAM_END ? ret : QByteArray();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QDir>
+#include <QByteArray>
+
+// Synthetic inputs shared between the benchmark suites
+namespace BenchmarkData {
+
+// Fills dir with dirCount subdirectories holding filesPerDir files of fileSize bytes each
+bool createFileTree(const QDir &dir, int dirCount, int filesPerDir, int fileSize);
+
+// Asset manifest text describing the contents of dir
+QByteArray createManifest(const QDir &dir);
+
+QByteArray tarDirectory(const QDir &dir);
+QByteArray gzipCompress(const QByteArray &data);
+
+}
+
@@ -0,0 +1,100 @@
+#include "benchmarkreport.h"
+
+#include <QFile>
+#include <QtTest>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+#include "allocationcounter.h"
+
+BenchmarkReport *BenchmarkReport::instance()
+{
+    static BenchmarkReport report;
+    return &report;
+}
+
+void BenchmarkReport::addResult(const Result &result)
+{
+    m_results.append(result);
+}
+
+bool BenchmarkReport::save(const QString &suiteName, const QString &fileName) const
+{
+    QJsonArray results;
+
+    for(const auto &result : m_results) {
+        const auto seconds = result.elapsedNsecs / 1e9;
+        const auto totalMessages = result.messages * result.iterations;
+
+        QJsonObject obj;
+        obj.insert(QStringLiteral("name"), result.name);
+        obj.insert(QStringLiteral("iterations"), result.iterations);
+        obj.insert(QStringLiteral("nsPerIteration"), (double)result.elapsedNsecs / qMax<qint64>(1, result.iterations));
+        obj.insert(QStringLiteral("bytesPerSecond"), seconds > 0 ? result.bytes * result.iterations / seconds : 0);
+        obj.insert(QStringLiteral("messagesPerSecond"), seconds > 0 ? totalMessages / seconds : 0);
+        obj.insert(QStringLiteral("allocationsPerMessage"), (double)result.allocations / qMax<qint64>(1, totalMessages));
+
+        results.append(obj);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("suite"), suiteName);
+    root.insert(QStringLiteral("version"), QStringLiteral(APP_VERSION));
+    root.insert(QStringLiteral("commit"), QStringLiteral(APP_COMMIT));
+    root.insert(QStringLiteral("qtVersion"), QString(qVersion()));
+    root.insert(QStringLiteral("timestamp"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    root.insert(QStringLiteral("results"), results);
+
+    QFile file(fileName);
+
+    if(!file.open(QIODevice::WriteOnly)) {
+        qWarning().noquote() << "Failed to save benchmark results:" << file.errorString();
+        return false;
+    }
+
+    return file.write(QJsonDocument(root).toJson()) > 0;
+}
+
+const QString BenchmarkReport::takeOutputFileName(QStringList &args)
+{
+    const auto idx = args.indexOf(QStringLiteral("-json"));
+
+    if(idx < 0 || idx + 1 >= args.size()) {
+        return QString();
+    }
+
+    const auto fileName = args.at(idx + 1);
+    args.erase(args.begin() + idx, args.begin() + idx + 2);
+
+    return fileName;
+}
+
+BenchmarkRecorder::BenchmarkRecorder(qint64 bytesPerIteration, qint64 messagesPerIteration):
+    m_bytesPerIteration(bytesPerIteration),
+    m_messagesPerIteration(messagesPerIteration),
+    m_iterations(0)
+{
+    AllocationCounter::start();
+    m_timer.start();
+}
+
+BenchmarkRecorder::~BenchmarkRecorder()
+{
+    const auto elapsed = m_timer.nsecsElapsed();
+    const auto allocations = AllocationCounter::stop();
+
+    auto name = QString(QTest::currentTestFunction());
+
+    if(QTest::currentDataTag()) {
+        name += QStringLiteral(":%1").arg(QTest::currentDataTag());
+    }
+
+    BenchmarkReport::instance()->addResult({name, m_iterations, elapsed, m_bytesPerIteration, m_messagesPerIteration, allocations});
+}
+
+void BenchmarkRecorder::next()
+{
+    ++m_iterations;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QElapsedTimer>
+
+// Collects the results of a benchmark suite and saves them as JSON
+class BenchmarkReport
+{
+public:
+    struct Result {
+        QString name;
+        qint64 iterations;
+        qint64 elapsedNsecs;
+        qint64 bytes;
+        qint64 messages;
+        quint64 allocations;
+    };
+
+    static BenchmarkReport *instance();
+
+    void addResult(const Result &result);
+    bool save(const QString &suiteName, const QString &fileName) const;
+
+    // Removes "-json <file>" from the arguments, if present
+    static const QString takeOutputFileName(QStringList &args);
+
+private:
+    QVector<Result> m_results;
+};
+
+/*
+ * Measures the enclosing QBENCHMARK block:
+ *
+ *     BenchmarkRecorder recorder(bytesPerIteration, messagesPerIteration);
+ *     QBENCHMARK { doWork(); recorder.next(); }
+ *
+ * The result is recorded under the current test function and data tag on destruction.
+ */
+class BenchmarkRecorder
+{
+public:
+    BenchmarkRecorder(qint64 bytesPerIteration, qint64 messagesPerIteration = 1);
+    ~BenchmarkRecorder();
+
+    void next();
+
+private:
+    qint64 m_bytesPerIteration;
+    qint64 m_messagesPerIteration;
+    qint64 m_iterations;
+    QElapsedTimer m_timer;
+};
+
+#define BENCHMARK_MAIN(ApplicationClass, TestClass) \
+int main(int argc, char *argv[]) \
+{ \
+    ApplicationClass app(argc, argv); \
+    TestClass tc; \
+    auto args = app.arguments(); \
+    const auto fileName = BenchmarkReport::takeOutputFileName(args); \
+    const auto ret = QTest::qExec(&tc, args); \
+    if(!fileName.isEmpty() && !BenchmarkReport::instance()->save(QStringLiteral(#TestClass), fileName)) { \
+        return 1; \
+    } \
+    return ret; \
+}
+
@@ -0,0 +1,8 @@
+QT -= gui
+
+include(../benchmarks.pri)
+
+TARGET = bench_filetree
+
+SOURCES += \
+    tst_filetree.cpp
@@ -0,0 +1,114 @@
+#include <QtTest>
+
+#include "benchmarkreport.h"
+
+#include "filenode.h"
+#include "flipperzero/assetmanifest.h"
+
+using namespace Flipper;
+using namespace Zero;
+
+static constexpr int DIR_COUNT = 40;
+static constexpr int FILES_PER_DIR = 50;
+
+// Manifest text with a few files changed, removed or added depending on the revision
+static QByteArray manifestText(int revision)
+{
+    QByteArray ret("V:0\nT:1650000000\n");
+
+    for(auto i = 0; i < DIR_COUNT; ++i) {
+        const auto dirName = QByteArrayLiteral("dir") + QByteArray::number(i);
+        ret.append(QByteArrayLiteral("D:") + dirName + '\n');
+
+        for(auto j = 0; j < FILES_PER_DIR; ++j) {
+            const auto n = i * FILES_PER_DIR + j;
+
+            if(revision && n % 31 == 0) {
+                continue;
+            }
+
+            const auto md5 = QCryptographicHash::hash(QByteArray::number(revision && n % 17 == 0 ? -n : n), QCryptographicHash::Md5).toHex();
+            ret.append(QByteArrayLiteral("F:") + md5 + ":1024:" + dirName + "/file" + QByteArray::number(j) + ".bin\n");
+        }
+
+        if(revision && i % 7 == 0) {
+            ret.append(QByteArrayLiteral("F:00000000000000000000000000000000:16:") + dirName + "/new.bin\n");
+        }
+    }
+
+    return ret;
+}
+
+class FileTreeBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void assetManifestParse();
+    void fileNodeDifference();
+    void fileNodeChanged();
+
+private:
+    QByteArray m_localText;
+    QByteArray m_deviceText;
+};
+
+void FileTreeBenchmark::initTestCase()
+{
+    m_localText = manifestText(1);
+    m_deviceText = manifestText(0);
+}
+
+void FileTreeBenchmark::assetManifestParse()
+{
+    BenchmarkRecorder recorder(m_localText.size(), m_localText.count('\n'));
+
+    QBENCHMARK {
+        const AssetManifest manifest(m_localText);
+        QVERIFY(!manifest.isError());
+        recorder.next();
+    }
+}
+
+void FileTreeBenchmark::fileNodeDifference()
+{
+    const AssetManifest local(m_localText);
+    const AssetManifest device(m_deviceText);
+
+    QVERIFY(!local.isError() && !device.isError());
+
+    const auto nodeCount = local.tree()->toPreOrderList().size() + device.tree()->toPreOrderList().size();
+    BenchmarkRecorder recorder(0, nodeCount);
+
+    QBENCHMARK {
+        // Both directions, as done in AssetsDownloadOperation
+        const auto deleted = local.tree()->difference(device.tree());
+        const auto added = device.tree()->difference(local.tree());
+
+        QVERIFY(!deleted.isEmpty() && !added.isEmpty());
+        recorder.next();
+    }
+}
+
+void FileTreeBenchmark::fileNodeChanged()
+{
+    const AssetManifest local(m_localText);
+    const AssetManifest device(m_deviceText);
+
+    QVERIFY(!local.isError() && !device.isError());
+
+    const auto nodeCount = local.tree()->toPreOrderList().size();
+    BenchmarkRecorder recorder(0, nodeCount);
+
+    QBENCHMARK {
+        const auto changed = device.tree()->changed(local.tree());
+        QVERIFY(!changed.isEmpty());
+        recorder.next();
+    }
+}
+
+BENCHMARK_MAIN(QCoreApplication, FileTreeBenchmark)
+
+#include "tst_filetree.moc"
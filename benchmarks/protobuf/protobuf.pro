@@ -0,0 +1,19 @@
+QT -= gui
+
+include(../benchmarks.pri)
+
+TARGET = bench_protobuf
+
+INCLUDEPATH += \
+    $$PWD/../../plugins/flipperproto0 \
+    $$PWD/../../3rdparty/nanopb
+
+SOURCES += \
+    tst_protobuf.cpp
+
+# Plugin internals are not exported, build them in
+!contains(CONFIG, static) {
+    include(../../plugins/flipperproto0/flipperproto0.pri)
+
+    LIBS += -L$$OUT_PWD/../../3rdparty/ -l3rdparty
+}
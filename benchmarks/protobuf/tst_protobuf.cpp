@@ -0,0 +1,288 @@
+#include <QtTest>
+
+#include "pb_encode.h"
+
+#include "benchmarkreport.h"
+#include "protobufplugin.h"
+#include "messagewrapper.h"
+#include "storagerequest.h"
+#include "flipperzero/receivebuffer.h"
+
+using namespace Flipper;
+using namespace Zero;
+
+static const QByteArray FILE_PATH = QByteArrayLiteral("/ext/benchmark/file.bin");
+
+// Encodes a storage read response the same way the device does
+static QByteArray storageReadResponse(uint32_t id, int payloadSize)
+{
+    const QByteArray payload(payloadSize, 'x');
+
+    PB_Main message = PB_Main_init_zero;
+    message.command_id = id;
+    message.has_next = true;
+    message.which_content = PB_Main_storage_read_response_tag;
+
+    auto &content = message.content.storage_read_response;
+    content.has_file = true;
+    content.file.data = (pb_bytes_array_t*)malloc(PB_BYTES_ARRAY_T_ALLOCSIZE(payload.size()));
+    content.file.data->size = payload.size();
+    memcpy(content.file.data->bytes, payload.data(), payload.size());
+
+    pb_ostream_t s = PB_OSTREAM_SIZING;
+    pb_encode_ex(&s, &PB_Main_msg, &message, PB_ENCODE_DELIMITED);
+
+    QByteArray ret((int)s.bytes_written, Qt::Uninitialized);
+    s = pb_ostream_from_buffer((pb_byte_t*)ret.data(), ret.size());
+    pb_encode_ex(&s, &PB_Main_msg, &message, PB_ENCODE_DELIMITED);
+
+    free(content.file.data);
+    return ret;
+}
+
+// Encodes a storage write request with nanopb alone, for comparison
+static QByteArray storageWriteReference(uint32_t id, const QByteArray &payload, bool hasNext)
+{
+    auto path = FILE_PATH;
+
+    PB_Main message = PB_Main_init_zero;
+    message.command_id = id;
+    message.has_next = hasNext;
+    message.which_content = PB_Main_storage_write_request_tag;
+
+    auto &content = message.content.storage_write_request;
+    content.path = path.data();
+    content.has_file = true;
+    content.file.data = (pb_bytes_array_t*)malloc(PB_BYTES_ARRAY_T_ALLOCSIZE(payload.size()));
+    content.file.data->size = payload.size();
+    memcpy(content.file.data->bytes, payload.data(), payload.size());
+
+    pb_ostream_t s = PB_OSTREAM_SIZING;
+    pb_encode_ex(&s, &PB_Main_msg, &message, PB_ENCODE_DELIMITED);
+
+    QByteArray ret((int)s.bytes_written, Qt::Uninitialized);
+    s = pb_ostream_from_buffer((pb_byte_t*)ret.data(), ret.size());
+    pb_encode_ex(&s, &PB_Main_msg, &message, PB_ENCODE_DELIMITED);
+
+    free(content.file.data);
+    return ret;
+}
+
+class ProtobufBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void storageWriteRequest_data();
+    void storageWriteRequest();
+
+    void mainRequestEncode_data();
+    void mainRequestEncode();
+
+    void storageWriteEncodeInPlace_data();
+    void storageWriteEncodeInPlace();
+
+    void messageWrapper_data();
+    void messageWrapper();
+
+    void pluginDecode_data();
+    void pluginDecode();
+
+    void pluginDecodeStreaming_data();
+    void pluginDecodeStreaming();
+
+    void receiveBuffer_data();
+    void receiveBuffer();
+
+private:
+    void addPayloadSizes();
+};
+
+void ProtobufBenchmark::addPayloadSizes()
+{
+    QTest::addColumn<int>("payloadSize");
+
+    QTest::newRow("512") << 512;
+    QTest::newRow("1024") << 1024;
+    QTest::newRow("4096") << 4096;
+}
+
+void ProtobufBenchmark::storageWriteRequest_data()
+{
+    addPayloadSizes();
+}
+
+void ProtobufBenchmark::storageWriteRequest()
+{
+    QFETCH(int, payloadSize);
+    const QByteArray payload(payloadSize, 'x');
+
+    BenchmarkRecorder recorder(payloadSize);
+
+    QBENCHMARK {
+        StorageWriteRequest request(1, FILE_PATH, payload, true);
+        Q_UNUSED(request)
+        recorder.next();
+    }
+}
+
+void ProtobufBenchmark::mainRequestEncode_data()
+{
+    addPayloadSizes();
+}
+
+void ProtobufBenchmark::mainRequestEncode()
+{
+    QFETCH(int, payloadSize);
+    const QByteArray payload(payloadSize, 'x');
+    const StorageWriteRequest request(1, FILE_PATH, payload, true);
+
+    BenchmarkRecorder recorder(payloadSize);
+
+    QBENCHMARK {
+        const auto buf = request.encode();
+        Q_UNUSED(buf)
+        recorder.next();
+    }
+}
+
+void ProtobufBenchmark::storageWriteEncodeInPlace_data()
+{
+    addPayloadSizes();
+}
+
+void ProtobufBenchmark::storageWriteEncodeInPlace()
+{
+    QFETCH(int, payloadSize);
+    QByteArray payload(payloadSize, 'x');
+    QBuffer source(&payload);
+
+    QVERIFY(source.open(QIODevice::ReadOnly));
+
+    ProtobufPlugin plugin;
+    QByteArray buf;
+
+    QVERIFY(plugin.storageWrite(buf, 1, FILE_PATH, &source, payloadSize, true));
+    QCOMPARE(buf, storageWriteReference(1, payload, true));
+
+    BenchmarkRecorder recorder(payloadSize);
+
+    QBENCHMARK {
+        source.seek(0);
+        plugin.storageWrite(buf, 1, FILE_PATH, &source, payloadSize, true);
+        recorder.next();
+    }
+}
+
+void ProtobufBenchmark::messageWrapper_data()
+{
+    addPayloadSizes();
+}
+
+void ProtobufBenchmark::messageWrapper()
+{
+    QFETCH(int, payloadSize);
+    const auto buf = storageReadResponse(1, payloadSize);
+
+    BenchmarkRecorder recorder(buf.size());
+
+    QBENCHMARK {
+        MessageWrapper wrapper(buf);
+        QVERIFY(wrapper.isComplete());
+        recorder.next();
+    }
+}
+
+void ProtobufBenchmark::pluginDecode_data()
+{
+    addPayloadSizes();
+}
+
+void ProtobufBenchmark::pluginDecode()
+{
+    QFETCH(int, payloadSize);
+    const auto buf = storageReadResponse(1, payloadSize);
+
+    ProtobufPlugin plugin;
+    BenchmarkRecorder recorder(buf.size());
+
+    QBENCHMARK {
+        auto *response = plugin.decode(buf);
+        QVERIFY(response);
+        plugin.release(response);
+        recorder.next();
+    }
+}
+
+void ProtobufBenchmark::pluginDecodeStreaming_data()
+{
+    addPayloadSizes();
+}
+
+void ProtobufBenchmark::pluginDecodeStreaming()
+{
+    QFETCH(int, payloadSize);
+    const auto buf = storageReadResponse(1, payloadSize);
+
+    QByteArray fileData;
+    QBuffer sink(&fileData);
+
+    QVERIFY(sink.open(QIODevice::WriteOnly));
+
+    ProtobufPlugin plugin;
+    const ProtobufPlugin::DataSinkMap sinks = {{1, &sink}};
+
+    BenchmarkRecorder recorder(buf.size());
+
+    QBENCHMARK {
+        sink.seek(0);
+
+        auto *response = plugin.decode(buf, sinks);
+        QVERIFY(response);
+        plugin.release(response);
+        recorder.next();
+    }
+
+    QCOMPARE(fileData, QByteArray(payloadSize, 'x'));
+}
+
+void ProtobufBenchmark::receiveBuffer_data()
+{
+    QTest::addColumn<int>("payloadSize");
+    QTest::addColumn<int>("messageCount");
+
+    QTest::newRow("512x64") << 512 << 64;
+    QTest::newRow("4096x16") << 4096 << 16;
+}
+
+void ProtobufBenchmark::receiveBuffer()
+{
+    QFETCH(int, payloadSize);
+    QFETCH(int, messageCount);
+
+    // Several messages arriving in one read, as it happens with a busy serial port
+    QByteArray burst;
+
+    for(auto i = 0; i < messageCount; ++i) {
+        burst.append(storageReadResponse(i + 1, payloadSize));
+    }
+
+    ReceiveBuffer buffer;
+    BenchmarkRecorder recorder(burst.size(), messageCount);
+
+    QBENCHMARK {
+        buffer.append(burst);
+
+        while(buffer.hasCompleteFrame()) {
+            buffer.consume(buffer.nextFrameSize());
+        }
+
+        recorder.next();
+    }
+
+    QVERIFY(buffer.isEmpty());
+}
+
+BENCHMARK_MAIN(QCoreApplication, ProtobufBenchmark)
+
+#include "tst_protobuf.moc"
@@ -0,0 +1,21 @@
+QT -= gui
+QT += serialport network
+
+# Must come before the libraries from benchmarks.pri for static linking to work
+LIBS += \
+    -L$$OUT_PWD/../../emulator/ -lemulator
+
+include(../benchmarks.pri)
+
+TARGET = bench_rpc
+
+INCLUDEPATH += \
+    $$PWD/../../emulator
+
+unix|win32-g++: PRE_TARGETDEPS += $$OUT_PWD/../../emulator/libemulator.a
+else:win32: PRE_TARGETDEPS += $$OUT_PWD/../../emulator/emulator.lib
+
+!contains(CONFIG, static): LIBS += -L$$OUT_PWD/../../3rdparty/ -l3rdparty
+
+SOURCES += \
+    tst_rpc.cpp
@@ -0,0 +1,258 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QSerialPortInfo>
+
+#include "emulator.h"
+#include "benchmarkdata.h"
+#include "benchmarkreport.h"
+
+#include "flipperzero/devicestate.h"
+#include "flipperzero/protobufsession.h"
+#include "flipperzero/utility/filesuploadoperation.h"
+#include "flipperzero/utility/userbackupoperation.h"
+#include "flipperzero/utility/assetsdownloadoperation.h"
+
+using namespace Flipper;
+using namespace Zero;
+
+static constexpr int OPERATION_TIMEOUT_MS = 10 * 60 * 1000;
+
+// Small files are where the per-request overhead shows
+static constexpr int DIR_COUNT = 5;
+static constexpr int FILES_PER_DIR = 20;
+static constexpr int FILE_SIZE = 6000;
+
+/*
+ * End-to-end benchmarks of utility operations against the in-process emulator.
+ * Each data row is a link profile: response latency and bandwidth of the emulated device.
+ */
+
+class RpcBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void init();
+    void cleanup();
+
+    void filesUpload_data();
+    void filesUpload();
+
+    void userBackup_data();
+    void userBackup();
+
+    void assetsDownload_data();
+    void assetsDownload();
+
+private:
+    void addLinkProfiles();
+    bool runOperation(AbstractOperation *operation);
+    bool clearDeviceDir(const QString &name);
+
+    QTemporaryDir m_localDir;
+    QTemporaryDir m_deviceDir;
+    QString m_assetsFileName;
+    qint64 m_treeSize;
+
+    Emulator *m_emulator;
+    ProtobufSession *m_session;
+    DeviceState *m_deviceState;
+};
+
+void RpcBenchmark::initTestCase()
+{
+    QVERIFY(m_localDir.isValid() && m_deviceDir.isValid());
+
+    // Look for the protobuf plugin in the build tree
+    QCoreApplication::addLibraryPath(QCoreApplication::applicationDirPath() + QStringLiteral("/../../plugins"));
+
+    const QDir localDir(m_localDir.path());
+    QVERIFY(localDir.mkpath(QStringLiteral("upload")));
+    QVERIFY(localDir.mkpath(QStringLiteral("resources")));
+    QVERIFY(BenchmarkData::createFileTree(QDir(localDir.absoluteFilePath(QStringLiteral("upload"))), DIR_COUNT, FILES_PER_DIR, FILE_SIZE));
+    QVERIFY(BenchmarkData::createFileTree(QDir(localDir.absoluteFilePath(QStringLiteral("resources"))), DIR_COUNT, FILES_PER_DIR, FILE_SIZE));
+
+    m_treeSize = DIR_COUNT * FILES_PER_DIR * FILE_SIZE;
+
+    // Assets bundle with the same layout as the one from the update server
+    const QDir resourcesDir(localDir.absoluteFilePath(QStringLiteral("resources")));
+    const auto manifest = BenchmarkData::createManifest(resourcesDir);
+    QVERIFY(!manifest.isEmpty());
+
+    QFile manifestFile(resourcesDir.absoluteFilePath(QStringLiteral("Manifest")));
+    QVERIFY(manifestFile.open(QIODevice::WriteOnly));
+    QCOMPARE(manifestFile.write(manifest), manifest.size());
+    manifestFile.close();
+
+    QTemporaryDir bundleDir;
+    QVERIFY(QDir(m_localDir.path()).rename(QStringLiteral("resources"), bundleDir.path() + QStringLiteral("/resources")));
+
+    const auto assetsData = BenchmarkData::gzipCompress(BenchmarkData::tarDirectory(QDir(bundleDir.path())));
+    QVERIFY(!assetsData.isEmpty());
+
+    m_assetsFileName = localDir.absoluteFilePath(QStringLiteral("assets.tgz"));
+    QFile assetsFile(m_assetsFileName);
+    QVERIFY(assetsFile.open(QIODevice::WriteOnly));
+    QCOMPARE(assetsFile.write(assetsData), assetsData.size());
+
+    m_emulator = new Emulator(m_deviceDir.path(), this);
+    QVERIFY2(m_emulator->listen(QStringLiteral("qflipper-bench-%1").arg(QCoreApplication::applicationPid())), qPrintable(m_emulator->errorString()));
+
+    DeviceInfo deviceInfo;
+    deviceInfo.name = QStringLiteral("Emulator");
+    deviceInfo.stackType = 0;
+
+    m_deviceState = new DeviceState(deviceInfo, this);
+}
+
+void RpcBenchmark::cleanupTestCase()
+{
+    m_emulator->close();
+}
+
+void RpcBenchmark::init()
+{
+    QVERIFY(clearDeviceDir(QStringLiteral("int")));
+    QVERIFY(clearDeviceDir(QStringLiteral("ext")));
+
+    m_session = new ProtobufSession(QSerialPortInfo(), this);
+    m_session->setLocalServer(m_emulator->serverName());
+    m_session->setMajorVersion(0);
+    m_session->setMinorVersion(m_emulator->protobufVersionMinor());
+}
+
+void RpcBenchmark::cleanup()
+{
+    delete m_session;
+    m_session = nullptr;
+}
+
+void RpcBenchmark::addLinkProfiles()
+{
+    QTest::addColumn<int>("latency");
+    QTest::addColumn<qint64>("bandwidth");
+
+    QTest::newRow("unlimited") << 0 << (qint64)0;
+    QTest::newRow("vcp") << 2 << (qint64)(400 * 1024);
+    QTest::newRow("slow") << 10 << (qint64)(64 * 1024);
+}
+
+void RpcBenchmark::filesUpload_data()
+{
+    addLinkProfiles();
+}
+
+void RpcBenchmark::filesUpload()
+{
+    QFETCH(int, latency);
+    QFETCH(qint64, bandwidth);
+
+    m_emulator->setLatency(latency);
+    m_emulator->setBandwidth(bandwidth);
+
+    const auto url = QUrl::fromLocalFile(QDir(m_localDir.path()).absoluteFilePath(QStringLiteral("upload")));
+    BenchmarkRecorder recorder(m_treeSize, DIR_COUNT * FILES_PER_DIR);
+
+    QBENCHMARK_ONCE {
+        QVERIFY(runOperation(new FilesUploadOperation(m_session, m_deviceState, {url}, QByteArrayLiteral("/ext"), this)));
+        recorder.next();
+    }
+
+    QVERIFY(QFileInfo::exists(m_deviceDir.path() + QStringLiteral("/ext/upload/dir0/file0.bin")));
+}
+
+void RpcBenchmark::userBackup_data()
+{
+    addLinkProfiles();
+}
+
+void RpcBenchmark::userBackup()
+{
+    QFETCH(int, latency);
+    QFETCH(qint64, bandwidth);
+
+    m_emulator->setLatency(latency);
+    m_emulator->setBandwidth(bandwidth);
+
+    QVERIFY(BenchmarkData::createFileTree(QDir(m_deviceDir.path() + QStringLiteral("/int")), DIR_COUNT, FILES_PER_DIR, FILE_SIZE));
+
+    const auto backupFileName = QDir(m_localDir.path()).absoluteFilePath(QStringLiteral("backup.tgz"));
+    BenchmarkRecorder recorder(m_treeSize, DIR_COUNT * FILES_PER_DIR);
+
+    QBENCHMARK_ONCE {
+        QVERIFY(runOperation(new UserBackupOperation(m_session, m_deviceState, QUrl::fromLocalFile(backupFileName), this)));
+        recorder.next();
+    }
+
+    QVERIFY(QFile::remove(backupFileName));
+}
+
+void RpcBenchmark::assetsDownload_data()
+{
+    addLinkProfiles();
+}
+
+void RpcBenchmark::assetsDownload()
+{
+    QFETCH(int, latency);
+    QFETCH(qint64, bandwidth);
+
+    m_emulator->setLatency(latency);
+    m_emulator->setBandwidth(bandwidth);
+
+    auto *assetsFile = new QFile(m_assetsFileName, this);
+    BenchmarkRecorder recorder(m_treeSize, DIR_COUNT * FILES_PER_DIR);
+
+    QBENCHMARK_ONCE {
+        QVERIFY(runOperation(new AssetsDownloadOperation(m_session, m_deviceState, assetsFile, this)));
+        recorder.next();
+    }
+
+    QVERIFY(QFileInfo::exists(m_deviceDir.path() + QStringLiteral("/ext/Manifest")));
+    assetsFile->deleteLater();
+}
+
+bool RpcBenchmark::runOperation(AbstractOperation *operation)
+{
+    if(!m_session->isSessionUp()) {
+        QSignalSpy stateSpy(m_session, &ProtobufSession::sessionStateChanged);
+        m_session->startSession();
+
+        while(!m_session->isSessionUp() && !m_session->isError()) {
+            if(!stateSpy.wait(5000)) {
+                break;
+            }
+        }
+
+        if(!m_session->isSessionUp()) {
+            qWarning().noquote() << "Failed to start RPC session:" << m_session->errorString();
+            operation->deleteLater();
+            return false;
+        }
+    }
+
+    QSignalSpy finishedSpy(operation, &AbstractOperation::finished);
+    operation->start();
+
+    const auto success = (finishedSpy.count() || finishedSpy.wait(OPERATION_TIMEOUT_MS)) && !operation->isError();
+
+    if(operation->isError()) {
+        qWarning().noquote() << operation->description() << "failed:" << operation->errorString();
+    }
+
+    operation->deleteLater();
+    return success;
+}
+
+bool RpcBenchmark::clearDeviceDir(const QString &name)
+{
+    QDir dir(m_deviceDir.path() + QLatin1Char('/') + name);
+    return dir.removeRecursively() && QDir(m_deviceDir.path()).mkdir(name);
+}
+
+BENCHMARK_MAIN(QCoreApplication, RpcBenchmark)
+
+#include "tst_rpc.moc"
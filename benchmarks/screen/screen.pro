@@ -0,0 +1,15 @@
+QT += gui quick
+
+include(../benchmarks.pri)
+
+TARGET = bench_screen
+
+INCLUDEPATH += \
+    $$PWD/../../application
+
+SOURCES += \
+    ../../application/screencanvas.cpp \
+    tst_screen.cpp
+
+HEADERS += \
+    ../../application/screencanvas.h
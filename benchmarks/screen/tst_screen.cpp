@@ -0,0 +1,63 @@
+#include <QtTest>
+#include <QGuiApplication>
+
+#include "benchmarkreport.h"
+#include "screencanvas.h"
+#include "flipperzero/screenstreamer.h"
+
+using namespace Flipper;
+using namespace Zero;
+
+static constexpr int SCREEN_WIDTH = 128;
+static constexpr int SCREEN_HEIGHT = 64;
+static constexpr int SCREEN_BYTES = SCREEN_WIDTH * SCREEN_HEIGHT / 8;
+
+// Checkerboard-like pattern so that neither branch gets predicted perfectly
+static QByteArray testPixelData()
+{
+    QByteArray ret(SCREEN_BYTES, Qt::Uninitialized);
+
+    for(auto i = 0; i < ret.size(); ++i) {
+        ret[i] = (char)(i * 37 + 0x55);
+    }
+
+    return ret;
+}
+
+class ScreenBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void transposeImage();
+    void canvasSetFrame();
+};
+
+void ScreenBenchmark::transposeImage()
+{
+    const auto pixelData = testPixelData();
+    BenchmarkRecorder recorder(SCREEN_BYTES);
+
+    QBENCHMARK {
+        const auto out = ScreenStreamer::transposeImage(pixelData, SCREEN_WIDTH, SCREEN_HEIGHT);
+        Q_UNUSED(out)
+        recorder.next();
+    }
+}
+
+void ScreenBenchmark::canvasSetFrame()
+{
+    const ScreenFrame frame {testPixelData(), QSize(SCREEN_WIDTH, SCREEN_HEIGHT), Qt::LandscapeOrientation};
+
+    ScreenCanvas canvas;
+    BenchmarkRecorder recorder(SCREEN_BYTES);
+
+    QBENCHMARK {
+        canvas.setFrame(frame);
+        recorder.next();
+    }
+}
+
+BENCHMARK_MAIN(QGuiApplication, ScreenBenchmark)
+
+#include "tst_screen.moc"
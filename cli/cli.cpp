@@ -1,38 +1,64 @@
 #include "cli.h"
 
+#include <QDir>
 #include <QDebug>
 #include <QLoggingCategory>
 
 #include "logger.h"
 #include "preferences.h"
+#include "fleetrunner.h"
+#include "deviceregistry.h"
 
 #include "flipperzero/flipperzero.h"
 #include "flipperzero/devicestate.h"
+#include "flipperzero/protobufsession.h"
 
 Q_LOGGING_CATEGORY(LOG_CLI, "CLI")
 
+using namespace Flipper;
+using namespace Zero;
+
+static const QString firmwareString(const DeviceInfo &info)
+{
+    const auto &firmware = info.firmware;
+
+    if(firmware.commit.isEmpty()) {
+        return firmware.version;
+    } else {
+        return QStringLiteral("%1 (%2)").arg(firmware.version, firmware.commit);
+    }
+}
+
 Cli::Cli(int argc, char *argv[]):
     QCoreApplication(argc, argv),
     m_pendingOperation(NoOperation),
-    m_repeatCount(1)
+    m_repeatCount(1),
+    m_printMetrics(false),
+    m_isFleetMode(false),
+    m_isAllDevices(false),
+    m_report(nullptr)
 {
-    initConnections();
     initLogger();
     initParser();
 
     processOptions();
     processArguments();
 
+    initConnections();
+
     qCInfo(LOG_CLI) << "Waiting for devices...";
 }
 
 Cli::~Cli()
-{}
+{
+    delete m_report;
+}
 
 void Cli::onBackendStateChanged()
 {
     const auto state = m_backend.backendState();
     if(state == ApplicationBackend::BackendState::ErrorOccured) {
+        printMetrics(m_backend.device());
         qCCritical(LOG_CLI).nospace() << "An error has occurred: " << m_backend.errorType() << ". Exiting.";
         return exit(-1);
 
@@ -51,9 +77,7 @@ void Cli::onBackendStateChanged()
             return exit(-1);
         }
 
-        const auto isFirmwareReady = m_backend.firmwareUpdateState() != ApplicationBackend::FirmwareUpdateState::Checking &&
-                                     m_backend.firmwareUpdateState() != ApplicationBackend::FirmwareUpdateState::Unknown;
-        if(isFirmwareReady) {
+        if(isFirmwareReady()) {
             startPendingOperation();
         } else {
             // ... But there are special cases when we might have to wait for the firmware update to become available.
@@ -61,6 +85,7 @@ void Cli::onBackendStateChanged()
         }
 
     } else if(state == ApplicationBackend::BackendState::Finished) {
+        printMetrics(m_backend.device());
         m_backend.finalizeOperation();
     }
 }
@@ -72,17 +97,121 @@ void Cli::onUpdateStateChanged()
         return exit(-1);
     }
 
-    const auto isFirmwareReady = m_backend.firmwareUpdateState() != ApplicationBackend::FirmwareUpdateState::Checking &&
-                                     m_backend.firmwareUpdateState() != ApplicationBackend::FirmwareUpdateState::Unknown;
-    if(isFirmwareReady) {
+    if(isFirmwareReady()) {
         disconnect(&m_backend, &ApplicationBackend::firmwareUpdateStateChanged, this, &Cli::onUpdateStateChanged);
         startPendingOperation();
     }
 }
 
+void Cli::onFleetDevicesChanged()
+{
+    if(m_pendingOperation == DefaultAction) {
+        if(m_backend.firmwareUpdateState() == ApplicationBackend::FirmwareUpdateState::ErrorOccured) {
+            qCCritical(LOG_CLI) << "Failed to get firmware updates. Exiting.";
+            return exit(-1);
+
+        } else if(!isFirmwareReady()) {
+            // Will be called again once the update information is available
+            return;
+        }
+    }
+
+    const auto &devices = m_backend.deviceRegistry()->devices();
+
+    for(auto *device : devices) {
+        const auto *state = device->deviceState();
+
+        if(!state->isOnline() || m_report->contains(state->name()) || !isFleetDeviceWanted(device)) {
+            continue;
+        }
+
+        startFleetOperation(device);
+    }
+}
+
+void Cli::onFleetDeviceStarted(FlipperZero *device)
+{
+    auto &entry = m_report->entry(device->deviceState()->name());
+
+    entry.status = FleetReport::Status::Running;
+    entry.startedAt = QDateTime::currentDateTimeUtc();
+    entry.waitTime = entry.timer.restart();
+
+    qCInfo(LOG_CLI).noquote() << "Started:" << entry.name;
+}
+
+void Cli::onFleetDeviceFinished(FlipperZero *device)
+{
+    const auto *state = device->deviceState();
+    auto &entry = m_report->entry(state->name());
+
+    entry.duration = entry.timer.elapsed();
+    entry.firmwareAfter = firmwareString(state->deviceInfo());
+
+    if(state->isError()) {
+        entry.status = FleetReport::Status::Failed;
+        entry.errorString = state->errorString();
+
+        qCCritical(LOG_CLI).noquote().nospace() << "Failed: " << entry.name << ": " << entry.errorString;
+
+    } else {
+        entry.status = FleetReport::Status::Success;
+        qCInfo(LOG_CLI).noquote().nospace() << "Finished: " << entry.name << " in " << entry.duration / 1000.0 << " s";
+    }
+
+    printMetrics(device);
+
+    if(!m_serialNumbers.isEmpty() && (m_report->count() >= m_serialNumbers.size()) && m_report->isFinished()) {
+        finishFleetOperation();
+    }
+}
+
+void Cli::onFleetDeviceLost(const QString &deviceName)
+{
+    auto &entry = m_report->entry(deviceName);
+
+    entry.duration = entry.timer.elapsed();
+    entry.status = FleetReport::Status::Lost;
+    entry.errorString = QStringLiteral("Device was disconnected");
+
+    qCCritical(LOG_CLI).noquote() << "Lost:" << deviceName;
+}
+
+void Cli::onFleetIdle()
+{
+    if(m_backend.fleetRunner()->isRunning() || m_backend.isQueryInProgress()) {
+        m_idleTimer.start();
+    } else {
+        finishFleetOperation();
+    }
+}
+
 void Cli::initConnections()
 {
-    connect(&m_backend, &ApplicationBackend::backendStateChanged, this, &Cli::onBackendStateChanged);
+    if(!m_isFleetMode) {
+        connect(&m_backend, &ApplicationBackend::backendStateChanged, this, &Cli::onBackendStateChanged);
+        return;
+    }
+
+    auto *deviceModel = m_backend.deviceModel();
+    auto *fleetRunner = m_backend.fleetRunner();
+
+    connect(deviceModel, &QAbstractItemModel::rowsInserted, this, &Cli::onFleetDevicesChanged);
+    connect(deviceModel, &QAbstractItemModel::dataChanged, this, &Cli::onFleetDevicesChanged);
+    connect(&m_backend, &ApplicationBackend::firmwareUpdateStateChanged, this, &Cli::onFleetDevicesChanged);
+
+    connect(fleetRunner, &FleetRunner::deviceStarted, this, &Cli::onFleetDeviceStarted);
+    connect(fleetRunner, &FleetRunner::deviceFinished, this, &Cli::onFleetDeviceFinished);
+    connect(fleetRunner, &FleetRunner::deviceLost, this, &Cli::onFleetDeviceLost);
+    connect(fleetRunner, &FleetRunner::finished, &m_idleTimer, [=]() {
+        m_idleTimer.start();
+    });
+
+    m_idleTimer.setSingleShot(true);
+    connect(&m_idleTimer, &QTimer::timeout, this, &Cli::onFleetIdle);
+
+    m_report = new FleetReport(operationName());
+    m_idleTimer.start();
 }
 
 void Cli::initLogger()
@@ -104,6 +233,14 @@ void Cli::initParser()
     m_options.append(QCommandLineOption({QStringLiteral("d"), QStringLiteral("debug-level")}, QStringLiteral("0 - Errors Only, 1 - Terse, 2 - Full"), QStringLiteral("1")));
     m_options.append(QCommandLineOption({QStringLiteral("n"), QStringLiteral("repeat-number")}, QStringLiteral("Number of times to repeat the operation, 0 - indefinitely"), QStringLiteral("1")));
     m_options.append(QCommandLineOption({QStringLiteral("c"), QStringLiteral("update-channel")}, QStringLiteral("Update channel for Firmware Update/Repair"), globalPrefs->firmwareUpdateChannel()));
+    m_options.append(QCommandLineOption({QStringLiteral("m"), QStringLiteral("metrics")}, QStringLiteral("Print RPC latency and throughput statistics after each operation")));
+    m_options.append(QCommandLineOption({QStringLiteral("a"), QStringLiteral("all-devices")}, QStringLiteral("Run the operation on all connected devices in parallel")));
+    m_options.append(QCommandLineOption({QStringLiteral("s"), QStringLiteral("serial")}, QStringLiteral("Run the operation in parallel on the devices with given comma-separated names or serial numbers"), QStringLiteral("serials")));
+    m_options.append(QCommandLineOption({QStringLiteral("j"), QStringLiteral("jobs")}, QStringLiteral("Maximum number of devices to process at the same time"), QStringLiteral("4")));
+    m_options.append(QCommandLineOption({QStringLiteral("w"), QStringLiteral("wait")}, QStringLiteral("Seconds to wait for more devices before exiting"), QStringLiteral("10")));
+    m_options.append(QCommandLineOption({QStringLiteral("r"), QStringLiteral("report")}, QStringLiteral("Save per-device results to a file (*.json or *.csv)"), QStringLiteral("report_file")));
+    m_options.append(QCommandLineOption({QStringLiteral("V"), QStringLiteral("verify")}, QStringLiteral("Read the flash memory back after writing firmware to make sure it matches (on|off)"), QStringLiteral("state")));
+    m_options.append(QCommandLineOption({QStringLiteral("D"), QStringLiteral("differential")}, QStringLiteral("Only rewrite the flash pages that differ from the firmware file (on|off)"), QStringLiteral("state")));
 
     m_parser.setApplicationDescription(QStringLiteral("A text mode non-interactive qFlipper counterpart. Run without arguments to quickly perform Firmware Update/Repair."));
 
@@ -119,6 +256,10 @@ void Cli::processOptions()
     processDebugLevelOption();
     processRepeatNumberOption();
     processUpdateChannelOption();
+    processMetricsOption();
+    processVerifyOption();
+    processDifferentialOption();
+    processFleetOptions();
 }
 
 void Cli::processArguments()
@@ -210,6 +351,108 @@ void Cli::processUpdateChannelOption()
     globalPrefs->setFirmwareUpdateChannel(channelName);
 }
 
+void Cli::processMetricsOption()
+{
+    m_printMetrics = m_parser.isSet(m_options[MetricsOption]);
+}
+
+void Cli::processVerifyOption()
+{
+    const auto &verifyOption = m_options[VerifyOption];
+
+    if(!m_parser.isSet(verifyOption)) {
+        return;
+    }
+
+    const auto state = m_parser.value(verifyOption);
+
+    if((state != QStringLiteral("on")) && (state != QStringLiteral("off"))) {
+        qCCritical(LOG_CLI) << "Verify option state must be either on or off";
+        std::exit(-1);
+    }
+
+    globalPrefs->setVerifyFirmware(state == QStringLiteral("on"));
+}
+
+void Cli::processDifferentialOption()
+{
+    const auto &differentialOption = m_options[DifferentialOption];
+
+    if(!m_parser.isSet(differentialOption)) {
+        return;
+    }
+
+    const auto state = m_parser.value(differentialOption);
+
+    if((state != QStringLiteral("on")) && (state != QStringLiteral("off"))) {
+        qCCritical(LOG_CLI) << "Differential option state must be either on or off";
+        std::exit(-1);
+    }
+
+    globalPrefs->setDifferentialFlashing(state == QStringLiteral("on"));
+}
+
+void Cli::processFleetOptions()
+{
+    m_isAllDevices = m_parser.isSet(m_options[AllDevicesOption]);
+
+    const auto serialValues = m_parser.values(m_options[SerialNumberOption]);
+
+    for(const auto &value : serialValues) {
+        const auto serials = value.split(QLatin1Char(','));
+
+        for(const auto &serial : serials) {
+            if(!serial.trimmed().isEmpty()) {
+                m_serialNumbers.append(serial.trimmed());
+            }
+        }
+    }
+
+    m_isFleetMode = m_isAllDevices || !m_serialNumbers.isEmpty();
+
+    const auto &jobsOption = m_options[JobsOption];
+    const auto &waitOption = m_options[WaitOption];
+    const auto &reportOption = m_options[ReportOption];
+
+    if(!m_isFleetMode) {
+        if(m_parser.isSet(jobsOption) || m_parser.isSet(waitOption) || m_parser.isSet(reportOption)) {
+            qCCritical(LOG_CLI) << "Jobs, wait and report options require either --all-devices or --serial.";
+            std::exit(-1);
+        }
+
+        return;
+    }
+
+    bool canConvert;
+    const auto jobCount = m_parser.value(jobsOption).toInt(&canConvert);
+
+    if(!canConvert || (jobCount < 1)) {
+        qCCritical(LOG_CLI) << "Number of jobs must be a whole positive number.";
+        std::exit(-1);
+    }
+
+    const auto waitTime = m_parser.value(waitOption).toInt(&canConvert);
+
+    if(!canConvert || (waitTime < 0)) {
+        qCCritical(LOG_CLI) << "Wait time must be a whole non-negative number.";
+        std::exit(-1);
+    }
+
+    if(m_repeatCount != 1) {
+        qCWarning(LOG_CLI) << "Repeat number is ignored when running on several devices.";
+    }
+
+    m_backend.fleetRunner()->setMaxJobs(jobCount);
+    m_idleTimer.setInterval(waitTime * 1000);
+    m_reportFileName = m_parser.value(reportOption);
+
+    if(m_isAllDevices && m_serialNumbers.isEmpty()) {
+        qCInfo(LOG_CLI).noquote() << "Will run on all connected devices," << jobCount << "at a time.";
+    } else {
+        qCInfo(LOG_CLI).noquote() << "Will run on" << m_serialNumbers.join(QStringLiteral(", ")) << "-" << jobCount << "at a time.";
+    }
+}
+
 void Cli::beginDefaultAction()
 {
     qCInfo(LOG_CLI) << "Performing full firmware update...";
@@ -337,6 +580,167 @@ void Cli::startPendingOperation()
     }
 }
 
+void Cli::startFleetOperation(FlipperZero *device)
+{
+    const auto &info = device->deviceState()->deviceInfo();
+    auto &entry = m_report->entry(info.name);
+
+    entry.serialNumber = info.usbInfo.serialNumber();
+    entry.firmwareBefore = firmwareString(info);
+    entry.queuedAt = QDateTime::currentDateTimeUtc();
+    entry.timer.start();
+
+    FleetRunner::Job job;
+
+    const auto fileUrl = m_fileParameter;
+    const auto core2Address = m_core2Address;
+
+    if(m_pendingOperation == DefaultAction) {
+        const auto versionInfo = m_backend.latestFirmwareVersion();
+
+        job = [versionInfo](FlipperZero *dev) {
+            if(dev->deviceState()->isRecoveryMode()) {
+                dev->fullRepair(versionInfo);
+            } else {
+                dev->fullUpdate(versionInfo);
+            }
+        };
+
+    } else if(m_pendingOperation == Backup) {
+        // One subdirectory per device, they would overwrite each other otherwise
+        const auto backupPath = QDir(fileUrl.toLocalFile()).absoluteFilePath(info.name);
+        QDir().mkpath(backupPath);
+
+        job = [backupPath](FlipperZero *dev) {
+            dev->createBackup(QUrl::fromLocalFile(backupPath));
+        };
+
+    } else if(m_pendingOperation == Restore) {
+        job = [fileUrl](FlipperZero *dev) {
+            dev->restoreBackup(fileUrl);
+        };
+
+    } else if(m_pendingOperation == Erase) {
+        job = [](FlipperZero *dev) {
+            dev->factoryReset();
+        };
+
+    } else if(m_pendingOperation == Firmware) {
+        job = [fileUrl](FlipperZero *dev) {
+            dev->installFirmware(fileUrl);
+        };
+
+    } else if(m_pendingOperation == Core2Radio) {
+        job = [fileUrl](FlipperZero *dev) {
+            dev->installWirelessStack(fileUrl);
+        };
+
+    } else if(m_pendingOperation == Core2FUS) {
+        job = [fileUrl, core2Address](FlipperZero *dev) {
+            dev->installFUS(fileUrl, core2Address);
+        };
+
+    } else {
+        qCCritical(LOG_CLI) << "Unhandled operation. Probably a bug!";
+        return exit(-1);
+    }
+
+    qCInfo(LOG_CLI).noquote() << "Queued:" << info.name;
+
+    m_idleTimer.stop();
+    m_backend.fleetRunner()->run({device}, job);
+}
+
+void Cli::finishFleetOperation()
+{
+    m_idleTimer.stop();
+
+    const auto totalCount = m_report->count();
+    const auto failedCount = m_report->count(FleetReport::Status::Failed) + m_report->count(FleetReport::Status::Lost);
+
+    if(!m_reportFileName.isEmpty()) {
+        QString errorString;
+
+        if(m_report->save(m_reportFileName, &errorString)) {
+            qCInfo(LOG_CLI).noquote() << "Report saved to" << m_reportFileName;
+        } else {
+            qCCritical(LOG_CLI).noquote() << "Failed to save the report:" << errorString;
+        }
+    }
+
+    if(!totalCount) {
+        qCCritical(LOG_CLI) << "No matching devices found. Exiting.";
+        return exit(-1);
+    }
+
+    qCInfo(LOG_CLI).noquote().nospace() << "All done! Processed " << totalCount << " devices, " << failedCount << " failed.";
+    exit(failedCount ? -1 : 0);
+}
+
+bool Cli::isFleetDeviceWanted(FlipperZero *device) const
+{
+    if(m_serialNumbers.isEmpty()) {
+        return m_isAllDevices;
+    }
+
+    const auto &info = device->deviceState()->deviceInfo();
+
+    return m_serialNumbers.contains(info.usbInfo.serialNumber(), Qt::CaseInsensitive) ||
+           m_serialNumbers.contains(info.name, Qt::CaseInsensitive);
+}
+
+bool Cli::isFirmwareReady() const
+{
+    return m_backend.firmwareUpdateState() != ApplicationBackend::FirmwareUpdateState::Checking &&
+           m_backend.firmwareUpdateState() != ApplicationBackend::FirmwareUpdateState::Unknown;
+}
+
+const QString Cli::operationName() const
+{
+    switch(m_pendingOperation) {
+    case DefaultAction:
+        return QStringLiteral("update");
+    case Backup:
+        return QStringLiteral("backup");
+    case Restore:
+        return QStringLiteral("restore");
+    case Erase:
+        return QStringLiteral("erase");
+    case Wipe:
+        return QStringLiteral("wipe");
+    case Firmware:
+        return QStringLiteral("firmware");
+    case Core2Radio:
+        return QStringLiteral("core2radio");
+    case Core2FUS:
+        return QStringLiteral("core2fus");
+    default:
+        return QString();
+    }
+}
+
+void Cli::printMetrics(FlipperZero *device)
+{
+    if(!m_printMetrics || !device) {
+        return;
+    }
+
+    auto *metrics = device->rpc()->metrics();
+
+    if(!metrics->rowCount()) {
+        qCInfo(LOG_CLI) << "No RPC operations were performed.";
+        return;
+    }
+
+    const auto lines = metrics->summary().split(QLatin1Char('\n'));
+
+    for(const auto &line : lines) {
+        qCInfo(LOG_CLI).noquote() << line;
+    }
+
+    metrics->reset();
+}
+
 void Cli::verifyArgumentCount(int num)
 {
     const auto argCount = m_parser.positionalArguments().size();
@@ -1,11 +1,17 @@
 #pragma once
 
 #include <QUrl>
+#include <QTimer>
 #include <QCoreApplication>
 #include <QCommandLineParser>
 
+#include "fleetreport.h"
 #include "applicationbackend.h"
 
+namespace Flipper {
+class FlipperZero;
+}
+
 class Cli : public QCoreApplication
 {
     Q_OBJECT
@@ -25,7 +31,15 @@ class Cli : public QCoreApplication
     enum OptionIndex {
         DebugLevelOption = 0,
         RepeatNumberOption,
-        UpdateChannelOption
+        UpdateChannelOption,
+        MetricsOption,
+        AllDevicesOption,
+        SerialNumberOption,
+        JobsOption,
+        WaitOption,
+        ReportOption,
+        VerifyOption,
+        DifferentialOption
     };
 
 public:
@@ -36,6 +50,12 @@ private slots:
     void onBackendStateChanged();
     void onUpdateStateChanged();
 
+    void onFleetDevicesChanged();
+    void onFleetDeviceStarted(Flipper::FlipperZero *device);
+    void onFleetDeviceFinished(Flipper::FlipperZero *device);
+    void onFleetDeviceLost(const QString &deviceName);
+    void onFleetIdle();
+
 private:
     void initConnections();
     void initLogger();
@@ -47,6 +67,10 @@ private:
     void processDebugLevelOption();
     void processRepeatNumberOption();
     void processUpdateChannelOption();
+    void processMetricsOption();
+    void processVerifyOption();
+    void processDifferentialOption();
+    void processFleetOptions();
 
     void beginDefaultAction();
     void beginBackup();
@@ -58,6 +82,14 @@ private:
     void beginCore2FUS();
 
     void startPendingOperation();
+    void startFleetOperation(Flipper::FlipperZero *device);
+    void finishFleetOperation();
+
+    bool isFleetDeviceWanted(Flipper::FlipperZero *device) const;
+    bool isFirmwareReady() const;
+    const QString operationName() const;
+
+    void printMetrics(Flipper::FlipperZero *device);
     void verifyArgumentCount(int num);
 
     QCommandLineParser m_parser;
@@ -67,5 +99,13 @@ private:
     QUrl m_fileParameter;
     uint32_t m_core2Address;
     int m_repeatCount;
+    bool m_printMetrics;
+
+    bool m_isFleetMode;
+    bool m_isAllDevices;
+    QStringList m_serialNumbers;
+    QString m_reportFileName;
+    FleetReport *m_report;
+    QTimer m_idleTimer;
 };
 
@@ -58,10 +58,12 @@ INCLUDEPATH += \
 
 SOURCES += \
         main.cpp \
-        cli.cpp
+        cli.cpp \
+        fleetreport.cpp
 
 HEADERS += \
-    cli.h
+    cli.h \
+    fleetreport.h
 
 unix:!macx {
     target.path = $$PREFIX/bin
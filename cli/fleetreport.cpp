@@ -0,0 +1,159 @@
+#include "fleetreport.h"
+
+#include <algorithm>
+
+#include <QFile>
+#include <QStringList>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+FleetReport::FleetReport(const QString &operationName):
+    m_operationName(operationName)
+{}
+
+bool FleetReport::contains(const QString &name) const
+{
+    return m_entries.contains(name);
+}
+
+FleetReport::Entry &FleetReport::entry(const QString &name)
+{
+    auto &e = m_entries[name];
+    e.name = name;
+    return e;
+}
+
+int FleetReport::count() const
+{
+    return m_entries.size();
+}
+
+int FleetReport::count(Status status) const
+{
+    return std::count_if(m_entries.cbegin(), m_entries.cend(), [status](const Entry &e) {
+        return e.status == status;
+    });
+}
+
+bool FleetReport::isFinished() const
+{
+    return !count(Status::Pending) && !count(Status::Running);
+}
+
+bool FleetReport::save(const QString &fileName, QString *errorString) const
+{
+    QFile file(fileName);
+
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if(errorString) {
+            *errorString = file.errorString();
+        }
+
+        return false;
+    }
+
+    const auto data = fileName.endsWith(QStringLiteral(".csv"), Qt::CaseInsensitive) ? toCsv() : toJson();
+
+    if(file.write(data) != data.size()) {
+        if(errorString) {
+            *errorString = file.errorString();
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+const QString FleetReport::statusName(Status status)
+{
+    switch(status) {
+    case Status::Pending:
+        return QStringLiteral("pending");
+    case Status::Running:
+        return QStringLiteral("running");
+    case Status::Success:
+        return QStringLiteral("success");
+    case Status::Failed:
+        return QStringLiteral("failed");
+    case Status::Lost:
+        return QStringLiteral("lost");
+    default:
+        return QString();
+    }
+}
+
+const QString FleetReport::escapeCsv(const QString &value)
+{
+    static const QString specialChars = QStringLiteral(",\"\r\n");
+
+    const auto needsQuotes = std::any_of(value.cbegin(), value.cend(), [](const QChar &c) {
+        return specialChars.contains(c);
+    });
+
+    if(!needsQuotes) {
+        return value;
+    }
+
+    auto ret = value;
+    ret.replace(QLatin1Char('"'), QStringLiteral("\"\""));
+
+    return QStringLiteral("\"%1\"").arg(ret);
+}
+
+const QByteArray FleetReport::toJson() const
+{
+    QJsonArray devices;
+
+    for(const auto &e : m_entries) {
+        devices.append(QJsonObject {
+            {QStringLiteral("name"), e.name},
+            {QStringLiteral("serialNumber"), e.serialNumber},
+            {QStringLiteral("status"), statusName(e.status)},
+            {QStringLiteral("queuedAt"), e.queuedAt.toString(Qt::ISODateWithMs)},
+            {QStringLiteral("startedAt"), e.startedAt.toString(Qt::ISODateWithMs)},
+            {QStringLiteral("waitTimeMs"), e.waitTime},
+            {QStringLiteral("durationMs"), e.duration},
+            {QStringLiteral("firmwareBefore"), e.firmwareBefore},
+            {QStringLiteral("firmwareAfter"), e.firmwareAfter},
+            {QStringLiteral("error"), e.errorString}
+        });
+    }
+
+    const QJsonObject root {
+        {QStringLiteral("operation"), m_operationName},
+        {QStringLiteral("total"), count()},
+        {QStringLiteral("failed"), count(Status::Failed) + count(Status::Lost)},
+        {QStringLiteral("devices"), devices}
+    };
+
+    return QJsonDocument(root).toJson();
+}
+
+const QByteArray FleetReport::toCsv() const
+{
+    QStringList lines = {
+        QStringLiteral("name,serial_number,operation,status,queued_at,started_at,wait_time_ms,duration_ms,firmware_before,firmware_after,error")
+    };
+
+    for(const auto &e : m_entries) {
+        const QStringList fields = {
+            escapeCsv(e.name),
+            escapeCsv(e.serialNumber),
+            escapeCsv(m_operationName),
+            statusName(e.status),
+            e.queuedAt.toString(Qt::ISODateWithMs),
+            e.startedAt.toString(Qt::ISODateWithMs),
+            QString::number(e.waitTime),
+            QString::number(e.duration),
+            escapeCsv(e.firmwareBefore),
+            escapeCsv(e.firmwareAfter),
+            escapeCsv(e.errorString)
+        };
+
+        lines.append(fields.join(QLatin1Char(',')));
+    }
+
+    return lines.join(QLatin1Char('\n')).append(QLatin1Char('\n')).toUtf8();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QMap>
+#include <QString>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+// Per-device outcome of a fleet run, saved as JSON or CSV
+class FleetReport
+{
+public:
+    enum class Status {
+        Pending,
+        Running,
+        Success,
+        Failed,
+        Lost
+    };
+
+    struct Entry {
+        QString name;
+        QString serialNumber;
+        Status status = Status::Pending;
+
+        QDateTime queuedAt;
+        QDateTime startedAt;
+        qint64 waitTime = 0;
+        qint64 duration = 0;
+
+        QString firmwareBefore;
+        QString firmwareAfter;
+
+        QString errorString;
+
+        QElapsedTimer timer;
+    };
+
+    FleetReport(const QString &operationName);
+
+    bool contains(const QString &name) const;
+    Entry &entry(const QString &name);
+
+    int count() const;
+    int count(Status status) const;
+    bool isFinished() const;
+
+    // The format is chosen by the file extension: *.csv or JSON otherwise
+    bool save(const QString &fileName, QString *errorString = nullptr) const;
+
+private:
+    static const QString statusName(Status status);
+    static const QString escapeCsv(const QString &value);
+
+    const QByteArray toJson() const;
+    const QByteArray toCsv() const;
+
+    QString m_operationName;
+    QMap<QString, Entry> m_entries;
+};
@@ -12,6 +12,7 @@ SOURCES += \
     device/stm32wb55/stm32wb55.cpp \
     dfumemorylayout.cpp \
     dfusedevice.cpp \
+    dfusedownloader.cpp \
     dfusefile.cpp \
     usbdeviceinfo.cpp
 
@@ -25,6 +26,7 @@ HEADERS += \
     device/stm32wb55/versioninfo.h \
     dfumemorylayout.h \
     dfusedevice.h \
+    dfusedownloader.h \
     dfusefile.h \
     usbdevice.h \
     usbdeviceinfo.h
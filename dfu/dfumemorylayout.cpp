@@ -1,5 +1,7 @@
 #include "dfumemorylayout.h"
 
+#include <algorithm>
+
 #include <QDebug>
 
 #include "debug.h"
@@ -41,6 +43,8 @@ DFUMemoryLayout DFUMemoryLayout::fromStringDescriptor(const QByteArray &desc)
         ret.m_pageBanks.append(elem);
     }
 
+    ret.buildIndex();
+
     return ret;
 }
 
@@ -59,7 +63,22 @@ const QList<DFUMemoryLayout::PageBank> &DFUMemoryLayout::pageBanks() const
     return m_pageBanks;
 }
 
-// TODO: Try optimising it, the function will traverse all banks regardless of the start
+uint32_t DFUMemoryLayout::size() const
+{
+    return m_bankAddresses.isEmpty() ? 0 : m_bankAddresses.last() - m_address;
+}
+
+size_t DFUMemoryLayout::pageCount() const
+{
+    size_t ret = 0;
+
+    for(const auto &bank : m_pageBanks) {
+        ret += bank.pageCount;
+    }
+
+    return ret;
+}
+
 const QList<uint32_t> DFUMemoryLayout::pageAddresses(uint32_t start, uint32_t end) const
 {
     QList<uint32_t> ret;
@@ -74,18 +93,73 @@ const QList<uint32_t> DFUMemoryLayout::pageAddresses(uint32_t start, uint32_t en
 
     ret.append(start);
 
-    uint32_t currentAddress = m_address;
+    const auto firstBank = bankIndex(start);
 
-    for(const auto &bank : m_pageBanks) {
-        for(size_t i = 0; i < bank.pageCount; ++i) {
-            currentAddress += (uint32_t)bank.pageSize;
-            if((currentAddress > start) && (currentAddress < end)) {
-                ret.append(currentAddress);
-            } else if(currentAddress >= end) {
+    if(firstBank < 0) {
+        return ret;
+    }
+
+    // Start from the first page boundary after the start instead of the origin
+    for(auto i = firstBank; i < m_pageBanks.size(); ++i) {
+        const auto &bank = m_pageBanks.at(i);
+        const auto bankAddress = m_bankAddresses.at(i);
+
+        if(!bank.pageSize) {
+            continue;
+        }
+
+        const auto firstPage = (i == firstBank) ? (start - bankAddress) / bank.pageSize + 1 : 1;
+
+        for(auto j = firstPage; j <= bank.pageCount; ++j) {
+            const auto currentAddress = bankAddress + (uint32_t)(j * bank.pageSize);
+
+            if(currentAddress >= end) {
                 return ret;
             }
+
+            ret.append(currentAddress);
         }
     }
 
     return ret;
 }
+
+uint32_t DFUMemoryLayout::pageAddress(uint32_t addr) const
+{
+    const auto i = bankIndex(addr);
+
+    if((i < 0) || !m_pageBanks.at(i).pageSize) {
+        return addr;
+    }
+
+    const auto bankAddress = m_bankAddresses.at(i);
+    const auto pageSize = (uint32_t)m_pageBanks.at(i).pageSize;
+
+    return bankAddress + ((addr - bankAddress) / pageSize) * pageSize;
+}
+
+void DFUMemoryLayout::buildIndex()
+{
+    m_bankAddresses.clear();
+    m_bankAddresses.reserve(m_pageBanks.size() + 1);
+
+    auto currentAddress = m_address;
+
+    for(const auto &bank : qAsConst(m_pageBanks)) {
+        m_bankAddresses.append(currentAddress);
+        currentAddress += (uint32_t)(bank.pageSize * bank.pageCount);
+    }
+
+    m_bankAddresses.append(currentAddress);
+}
+
+int DFUMemoryLayout::bankIndex(uint32_t addr) const
+{
+    if(m_bankAddresses.isEmpty() || (addr < m_address) || (addr >= m_bankAddresses.last())) {
+        return -1;
+    }
+
+    // The last bank starting at or below the address
+    const auto it = std::upper_bound(m_bankAddresses.cbegin(), m_bankAddresses.cend() - 1, addr);
+    return (int)(it - m_bankAddresses.cbegin()) - 1;
+}
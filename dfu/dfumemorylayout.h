@@ -2,6 +2,7 @@
 #define DFUMEMORYLAYOUT_H
 
 #include <QList>
+#include <QVector>
 #include <QString>
 #include <QByteArray>
 
@@ -20,13 +21,23 @@ public:
     uint32_t address() const;
     const QList<PageBank> &pageBanks() const;
 
-    const QList<uint32_t> pageAddresses(uint32_t start, uint32_t end) const;
+    uint32_t size() const;
+    size_t pageCount() const;
 
+    const QList<uint32_t> pageAddresses(uint32_t start, uint32_t end) const;
+    // Start of the page containing addr, or addr itself if it is outside of the layout
+    uint32_t pageAddress(uint32_t addr) const;
 
 private:
+    void buildIndex();
+    int bankIndex(uint32_t addr) const;
+
     QString m_name;
-    uint32_t m_address;
+    uint32_t m_address = 0;
     QList<PageBank> m_pageBanks;
+
+    // Start address of each bank followed by the end of the last one
+    QVector<uint32_t> m_bankAddresses;
 };
 
 #endif // DFUMEMORYLAYOUT_H
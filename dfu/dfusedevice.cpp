@@ -1,22 +1,32 @@
 #include "dfusedevice.h"
 
 #include <cmath>
+#include <cstring>
+#include <algorithm>
 
+#include <QMap>
 #include <QThread>
 #include <QBuffer>
 #include <QByteArray>
+#include <QSignalBlocker>
 
 #include "debug.h"
 #include "dfumemorylayout.h"
+#include "dfusedownloader.h"
 
 #define REQUEST_OUT (USBRequest::ENDPOINT_OUT | USBRequest::REQUEST_TYPE_CLASS | USBRequest::RECIPIENT_INTERFACE)
 #define REQUEST_IN (USBRequest::ENDPOINT_IN | USBRequest::REQUEST_TYPE_CLASS | USBRequest::RECIPIENT_INTERFACE)
 
 #define DFU_DESCRIPTOR_LENGTH 9
 #define DFU_DESCRIPTOR_TYPE 0x21
+#define DFU_STATUS_LENGTH 6
+
+// Past this share of changed pages, rewriting everything at once is faster than page by page
+#define DIFFERENTIAL_MAX_CHANGED_RATIO 0.5
 
 DfuseDevice::DfuseDevice(const USBDeviceInfo &info, QObject *parent):
-    USBDevice(info, parent)
+    USBDevice(info, parent),
+    m_transferSize(0)
 {}
 
 bool DfuseDevice::beginTransaction()
@@ -33,25 +43,37 @@ bool DfuseDevice::endTransaction()
 
 uint32_t DfuseDevice::partitionOrigin(uint8_t alt)
 {
-    const auto desc = stringInterfaceDescriptor(alt);
-    const auto layout = DFUMemoryLayout::fromStringDescriptor(desc);
-    return layout.address();
+    return memoryLayout(alt).address();
 }
 
 bool DfuseDevice::erase(uint32_t addr, size_t maxSize)
+{
+    return erase(AddressRanges {{addr, addr + (uint32_t)maxSize}});
+}
+
+bool DfuseDevice::erase(const AddressRanges &ranges)
 {
     check_return_bool(prepare(), "Failed to prepare the device");
 
-    const auto layout = DFUMemoryLayout::fromStringDescriptor(stringInterfaceDescriptor(0));
-    const auto pageAddresses = layout.pageAddresses(addr, addr + (uint32_t)maxSize);
+    const auto &layout = memoryLayout(0);
+    const auto pageAddresses = planErase(layout, ranges);
 
     check_return_bool(!pageAddresses.isEmpty(), "Address list is empty");
 
+    if((size_t)pageAddresses.size() == layout.pageCount()) {
+        debug_msg("Erasing the whole memory at once");
+
+        check_return_bool(massErase(), "Failed to perform mass erase");
+        emit progressChanged(Operation::Erase, 100.0);
+
+        return true;
+    }
+
     size_t prevProgress = std::numeric_limits<size_t>::max();
 
-    for(const auto pageAddress: pageAddresses) {
-        check_return_bool(erasePage(pageAddress), "Failed to erase page");
-        const auto progress = (pageAddress - addr) * 100.0 / maxSize;
+    for(auto i = 0; i < pageAddresses.size(); ++i) {
+        check_return_bool(erasePage(pageAddresses.at(i)), "Failed to erase page");
+        const auto progress = (i + 1) * 100.0 / pageAddresses.size();
         emit progressChanged(Operation::Erase, progress);
 
         if(floor(progress) != prevProgress) {
@@ -71,13 +93,17 @@ bool DfuseDevice::download(DfuseFile *file)
     check_return_bool(file->isValid(), "DfuSe file is not valid");
     // TODO: check for vendor, device, etc.
 
-    // Erase the required memory first
+    AddressRanges ranges;
+
     for(auto &img : file->images()) {
         for(auto &elem : img.elements) {
-            check_return_bool(erase(elem.dwElementAddress, elem.dwElementSize), "Failed to erase the memory");
+            ranges.append({elem.dwElementAddress, elem.dwElementAddress + elem.dwElementSize});
         }
     }
 
+    // Erase the required memory first
+    check_return_bool(erase(ranges), "Failed to erase the memory");
+
     for(auto &img : file->images()) {
         for(auto &elem : img.elements) {
             QBuffer buf(&elem.data);
@@ -89,63 +115,200 @@ bool DfuseDevice::download(DfuseFile *file)
     return true;
 }
 
+bool DfuseDevice::downloadDifferential(DfuseFile *file, bool verifyRewritten)
+{
+    check_return_bool(file->isValid(), "DfuSe file is not valid");
+
+    if(hasSharedPages(file)) {
+        // Rewriting one element would erase a part of the other
+        debug_msg("Some elements share a flash page, falling back to full download");
+        return download(file);
+    }
+
+    for(auto &img : file->images()) {
+        for(auto &elem : img.elements) {
+            check_return_bool(downloadDifferential(elem.data, elem.dwElementAddress, img.prefix.bAlternateSetting, verifyRewritten), "Failed to download element");
+        }
+    }
+
+    return true;
+}
+
 bool DfuseDevice::download(const QByteArray &data)
 {
     check_return_bool(setInterfaceAltSetting(0, 0), "Failed to set interface alternate setting");
     check_return_bool(prepare(), "Failed to prepare the device");
 
     check_return_bool(controlTransfer(REQUEST_OUT, DFU_DNLOAD, 0, 0, data), "Failed to perform raw download request");
+    check_return_bool(waitWhileBusy().bStatus == StatusType::OK, "Failed to raw download a buffer");
 
-    StatusType status;
+    return true;
+}
 
-    do {
-        status = getStatus();
-        check_return_bool(status.bStatus == StatusType::OK, "Failed to raw download a buffer");
-        QThread::msleep(status.bwPollTimeout);
+bool DfuseDevice::download(QIODevice *file, uint32_t addr, uint8_t alt)
+{
+    check_return_bool(setInterfaceAltSetting(0, alt), "Failed to set interface alternate setting");
+    check_return_bool(prepare(), "Failed to prepare the device");
+    check_return_bool(setAddressPointer(addr), "Failed to set address pointer");
+
+    const auto maxTransferSize = transferSize();
+    check_return_bool(maxTransferSize, "No functional DFU descriptor");
+
+    DfuseDownloader downloader(this, file, maxTransferSize);
+
+    connect(&downloader, &DfuseDownloader::progressChanged, &downloader, [=](double progress) {
+        emit progressChanged(Operation::Download, progress);
+    });
 
-    } while(status.bState == StatusType::DFU_DNBUSY);
+    check_return_bool(downloader.exec(), "An error has occurred during download phase");
+
+    debug_msg("Download has finished.");
 
     return true;
 }
 
-bool DfuseDevice::download(QIODevice *file, uint32_t addr, uint8_t alt)
+bool DfuseDevice::downloadDifferential(const QByteArray &data, uint32_t addr, uint8_t alt, bool verifyRewritten)
+{
+    const auto downloadFull = [&]() {
+        QBuffer buf;
+        buf.setData(data);
+        buf.open(QIODevice::ReadOnly);
+
+        return erase(addr, data.size()) && download(&buf, addr, alt);
+    };
+
+    QByteArray current;
+    QBuffer currentBuf(&current);
+    currentBuf.open(QIODevice::WriteOnly);
+
+    if(!upload(&currentBuf, addr, data.size(), alt) || (current.size() != data.size())) {
+        // E.g. the flash is read protected
+        debug_msg("Failed to read back the memory, falling back to full download");
+        return downloadFull();
+    }
+
+    const auto &layout = memoryLayout(alt);
+    const auto pageAddresses = layout.pageAddresses(addr, addr + (uint32_t)data.size());
+
+    check_return_bool(!pageAddresses.isEmpty(), "Address list is empty");
+
+    // Consecutive changed pages as {offset, size} pairs
+    QList<QPair<int, int>> ranges;
+    auto changedPageCount = 0;
+
+    for(auto i = 0; i < pageAddresses.size(); ++i) {
+        const auto offset = (int)(pageAddresses.at(i) - addr);
+        const auto size = (i < pageAddresses.size() - 1 ? (int)(pageAddresses.at(i + 1) - addr) : data.size()) - offset;
+
+        if(!memcmp(data.constData() + offset, current.constData() + offset, size)) {
+            continue;
+        }
+
+        if(!ranges.isEmpty() && (ranges.last().first + ranges.last().second == offset)) {
+            ranges.last().second += size;
+        } else {
+            ranges.append({offset, size});
+        }
+
+        ++changedPageCount;
+    }
+
+    debug_msg(QString("Pages to rewrite: %1 of %2").arg(changedPageCount).arg(pageAddresses.size()));
+
+    if(changedPageCount > pageAddresses.size() * DIFFERENTIAL_MAX_CHANGED_RATIO) {
+        debug_msg("Most of the pages have changed, falling back to full download");
+        return downloadFull();
+    }
+
+    auto totalSize = 0;
+
+    for(const auto &range : qAsConst(ranges)) {
+        const auto rangeAddress = addr + (uint32_t)range.first;
+        const auto rangeData = data.mid(range.first, range.second);
+
+        QBuffer buf;
+        buf.setData(rangeData);
+        buf.open(QIODevice::ReadOnly);
+
+        {
+            // Report the progress of all ranges as a whole
+            QSignalBlocker blocker(this);
+
+            check_return_bool(erase(rangeAddress, rangeData.size()), "Failed to erase the memory");
+            check_return_bool(download(&buf, rangeAddress, alt), "Failed to write the memory");
+
+            if(verifyRewritten) {
+                buf.reset();
+                check_return_bool(verify(&buf, rangeAddress, alt), "Memory contents differ after writing");
+            }
+        }
+
+        totalSize += rangeData.size();
+        emit progressChanged(Operation::Download, totalSize * 100.0 / data.size());
+    }
+
+    emit progressChanged(Operation::Download, 100.0);
+
+    return true;
+}
+
+bool DfuseDevice::verify(DfuseFile *file)
+{
+    check_return_bool(file->isValid(), "DfuSe file is not valid");
+
+    for(auto &img : file->images()) {
+        for(auto &elem : img.elements) {
+            QBuffer buf(&elem.data);
+            buf.open(QIODevice::ReadOnly);
+            check_return_bool(verify(&buf, elem.dwElementAddress, img.prefix.bAlternateSetting), "Failed to verify element");
+        }
+    }
+
+    return true;
+}
+
+bool DfuseDevice::verify(QIODevice *file, uint32_t addr, uint8_t alt)
 {
     check_return_bool(setInterfaceAltSetting(0, alt), "Failed to set interface alternate setting");
-    check_return_bool(prepare(), "Failed to prepare the device");
+    check_return_bool(prepare() && abort(), "Failed to prepare the device");
     check_return_bool(setAddressPointer(addr), "Failed to set address pointer");
+    abort();
 
-    const auto extra = extraInterfaceDescriptor(0, DFU_DESCRIPTOR_TYPE, DFU_DESCRIPTOR_LENGTH);
-    check_return_bool(extra.size() >= DFU_DESCRIPTOR_LENGTH, "No functional DFU descriptor");
+    const auto maxTransferSize = transferSize();
+    check_return_bool(maxTransferSize, "No functional DFU descriptor");
 
-    const auto maxTransferSize = *((uint16_t*)(extra.data() + 5));
-    debug_msg(QString("Device reported transfer size: %1").arg(maxTransferSize));
+    const auto size = file->bytesAvailable();
 
-    StatusType status;
+    for(qint64 totalSize = 0, transaction = 2, prevProgress = -1; totalSize < size; ++transaction) {
+        const auto chunkSize = qMin<qint64>(maxTransferSize, size - totalSize);
 
-    for(size_t totalSize = 0, transaction = 2, prevProgress = std::numeric_limits<size_t>::max(); !file->atEnd(); ++transaction) {
-        const auto buf = file->read(maxTransferSize);
-        check_return_bool(controlTransfer(REQUEST_OUT, DFU_DNLOAD, (uint16_t)transaction, 0, buf), "Failed to perform DFU_DNLOAD transfer");
+        const auto expected = file->read(chunkSize);
+        check_return_bool(expected.size() == chunkSize, "Failed to read from input device");
 
-        do {
-            status = getStatus();
+        const auto actual = controlTransfer(REQUEST_IN, DFU_UPLOAD, (uint16_t)transaction, 0, (uint16_t)chunkSize);
+        check_return_bool(actual.size() == chunkSize, "Failed to read back the memory");
 
-            check_return_bool(status.bStatus == StatusType::OK, "An error has occurred during download phase");
-            QThread::msleep(status.bwPollTimeout);
+        if(actual != expected) {
+            const auto mismatch = std::mismatch(actual.cbegin(), actual.cend(), expected.cbegin());
+            const auto mismatchAddress = addr + (uint32_t)(totalSize + (mismatch.first - actual.cbegin()));
+            const auto pageAddress = memoryLayout(alt).pageAddress(mismatchAddress);
 
-        } while(status.bState != StatusType::DFU_DNLOAD_IDLE);
+            error_msg(QString("Memory contents differ at 0x%1 (page at 0x%2)").arg(mismatchAddress, 0, 16).arg(pageAddress, 0, 16));
+            return false;
+        }
 
-        totalSize += buf.size();
+        totalSize += chunkSize;
 
-        const auto progress = totalSize * 100.0 / file->size();
-        emit progressChanged(Operation::Download, progress);
+        const auto progress = totalSize * 100.0 / size;
+        emit progressChanged(Operation::Verify, progress);
 
         if(floor(progress) != prevProgress) {
             prevProgress = progress;
-            debug_msg(QString("Bytes downloaded: %1 %2%").arg(totalSize).arg(prevProgress));
+            debug_msg(QString("Bytes verified: %1 %2%").arg(totalSize).arg(prevProgress));
         }
     }
 
-    debug_msg("Download has finished.");
+    debug_msg("Verification has finished.");
 
     return true;
 }
@@ -157,12 +320,8 @@ bool DfuseDevice::upload(QIODevice *file, uint32_t addr, size_t maxSize, uint8_t
     check_return_bool(setAddressPointer(addr), "Failed to set address pointer");
     abort();
 
-    const auto extra = extraInterfaceDescriptor(0, DFU_DESCRIPTOR_TYPE, DFU_DESCRIPTOR_LENGTH);
-    check_return_bool(extra.size() >= DFU_DESCRIPTOR_LENGTH, "No functional DFU descriptor");
-
-    const auto maxTransferSize = *((uint16_t*)(extra.data() + 5));
-
-    debug_msg(QString("Device reported transfer size: %1").arg(maxTransferSize));
+    const auto maxTransferSize = transferSize();
+    check_return_bool(maxTransferSize, "No functional DFU descriptor");
 
     for(size_t totalSize = 0, transaction = 2, prevProgress = std::numeric_limits<size_t>::max(); totalSize < maxSize; ++transaction) {
 
@@ -211,36 +370,125 @@ bool DfuseDevice::leave()
     return true;
 }
 
+uint16_t DfuseDevice::transferSize()
+{
+    if(!m_transferSize) {
+        const auto extra = extraInterfaceDescriptor(0, DFU_DESCRIPTOR_TYPE, DFU_DESCRIPTOR_LENGTH);
+        check_return_val(extra.size() >= DFU_DESCRIPTOR_LENGTH, "No functional DFU descriptor", 0);
+
+        m_transferSize = *((uint16_t*)(extra.data() + 5));
+        debug_msg(QString("Device reported transfer size: %1").arg(m_transferSize));
+    }
+
+    return m_transferSize;
+}
+
+const DFUMemoryLayout &DfuseDevice::memoryLayout(uint8_t alt)
+{
+    auto it = m_memoryLayouts.find(alt);
+
+    if(it == m_memoryLayouts.end()) {
+        const auto layout = DFUMemoryLayout::fromStringDescriptor(stringInterfaceDescriptor(alt));
+
+        if(layout.pageBanks().isEmpty()) {
+            // Do not keep a broken one, it might have been a glitch
+            static const DFUMemoryLayout emptyLayout;
+            return emptyLayout;
+        }
+
+        it = m_memoryLayouts.insert(alt, layout);
+    }
+
+    return it.value();
+}
+
+bool DfuseDevice::hasSharedPages(DfuseFile *file)
+{
+    QMap<uint8_t, QMap<uint32_t, uint32_t>> elementRanges;
+
+    for(auto &img : file->images()) {
+        for(auto &elem : img.elements) {
+            elementRanges[img.prefix.bAlternateSetting].insert(elem.dwElementAddress, elem.dwElementAddress + elem.dwElementSize);
+        }
+    }
+
+    for(auto it = elementRanges.cbegin(); it != elementRanges.cend(); ++it) {
+        const auto &layout = memoryLayout(it.key());
+        const auto &ranges = it.value();
+
+        for(auto prev = ranges.cbegin(), next = prev + 1; (prev != ranges.cend()) && (next != ranges.cend()); ++prev, ++next) {
+            // The last page of one element is the first page of the next one
+            if((next.key() < prev.value()) || (layout.pageAddress(prev.value() - 1) == layout.pageAddress(next.key()))) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 bool DfuseDevice::setAddressPointer(uint32_t addr)
 {
     const auto requestData = QByteArray(1, 0x21) + QByteArray::fromRawData((char*)&addr, sizeof(uint32_t));
     check_return_bool(controlTransfer(REQUEST_OUT, DFU_DNLOAD, 0, 0, requestData), "Failed to perform set address request");
+    check_return_bool(waitWhileBusy().bStatus == StatusType::OK, "Failed to set address pointer");
 
-    StatusType status;
-
-    do {
-        status = getStatus();
-        check_return_bool(status.bStatus == StatusType::OK, "Failed to set address pointer");
-        QThread::msleep(status.bwPollTimeout);
+    return true;
+}
 
-    } while(status.bState == StatusType::DFU_DNBUSY);
+bool DfuseDevice::massErase()
+{
+    const auto buf = QByteArray(1, 0x41);
+    check_return_bool(controlTransfer(REQUEST_OUT, DFU_DNLOAD, 0, 0, buf), "Failed to perform DFU_DNLOAD transfer");
+    check_return_bool(waitWhileBusy().bStatus == StatusType::OK, "An error has occurred during mass erase");
 
     return true;
 }
 
-bool DfuseDevice::erasePage(uint32_t addr)
+const QList<uint32_t> DfuseDevice::planErase(const DFUMemoryLayout &layout, AddressRanges ranges)
 {
-    const auto buf = QByteArray(1, 0x41) + QByteArray((const char*)&addr, sizeof(uint32_t));
-    check_return_bool(controlTransfer(REQUEST_OUT, DFU_DNLOAD, 0, 0, buf), "Failed to perform DFU_DNLOAD transfer");
+    std::sort(ranges.begin(), ranges.end());
 
-    StatusType status;
+    AddressRanges merged;
 
-    do {
-        status = getStatus();
-        check_return_bool(status.bStatus == StatusType::OK, "An error has occurred during erase phase");
-        QThread::msleep(status.bwPollTimeout);
+    for(const auto &range : qAsConst(ranges)) {
+        if(range.second <= range.first) {
+            continue;
+        } else if(!merged.isEmpty() && (range.first <= merged.last().second)) {
+            merged.last().second = qMax(merged.last().second, range.second);
+        } else {
+            merged.append(range);
+        }
+    }
+
+    QList<uint32_t> ret;
+
+    for(const auto &range : qAsConst(merged)) {
+        auto pageAddresses = layout.pageAddresses(range.first, range.second);
+
+        if(pageAddresses.isEmpty()) {
+            continue;
+        }
 
-    } while(status.bState == StatusType::DFU_DNBUSY);
+        // The range may start in the middle of a page
+        pageAddresses.first() = layout.pageAddress(pageAddresses.first());
+
+        // Which may be the last page of the previous range
+        if(!ret.isEmpty() && (ret.last() == pageAddresses.first())) {
+            pageAddresses.removeFirst();
+        }
+
+        ret.append(pageAddresses);
+    }
+
+    return ret;
+}
+
+bool DfuseDevice::erasePage(uint32_t addr)
+{
+    const auto buf = QByteArray(1, 0x41) + QByteArray((const char*)&addr, sizeof(uint32_t));
+    check_return_bool(controlTransfer(REQUEST_OUT, DFU_DNLOAD, 0, 0, buf), "Failed to perform DFU_DNLOAD transfer");
+    check_return_bool(waitWhileBusy().bStatus == StatusType::OK, "An error has occurred during erase phase");
 
     return true;
 }
@@ -265,12 +513,38 @@ bool DfuseDevice::clearStatus()
 
 DfuseDevice::StatusType DfuseDevice::getStatus()
 {
-    StatusType ret;
+    return parseStatus(controlTransfer(REQUEST_IN, DFU_GETSTATUS, 0, 0, DFU_STATUS_LENGTH));
+}
+
+DfuseDevice::StatusType DfuseDevice::waitWhileBusy()
+{
+    forever {
+        const auto status = getStatus();
+
+        // No need to wait once the device is done
+        if((status.bStatus != StatusType::OK) || (status.bState != StatusType::DFU_DNBUSY)) {
+            return status;
+        }
+
+        QThread::msleep(status.bwPollTimeout);
+    }
+}
+
+bool DfuseDevice::submitDownload(uint16_t transaction, const QByteArray &data, const TransferHandler &handler)
+{
+    return submitControlTransfer(REQUEST_OUT, DFU_DNLOAD, transaction, 0, data, handler);
+}
 
-    const auto STATUS_LENGTH = 6;
-    const auto buf = controlTransfer(REQUEST_IN, DFU_GETSTATUS, 0, 0, STATUS_LENGTH);
+bool DfuseDevice::submitGetStatus(const TransferHandler &handler)
+{
+    return submitControlTransfer(REQUEST_IN, DFU_GETSTATUS, 0, 0, DFU_STATUS_LENGTH, handler);
+}
+
+DfuseDevice::StatusType DfuseDevice::parseStatus(const QByteArray &buf)
+{
+    StatusType ret;
 
-    check_return_val(buf.size() == STATUS_LENGTH, "Unable to get device status", ret);
+    check_return_val(buf.size() == DFU_STATUS_LENGTH, "Unable to get device status", ret);
 
     ret.bStatus = (StatusType::Status)buf[0];
     ret.bState = (StatusType::State)buf[4];
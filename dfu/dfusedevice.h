@@ -1,11 +1,13 @@
 #ifndef DFUDEVICE_H
 #define DFUDEVICE_H
 
+#include <QHash>
 #include <QIODevice>
 #include <QMetaEnum>
 
 #include "usbdevice.h"
 #include "dfusefile.h"
+#include "dfumemorylayout.h"
 
 // NOTE: This class should reveal about USB internals as little as possible.
 // TODO: Separate STM32 protocol and standard protocol into respective classes.
@@ -14,6 +16,8 @@ class DfuseDevice : public USBDevice
 {
     Q_OBJECT
 
+    friend class DfuseDownloader;
+
     struct StatusType {
         enum Status {
             OK = 0,
@@ -73,7 +77,8 @@ public:
     enum Operation {
         Erase,
         Download,
-        Upload
+        Upload,
+        Verify
     };
 
     DfuseDevice(const USBDeviceInfo &info, QObject *parent = nullptr);
@@ -83,25 +88,55 @@ public:
 
     uint32_t partitionOrigin(uint8_t alt = 0);
 
+    // {start, end} pairs
+    using AddressRanges = QList<QPair<uint32_t, uint32_t>>;
+
     bool erase(uint32_t addr, size_t maxSize);
+    // Erases every page touched by the ranges exactly once
+    bool erase(const AddressRanges &ranges);
     bool download(DfuseFile *file);
+    // Only erases and writes the pages whose content differs from the file,
+    // optionally reading the rewritten pages back to check them
+    bool downloadDifferential(DfuseFile *file, bool verifyRewritten = true);
     bool download(QIODevice *file, uint32_t addr, uint8_t alt = 0);
     bool download(const QByteArray &data);
     bool upload(QIODevice *file, uint32_t addr, size_t maxSize, uint8_t alt = 0);
+    // Compare the memory contents with the file as they are read back
+    bool verify(DfuseFile *file);
+    bool verify(QIODevice *file, uint32_t addr, uint8_t alt = 0);
     bool leave();
 
 signals:
     void progressChanged(const int, const double);
 
 private:
+    static StatusType parseStatus(const QByteArray &buf);
+
     bool abort();
 
     bool clearStatus();
     StatusType getStatus();
+    StatusType waitWhileBusy();
+
+    bool submitDownload(uint16_t transaction, const QByteArray &data, const TransferHandler &handler);
+    bool submitGetStatus(const TransferHandler &handler);
 
     bool prepare();
+
+    // Both are read from the device once and cached for its lifetime
+    uint16_t transferSize();
+    const DFUMemoryLayout &memoryLayout(uint8_t alt);
+
+    bool hasSharedPages(DfuseFile *file);
+    bool downloadDifferential(const QByteArray &data, uint32_t addr, uint8_t alt, bool verifyRewritten);
     bool setAddressPointer(uint32_t addr);
     bool erasePage(uint32_t addr);
+    bool massErase();
+
+    static const QList<uint32_t> planErase(const DFUMemoryLayout &layout, AddressRanges ranges);
+
+    uint16_t m_transferSize;
+    QHash<uint8_t, DFUMemoryLayout> m_memoryLayouts;
 };
 
 
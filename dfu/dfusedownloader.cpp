@@ -0,0 +1,265 @@
+#include "dfusedownloader.h"
+
+#include <cmath>
+
+#include <QTimer>
+#include <QThread>
+#include <QIODevice>
+#include <QElapsedTimer>
+
+#include "debug.h"
+#include "dfusedevice.h"
+
+#define RETRY_COUNT 25
+#define RETRY_INTERVAL_MS 50
+
+// Longest time to wait for the device to make any progress
+#define WATCHDOG_TIMEOUT_MS 10000
+// Upper bound of the poll timer latency when handling the USB events here
+#define EVENT_TIMEOUT_MS 5
+
+// First two are reserved for DfuSe commands
+#define FIRST_TRANSACTION 2
+
+DfuseDownloader::DfuseDownloader(DfuseDevice *device, QIODevice *file, uint16_t transferSize, QObject *parent):
+    QObject(parent),
+    m_device(device),
+    m_file(file),
+    m_transferSize(transferSize),
+    m_transaction(FIRST_TRANSACTION),
+    m_totalSize(0),
+    m_prevProgress(-1),
+    m_retryCount(RETRY_COUNT),
+    m_isSuccess(false),
+    m_isFinished(false),
+    m_pendingTransfers(0),
+    m_pollTimer(new QTimer(this)),
+    m_watchdogTimer(new QTimer(this))
+{
+    m_pollTimer->setSingleShot(true);
+    m_pollTimer->setTimerType(Qt::PreciseTimer);
+
+    m_watchdogTimer->setSingleShot(true);
+    m_watchdogTimer->setInterval(WATCHDOG_TIMEOUT_MS);
+
+    connect(m_pollTimer, &QTimer::timeout, this, &DfuseDownloader::requestStatus);
+    connect(m_watchdogTimer, &QTimer::timeout, this, &DfuseDownloader::onWatchdogTimeout);
+}
+
+bool DfuseDownloader::exec()
+{
+    QTimer::singleShot(0, this, &DfuseDownloader::start);
+    m_watchdogTimer->start();
+
+    if(DfuseDevice::hasEventHandler()) {
+        m_eventLoop.exec();
+
+    } else {
+        // Nobody else is going to complete the transfers
+        while(!m_isFinished) {
+            DfuseDevice::handleEvents(EVENT_TIMEOUT_MS);
+            m_eventLoop.processEvents();
+        }
+    }
+
+    waitForTransfers();
+
+    return m_isSuccess;
+}
+
+void DfuseDownloader::start()
+{
+    if(m_file->atEnd()) {
+        finish(true);
+        return;
+    }
+
+    readBlock();
+    sendBlock();
+}
+
+void DfuseDownloader::finish(bool success)
+{
+    m_isSuccess = success;
+    m_isFinished = true;
+
+    m_pollTimer->stop();
+    m_watchdogTimer->stop();
+    m_eventLoop.quit();
+
+    emit finished();
+}
+
+void DfuseDownloader::waitForTransfers()
+{
+    // The completion handlers refer to this object, and every transfer times out eventually
+    while(m_pendingTransfers.loadAcquire()) {
+        if(DfuseDevice::hasEventHandler()) {
+            QThread::msleep(1);
+        } else {
+            DfuseDevice::handleEvents(EVENT_TIMEOUT_MS);
+        }
+    }
+}
+
+void DfuseDownloader::readBlock()
+{
+    if(!m_nextBlock.isEmpty()) {
+        m_block.swap(m_nextBlock);
+        m_nextBlock.clear();
+    } else {
+        m_block = m_file->read(m_transferSize);
+    }
+}
+
+void DfuseDownloader::sendBlock()
+{
+    // Retries may still be scheduled after the watchdog has fired
+    if(m_isFinished) {
+        return;
+    }
+
+    m_pendingTransfers.ref();
+
+    const auto submitted = m_device->submitDownload(m_transaction, m_block, [this](bool success, const QByteArray &data) {
+        Q_UNUSED(data)
+
+        // Called from the USB event thread
+        QMetaObject::invokeMethod(this, [=]() {
+            onBlockSent(success);
+        }, Qt::QueuedConnection);
+
+        m_pendingTransfers.deref();
+    });
+
+    if(!submitted) {
+        m_pendingTransfers.deref();
+    }
+
+    if(!submitted && !retry(&DfuseDownloader::sendBlock)) {
+        error_msg("Failed to perform DFU_DNLOAD transfer");
+        finish(false);
+        return;
+    }
+
+    // Read ahead while the block is on its way
+    if(submitted && m_nextBlock.isEmpty() && !m_file->atEnd()) {
+        m_nextBlock = m_file->read(m_transferSize);
+    }
+}
+
+void DfuseDownloader::requestStatus()
+{
+    if(m_isFinished) {
+        return;
+    }
+
+    m_pendingTransfers.ref();
+
+    const auto submitted = m_device->submitGetStatus([this](bool success, const QByteArray &data) {
+        QElapsedTimer elapsed;
+        elapsed.start();
+
+        QMetaObject::invokeMethod(this, [=]() {
+            onStatusReceived(success, data, elapsed);
+        }, Qt::QueuedConnection);
+
+        m_pendingTransfers.deref();
+    });
+
+    if(!submitted) {
+        m_pendingTransfers.deref();
+    }
+
+    if(!submitted && !retry(&DfuseDownloader::requestStatus)) {
+        error_msg("Failed to perform DFU_GETSTATUS transfer");
+        finish(false);
+    }
+}
+
+void DfuseDownloader::onBlockSent(bool success)
+{
+    if(m_isFinished) {
+        return;
+
+    } else if(!success) {
+        if(!retry(&DfuseDownloader::sendBlock)) {
+            error_msg("Failed to perform DFU_DNLOAD transfer");
+            finish(false);
+        }
+
+        return;
+    }
+
+    m_retryCount = RETRY_COUNT;
+    requestStatus();
+}
+
+void DfuseDownloader::onStatusReceived(bool success, const QByteArray &data, const QElapsedTimer &elapsed)
+{
+    if(m_isFinished) {
+        return;
+
+    } else if(!success) {
+        if(!retry(&DfuseDownloader::requestStatus)) {
+            error_msg("Unable to get device status");
+            finish(false);
+        }
+
+        return;
+    }
+
+    m_retryCount = RETRY_COUNT;
+
+    const auto status = DfuseDevice::parseStatus(data);
+
+    if(status.bStatus != DfuseDevice::StatusType::OK) {
+        error_msg(QString("An error has occurred during download phase: status %1, state %2").arg(status.bStatus).arg(status.bState));
+        finish(false);
+        return;
+
+    } else if(status.bState != DfuseDevice::StatusType::DFU_DNLOAD_IDLE) {
+        // Part of the poll timeout has passed while the status was on its way here
+        m_pollTimer->start(qMax<qint64>(0, status.bwPollTimeout - elapsed.elapsed()));
+        return;
+    }
+
+    m_totalSize += m_block.size();
+    m_watchdogTimer->start();
+
+    const auto progress = m_totalSize * 100.0 / m_file->size();
+    emit progressChanged(progress);
+
+    if((int)floor(progress) != m_prevProgress) {
+        m_prevProgress = floor(progress);
+        debug_msg(QString("Bytes downloaded: %1 %2%").arg(m_totalSize).arg(m_prevProgress));
+    }
+
+    if(m_nextBlock.isEmpty() && m_file->atEnd()) {
+        finish(true);
+        return;
+    }
+
+    ++m_transaction;
+
+    readBlock();
+    sendBlock();
+}
+
+void DfuseDownloader::onWatchdogTimeout()
+{
+    error_msg("Device has stopped responding during download phase");
+    finish(false);
+}
+
+bool DfuseDownloader::retry(void (DfuseDownloader::*method)())
+{
+    if(!m_retryCount) {
+        return false;
+    }
+
+    --m_retryCount;
+
+    QTimer::singleShot(RETRY_INTERVAL_MS, this, method);
+    return true;
+}
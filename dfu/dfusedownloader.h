@@ -0,0 +1,70 @@
+#ifndef DFUSEDOWNLOADER_H
+#define DFUSEDOWNLOADER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QEventLoop>
+
+class QTimer;
+class QIODevice;
+class QElapsedTimer;
+class DfuseDevice;
+
+// Writes a file to the current address of a DfuseDevice using asynchronous transfers.
+// The next DFU_GETSTATUS is scheduled exactly after the device-reported poll timeout
+// and the next block is sent as soon as the device is idle, instead of sleeping in between.
+// USB events are handled in the calling thread unless a USBDeviceDetector already does it.
+class DfuseDownloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    DfuseDownloader(DfuseDevice *device, QIODevice *file, uint16_t transferSize, QObject *parent = nullptr);
+
+    // Blocks the calling thread until done, keeping its event loop running
+    bool exec();
+
+signals:
+    void progressChanged(double progress);
+    void finished();
+
+private:
+    void start();
+    void finish(bool success);
+    void waitForTransfers();
+
+    void readBlock();
+
+    void sendBlock();
+    void requestStatus();
+
+    void onBlockSent(bool success);
+    void onStatusReceived(bool success, const QByteArray &data, const QElapsedTimer &elapsed);
+    void onWatchdogTimeout();
+
+    bool retry(void (DfuseDownloader::*method)());
+
+    DfuseDevice *m_device;
+    QIODevice *m_file;
+    uint16_t m_transferSize;
+
+    QByteArray m_block;
+    QByteArray m_nextBlock;
+    uint16_t m_transaction;
+
+    qint64 m_totalSize;
+    int m_prevProgress;
+    int m_retryCount;
+    bool m_isSuccess;
+    bool m_isFinished;
+
+    // Decremented from the USB event thread
+    QAtomicInt m_pendingTransfers;
+
+    QTimer *m_pollTimer;
+    QTimer *m_watchdogTimer;
+    QEventLoop m_eventLoop;
+};
+
+#endif // DFUSEDOWNLOADER_H
@@ -1,6 +1,9 @@
 #include "dfusefile.h"
 
+#include <array>
+
 #include <QDebug>
+#include <QBuffer>
 
 #include "debug.h"
 
@@ -8,20 +11,25 @@ static const auto DFUSE_SUFFIX_SIZE = 16;
 
 DfuseFile::DfuseFile(QIODevice *file)
 {
-    m_isValid = readPrefix(file);
+    m_isValid = loadData(file);
+    check_return_void(m_isValid, "Failed to load DfuSe file");
+
+    QBuffer buf;
+    buf.setData(m_data);
+    buf.open(QIODevice::ReadOnly);
+
+    m_isValid = readPrefix(&buf);
     check_return_void(m_isValid, "Failed to read DfuSe file prefix");
 
     for(auto i = 0; i < m_prefix.bTargets; ++i) {
-        m_isValid = readImage(file);
+        m_isValid = readImage(&buf);
         check_return_void(m_isValid, "Failed to read DfuSe image");
     }
 
-    m_isValid = readSuffix(file);
+    m_isValid = readSuffix(&buf);
     check_return_void(m_isValid, "No valid DfuSe suffix");
 
-    file->reset();
-
-    m_isValid = checkCRC(file);
+    m_isValid = checkCRC();
     check_return_void(m_isValid, "Checksum doesn't match");
 }
 
@@ -45,6 +53,39 @@ QList<DfuseFile::Image> &DfuseFile::images()
     return m_images;
 }
 
+bool DfuseFile::loadData(QIODevice *file)
+{
+    auto *f = qobject_cast<QFile*>(file);
+
+    // Opening it again, so that the mapping outlives the caller's file
+    if(f && !f->fileName().isEmpty() && (f->size() > 0)) {
+        m_file.setFileName(f->fileName());
+
+        if(m_file.open(QIODevice::ReadOnly)) {
+            const auto *data = m_file.map(0, m_file.size());
+
+            if(data) {
+                m_data = QByteArray::fromRawData((const char*)data, m_file.size());
+                return true;
+            }
+
+            debug_msg(QStringLiteral("Failed to map the file, reading it instead: %1").arg(m_file.errorString()));
+            m_file.close();
+        }
+    }
+
+    auto *b = qobject_cast<QBuffer*>(file);
+
+    if(b && (b->pos() == 0)) {
+        // Already in memory
+        m_data = b->data();
+    } else {
+        m_data = file->readAll();
+    }
+
+    return !m_data.isEmpty();
+}
+
 bool DfuseFile::readPrefix(QIODevice *file)
 {
     const auto DFUSE_PREFIX_SIZE = 11;
@@ -103,49 +144,77 @@ bool DfuseFile::readImage(QIODevice *file)
     m_images.append(img);
 
     for(uint32_t i = 0; i < img.prefix.dwNbElements; ++i) {
-        readElement(file);
+        check_return_bool(readElement(file), "Not a valid DfuSe image element");
     }
 
     return true;
 }
 
-void DfuseFile::readElement(QIODevice *file)
+bool DfuseFile::readElement(QIODevice *file)
 {
     Image::Element el;
 
     file->read((char*)&el.dwElementAddress, sizeof(uint32_t));
     file->read((char*)&el.dwElementSize, sizeof(uint32_t));
-    el.data = file->read(el.dwElementSize);
+
+    check_return_bool(file->bytesAvailable() >= el.dwElementSize, "Element size exceeds the file size");
+
+    // Pointing into the file data instead of copying
+    el.data = QByteArray::fromRawData(m_data.constData() + file->pos(), el.dwElementSize);
+    file->seek(file->pos() + el.dwElementSize);
 
     m_images.last().elements.append(el);
+
+    return true;
 }
 
-bool DfuseFile::checkCRC(QIODevice *file)
+bool DfuseFile::checkCRC() const
 {
-    return m_suffix.dwCRC == generateCRC(file);
+    // The checksum covers everything but itself
+    return m_suffix.dwCRC == generateCRC(m_data.constData(), m_data.size() - sizeof(uint32_t));
 }
 
-uint32_t DfuseFile::generateCRC(QIODevice *file)
+// Slicing-by-8: eight lookup tables let the loop consume 8 bytes per iteration
+uint32_t DfuseFile::generateCRC(const char *data, size_t size)
 {
+    const auto LUT_COUNT = 8;
     const auto LUT_SIZE = 256;
-    uint32_t lut[LUT_SIZE];
 
-    for(auto i = 0; i < LUT_SIZE; ++i) {
-        uint32_t val = i;
+    static const auto lut = []() {
+        std::array<std::array<uint32_t, LUT_SIZE>, LUT_COUNT> ret;
+
+        for(auto i = 0; i < LUT_SIZE; ++i) {
+            uint32_t val = i;
 
-        for(auto j = 0; j < 8; ++j) {
-            val = (val & 1U) ? 0xEDB88320U ^ (val >> 1) : val >> 1;
+            for(auto j = 0; j < 8; ++j) {
+                val = (val & 1U) ? 0xEDB88320U ^ (val >> 1) : val >> 1;
+            }
+
+            ret[0][i] = val;
         }
 
-        lut[i] = val;
-    }
+        for(auto i = 0; i < LUT_SIZE; ++i) {
+            for(auto j = 1; j < LUT_COUNT; ++j) {
+                ret[j][i] = (ret[j - 1][i] >> 8) ^ ret[0][ret[j - 1][i] & UINT8_MAX];
+            }
+        }
+
+        return ret;
+    }();
 
+    const auto *p = (const uint8_t*)data;
     uint32_t val = UINT32_MAX;
-    uint8_t c;
 
-    while((size_t)file->bytesAvailable() > sizeof(uint32_t)) {
-        file->getChar((char*)&c);
-        val = lut[(val ^ c) & UINT8_MAX] ^ (val >> 8);
+    for(; size >= 8; size -= 8, p += 8) {
+        const auto lo = val ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        const auto hi = (uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+
+        val = lut[7][lo & UINT8_MAX] ^ lut[6][(lo >> 8) & UINT8_MAX] ^ lut[5][(lo >> 16) & UINT8_MAX] ^ lut[4][lo >> 24] ^
+              lut[3][hi & UINT8_MAX] ^ lut[2][(hi >> 8) & UINT8_MAX] ^ lut[1][(hi >> 16) & UINT8_MAX] ^ lut[0][hi >> 24];
+    }
+
+    for(; size; --size, ++p) {
+        val = lut[0][(val ^ *p) & UINT8_MAX] ^ (val >> 8);
     }
 
     return val;
@@ -1,6 +1,7 @@
 #ifndef DFUSEFILE_H
 #define DFUSEFILE_H
 
+#include <QFile>
 #include <QList>
 #include <QIODevice>
 #include <QByteArray>
@@ -38,6 +39,7 @@ public:
         struct Element {
             uint32_t dwElementAddress;
             uint32_t dwElementSize;
+            // Points into the file data, valid as long as the DfuseFile is
             QByteArray data;
         };
 
@@ -54,13 +56,19 @@ public:
     QList<Image> &images();
 
 private:
+    bool loadData(QIODevice *file);
+
     bool readPrefix(QIODevice *file);
     bool readSuffix(QIODevice *file);
     bool readImage(QIODevice *file);
-    void readElement(QIODevice *file);
-    bool checkCRC(QIODevice *file);
+    bool readElement(QIODevice *file);
+    bool checkCRC() const;
+
+    static uint32_t generateCRC(const char *data, size_t size);
 
-    static uint32_t generateCRC(QIODevice *file);
+    // Mapped into memory when possible
+    QFile m_file;
+    QByteArray m_data;
 
     bool m_isValid;
     Prefix m_prefix;
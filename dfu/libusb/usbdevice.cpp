@@ -1,13 +1,19 @@
 #include "usbdevice.h"
 
+#include <cstring>
+#include <cstdlib>
+
 #include <libusb.h>
 #include <QThread>
 
 #include "debug.h"
+#include "usbdevicedetector.h"
 
 #define RETRY_COUNT 25
 #define RETRY_INTERVAL_MS 50
 
+static void LIBUSB_CALL onTransferCompleted(libusb_transfer *transfer);
+
 struct USBDevice::USBDevicePrivate {
     libusb_device *libusbDevice = nullptr;
     libusb_device_handle *libusbDeviceHandle = nullptr;
@@ -120,6 +126,60 @@ QByteArray USBDevice::controlTransfer(uint8_t requestType, uint8_t request, uint
     return buf;
 }
 
+bool USBDevice::submitControlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, const QByteArray &data, const TransferHandler &handler)
+{
+    return submitControlTransfer(requestType, request, value, index, data, data.size(), handler);
+}
+
+bool USBDevice::submitControlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, uint16_t length, const TransferHandler &handler)
+{
+    return submitControlTransfer(requestType, request, value, index, QByteArray(), length, handler);
+}
+
+bool USBDevice::submitControlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, const QByteArray &data, uint16_t length, const TransferHandler &handler)
+{
+    auto *transfer = libusb_alloc_transfer(0);
+    check_return_bool(transfer, "Failed to allocate transfer");
+
+    // Both are freed by libusb after the completion callback has returned
+    auto *buf = (unsigned char*)malloc(LIBUSB_CONTROL_SETUP_SIZE + length);
+    transfer->flags = LIBUSB_TRANSFER_FREE_BUFFER | LIBUSB_TRANSFER_FREE_TRANSFER;
+
+    libusb_fill_control_setup(buf, requestType, request, value, index, length);
+
+    if(!data.isEmpty()) {
+        memcpy(buf + LIBUSB_CONTROL_SETUP_SIZE, data.constData(), length);
+    }
+
+    libusb_fill_control_transfer(transfer, m_p->libusbDeviceHandle, buf, onTransferCompleted, new TransferHandler(handler), m_timeout);
+
+    const auto err = libusb_submit_transfer(transfer);
+
+    if(err) {
+        error_msg(QString("Failed to submit control transfer: %1").arg(libusb_error_name(err)));
+
+        delete (TransferHandler*)transfer->user_data;
+        libusb_free_transfer(transfer);
+    }
+
+    return !err;
+}
+
+bool USBDevice::hasEventHandler()
+{
+    return USBDeviceDetector::isEventThreadRunning();
+}
+
+void USBDevice::handleEvents(int timeoutMs)
+{
+    timeval tv = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    const auto err = libusb_handle_events_timeout_completed(nullptr, &tv, nullptr);
+
+    if(err) {
+        error_msg(QString("Failed to handle USB events: %1").arg(libusb_error_name(err)));
+    }
+}
+
 QByteArray USBDevice::extraInterfaceDescriptor(int interfaceNum, uint8_t type, int length)
 {
     QByteArray ret;
@@ -167,3 +227,27 @@ QByteArray USBDevice::stringInterfaceDescriptor(uint8_t alt)
 
     return buf;
 }
+
+static void LIBUSB_CALL onTransferCompleted(libusb_transfer *transfer)
+{
+    auto *handler = (USBDevice::TransferHandler*)transfer->user_data;
+
+    const auto *setup = libusb_control_transfer_get_setup(transfer);
+    const auto isIn = setup->bmRequestType & LIBUSB_ENDPOINT_IN;
+    const auto length = libusb_le16_to_cpu(setup->wLength);
+
+    auto success = transfer->status == LIBUSB_TRANSFER_COMPLETED;
+    QByteArray data;
+
+    if(!success) {
+        error_msg(QString("Control transfer has failed with status %1").arg(transfer->status));
+    } else if(isIn) {
+        data = QByteArray((const char*)libusb_control_transfer_get_data(transfer), transfer->actual_length);
+    } else if(transfer->actual_length != length) {
+        debug_msg("Requested and transferred data size differ");
+        success = false;
+    } else {}
+
+    (*handler)(success, data);
+    delete handler;
+}
@@ -3,6 +3,8 @@
 
 #include <QObject>
 
+#include <functional>
+
 #include "usbdeviceinfo.h"
 
 class USBDevice : public QObject
@@ -25,10 +27,24 @@ public:
     bool controlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, const QByteArray &data);
     QByteArray controlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, uint16_t length);
 
+    // The handler may be called from another thread, e.g. the one handling USB events.
+    // For IN transfers, data contains the received bytes.
+    using TransferHandler = std::function<void(bool success, const QByteArray &data)>;
+
+    bool submitControlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, const QByteArray &data, const TransferHandler &handler);
+    bool submitControlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, uint16_t length, const TransferHandler &handler);
+
+    // Submitted transfers only complete while something handles the USB events.
+    // Without a background event handler, the caller has to call handleEvents() itself.
+    static bool hasEventHandler();
+    static void handleEvents(int timeoutMs);
+
     QByteArray extraInterfaceDescriptor(int interfaceNum, uint8_t type, int length);
     QByteArray stringInterfaceDescriptor(uint8_t alt);
 
 private:
+    bool submitControlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, const QByteArray &data, uint16_t length, const TransferHandler &handler);
+
     USBDevicePrivate *m_p = nullptr;
     unsigned long m_timeout = 1000;
 };
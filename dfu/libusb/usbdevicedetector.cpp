@@ -3,12 +3,15 @@
 #include <libusb.h>
 
 #include <QDebug>
-#include <QTimer>
 #include <QThread>
+#include <QFutureWatcher>
 #include <QLoggingCategory>
+#include <QtConcurrent/QtConcurrentRun>
 
 Q_LOGGING_CATEGORY(LOG_DETECTOR, "USB")
 
+static QAtomicInt eventThreadCount;
+
 static int libusbHotplugCallback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *user_data);
 #if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000107)
 static void libusbLogCallback(libusb_context *ctx, libusb_log_level logLevel, const char *text);
@@ -16,9 +19,12 @@ static void libusbLogCallback(libusb_context *ctx, libusb_log_level logLevel, co
 
 USBDeviceDetector::USBDeviceDetector(QObject *parent):
     QObject(parent),
-    m_timer(new QTimer(this))
+    m_eventThread(nullptr),
+    m_isStopping(0)
 {
-    connect(m_timer, &QTimer::timeout, this, &USBDeviceDetector::processEvents);
+    // Needed for the queued calls from the event thread
+    qRegisterMetaType<USBDeviceInfo>("USBDeviceInfo");
+
     libusb_init(nullptr);
 #if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000107)
     libusb_set_log_cb(nullptr, libusbLogCallback, LIBUSB_LOG_CB_GLOBAL);
@@ -27,6 +33,20 @@ USBDeviceDetector::USBDeviceDetector(QObject *parent):
 
 USBDeviceDetector::~USBDeviceDetector()
 {
+    stopEventThread();
+
+    // Descriptor readers must be done before libusb goes away
+    const auto watchers = findChildren<QFutureWatcher<USBDeviceInfo>*>();
+
+    for(auto *watcher : watchers) {
+        watcher->disconnect(this);
+        watcher->waitForFinished();
+    }
+
+    for(const auto &info : m_devices + m_pendingDevices + m_departedDevices) {
+        libusb_unref_device((libusb_device*)info.backendData().value<void*>());
+    }
+
     libusb_exit(nullptr);
 }
 
@@ -52,48 +72,129 @@ bool USBDeviceDetector::setWantedDevices(const QList<USBDeviceInfo> &wantedList)
         return false;
     }
 
-    m_timer->stop();
+    stopEventThread();
 
     for(const auto &info : wantedList) {
+        libusb_hotplug_callback_handle handle;
+
         const auto events = libusb_hotplug_event(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT);
         const auto err = libusb_hotplug_register_callback(nullptr, events, LIBUSB_HOTPLUG_ENUMERATE, info.vendorID(),
-                                                          info.productID(), LIBUSB_HOTPLUG_MATCH_ANY, libusbHotplugCallback, this, nullptr);
+                                                          info.productID(), LIBUSB_HOTPLUG_MATCH_ANY, libusbHotplugCallback, this, &handle);
         if(err) {
             qCDebug(LOG_DETECTOR) << "Failed to register hotplug callback";
             return false;
         }
+
+        m_callbackHandles.append(handle);
     }
 
-    m_timer->start(100);
+    startEventThread();
     return true;
 }
 
 void USBDeviceDetector::registerDevice(const USBDeviceInfo &deviceInfo)
 {
-    QTimer::singleShot(0, this, [=]() {
-        if(m_devices.contains(deviceInfo)) {
-            return;
-        }
+    // Keep the device around until it has been dealt with in the main thread
+    libusb_ref_device((libusb_device*)deviceInfo.backendData().value<void*>());
+    QMetaObject::invokeMethod(this, "onDeviceArrived", Qt::QueuedConnection, Q_ARG(USBDeviceInfo, deviceInfo));
+}
+
+void USBDeviceDetector::unregisterDevice(const USBDeviceInfo &deviceInfo)
+{
+    QMetaObject::invokeMethod(this, "onDeviceLeft", Qt::QueuedConnection, Q_ARG(USBDeviceInfo, deviceInfo));
+}
+
+void USBDeviceDetector::onDeviceArrived(const USBDeviceInfo &deviceInfo)
+{
+    if(m_devices.contains(deviceInfo) || m_pendingDevices.contains(deviceInfo) || m_departedDevices.contains(deviceInfo)) {
+        libusb_unref_device((libusb_device*)deviceInfo.backendData().value<void*>());
+        return;
+    }
 
-        m_devices.append(fillDeviceInfo(deviceInfo));
-        emit devicePluggedIn(m_devices.last());
+    m_pendingDevices.append(deviceInfo);
+
+    // Opening the device and reading its string descriptors takes a while
+    auto *watcher = new QFutureWatcher<USBDeviceInfo>(this);
+
+    connect(watcher, &QFutureWatcherBase::finished, this, [=]() {
+        watcher->deleteLater();
+        onDeviceInfoFilled(watcher->result());
     });
+
+    watcher->setFuture(QtConcurrent::run(&USBDeviceDetector::fillDeviceInfo, deviceInfo));
 }
 
-void USBDeviceDetector::unregisterDevice(const USBDeviceInfo &deviceInfo)
+void USBDeviceDetector::onDeviceLeft(const USBDeviceInfo &deviceInfo)
 {
-    if(!m_devices.contains(deviceInfo)) {
+    auto *dev = (libusb_device*)deviceInfo.backendData().value<void*>();
+
+    if(m_pendingDevices.removeOne(deviceInfo)) {
+        // Gone before being announced, but fillDeviceInfo() may still be using it.
+        // onDeviceInfoFilled() will let go of it once the descriptors are read.
+        m_departedDevices.append(deviceInfo);
+
+    } else if(m_devices.removeOne(deviceInfo)) {
+        emit deviceUnplugged(deviceInfo);
+        libusb_unref_device(dev);
+    }
+}
+
+void USBDeviceDetector::onDeviceInfoFilled(const USBDeviceInfo &deviceInfo)
+{
+    if(m_departedDevices.removeOne(deviceInfo)) {
+        libusb_unref_device((libusb_device*)deviceInfo.backendData().value<void*>());
+        return;
+
+    } else if(!m_pendingDevices.removeOne(deviceInfo)) {
         return;
     }
 
-    m_devices.removeOne(deviceInfo);
-    emit deviceUnplugged(deviceInfo);
+    m_devices.append(deviceInfo);
+    emit devicePluggedIn(deviceInfo);
 }
 
-void USBDeviceDetector::processEvents()
+void USBDeviceDetector::startEventThread()
 {
-    struct timeval timeout = {0, 10000};
-    libusb_handle_events_timeout_completed(nullptr, &timeout, nullptr);
+    m_isStopping.storeRelease(0);
+
+    m_eventThread = QThread::create([this]() {
+        while(!m_isStopping.loadAcquire()) {
+            // Sleeps until there is something to do
+            libusb_handle_events(nullptr);
+        }
+    });
+
+    m_eventThread->setObjectName(QStringLiteral("USB events"));
+    m_eventThread->start();
+
+    eventThreadCount.ref();
+}
+
+void USBDeviceDetector::stopEventThread()
+{
+    if(!m_eventThread) {
+        return;
+    }
+
+    m_isStopping.storeRelease(1);
+
+    // Deregistering a callback wakes up the event handler
+    for(const auto handle : qAsConst(m_callbackHandles)) {
+        libusb_hotplug_deregister_callback(nullptr, handle);
+    }
+
+    m_callbackHandles.clear();
+
+    m_eventThread->wait();
+    delete m_eventThread;
+    m_eventThread = nullptr;
+
+    eventThreadCount.deref();
+}
+
+bool USBDeviceDetector::isEventThreadRunning()
+{
+    return eventThreadCount.loadAcquire() > 0;
 }
 
 USBDeviceInfo USBDeviceDetector::fillDeviceInfo(const USBDeviceInfo &deviceInfo)
@@ -114,8 +215,15 @@ USBDeviceInfo USBDeviceDetector::fillDeviceInfo(const USBDeviceInfo &deviceInfo)
             if(status != LIBUSB_SUCCESS) {
                 qCDebug(LOG_DETECTOR) << "Failed to get device descriptor:" << libusb_strerror((libusb_error)status);
                 break;
+            } else if((desc.idVendor == 0) || (desc.idProduct == 0)) {
+                qCDebug(LOG_DETECTOR) << "Device descriptor received, but is invalid";
+                status = LIBUSB_ERROR_OTHER;
+                break;
             }
 
+            // The hotplug callback does not wait for the descriptor to become valid
+            newinfo = USBDeviceInfo(desc.idVendor, desc.idProduct).withBackendData(deviceInfo.backendData());
+
             status = libusb_open(dev, &handle);
             if(status != LIBUSB_SUCCESS) {
                 qCDebug(LOG_DETECTOR) << "Failed to open device:" << libusb_strerror((libusb_error)status);
@@ -159,35 +267,49 @@ USBDeviceInfo USBDeviceDetector::fillDeviceInfo(const USBDeviceInfo &deviceInfo)
 
     } while(--numRetries);
 
+#if defined(Q_OS_LINUX)
+    newinfo.setSystemPath(sysfsPath(dev));
+#endif
+
     return newinfo;
 }
 
+#if defined(Q_OS_LINUX)
+const QString USBDeviceDetector::sysfsPath(void *device)
+{
+    auto *dev = (libusb_device*)device;
+
+    // USB 3.0 specification allows up to 7 levels of hubs
+    uint8_t portNumbers[7];
+    const auto portCount = libusb_get_port_numbers(dev, portNumbers, sizeof(portNumbers));
+
+    if(portCount <= 0) {
+        return QString();
+    }
+
+    QStringList ports;
+
+    for(auto i = 0; i < portCount; ++i) {
+        ports.append(QString::number(portNumbers[i]));
+    }
+
+    // Same naming as the kernel uses, e.g. /sys/bus/usb/devices/1-2.4
+    return QStringLiteral("/sys/bus/usb/devices/%1-%2").arg(libusb_get_bus_number(dev)).arg(ports.join(QLatin1Char('.')));
+}
+#endif
+
 static int libusbHotplugCallback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *user_data) {
     Q_UNUSED(ctx)
 
-    auto numRetries = 20;
     auto *detector = (USBDeviceDetector*)user_data;
 
+    // Called from the event thread, so no waiting here. A descriptor that is
+    // not ready yet will be read again by fillDeviceInfo() in the background.
     libusb_device_descriptor desc = {};
-    int status;
+    const auto status = libusb_get_device_descriptor(dev, &desc);
 
-    do {
-        status = libusb_get_device_descriptor(dev, &desc);
-        if((status == LIBUSB_SUCCESS) && (desc.idVendor != 0) && (desc.idProduct != 0)) {
-            break;
-        }
-
-        QThread::msleep(20);
-
-    } while(--numRetries);
-
-    if(numRetries == 0) {
-        if(status != LIBUSB_SUCCESS) {
-            qCDebug(LOG_DETECTOR) << "Failed to get device descriptor:" << libusb_strerror((libusb_error)status);
-        } else {
-            qCDebug(LOG_DETECTOR) << "Device descriptor received, but is invalid";
-        }
-        return 0;
+    if(status != LIBUSB_SUCCESS) {
+        qCDebug(LOG_DETECTOR) << "Failed to get device descriptor:" << libusb_strerror((libusb_error)status);
     }
 
     const auto info = USBDeviceInfo(desc.idVendor, desc.idProduct).withBackendData(QVariant::fromValue((void*)dev));
@@ -2,10 +2,11 @@
 
 #include <QVector>
 #include <QObject>
+#include <QAtomicInt>
 
 #include "usbdeviceinfo.h"
 
-class QTimer;
+class QThread;
 
 class USBDeviceDetector : public QObject
 {
@@ -18,19 +19,39 @@ public:
     void setLogLevel(int logLevel);
     bool setWantedDevices(const QList <USBDeviceInfo> &wantedList);
 
+    // Thread-safe, called from the libusb event thread
     void registerDevice(const USBDeviceInfo &deviceInfo);
     void unregisterDevice(const USBDeviceInfo &deviceInfo);
 
+    // Whether any detector is currently handling libusb events in the background
+    static bool isEventThreadRunning();
+
 signals:
     void devicePluggedIn(const USBDeviceInfo&);
     void deviceUnplugged(const USBDeviceInfo&);
 
 private slots:
-    void processEvents();
+    void onDeviceArrived(const USBDeviceInfo &deviceInfo);
+    void onDeviceLeft(const USBDeviceInfo &deviceInfo);
+    void onDeviceInfoFilled(const USBDeviceInfo &deviceInfo);
 
 private:
+    void startEventThread();
+    void stopEventThread();
+
     static USBDeviceInfo fillDeviceInfo(const USBDeviceInfo &deviceInfo);
+#if defined(Q_OS_LINUX)
+    static const QString sysfsPath(void *device);
+#endif
+
+    QThread *m_eventThread;
+    // Written by the main thread, read by the event thread
+    QAtomicInt m_isStopping;
+    QVector<int> m_callbackHandles;
 
-    QTimer *m_timer;
     QVector<USBDeviceInfo> m_devices;
+    // Devices with descriptors still being read
+    QVector<USBDeviceInfo> m_pendingDevices;
+    // Devices that left while their descriptors were still being read
+    QVector<USBDeviceInfo> m_departedDevices;
 };
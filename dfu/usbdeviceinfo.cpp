@@ -67,6 +67,11 @@ const QString &USBDeviceInfo::serialNumber() const
     return m_serialNumber;
 }
 
+const QString &USBDeviceInfo::systemPath() const
+{
+    return m_systemPath;
+}
+
 const QVariant &USBDeviceInfo::backendData() const
 {
     return m_backendData;
@@ -87,6 +92,11 @@ void USBDeviceInfo::setSerialNumber(const QString &serialNumber)
     m_serialNumber = serialNumber;
 }
 
+void USBDeviceInfo::setSystemPath(const QString &systemPath)
+{
+    m_systemPath = systemPath;
+}
+
 bool USBDeviceInfo::operator ==(const USBDeviceInfo &other) const
 {
     return m_backendData == other.m_backendData;
@@ -23,11 +23,15 @@ public:
     const QString &productDescription() const;
     const QString &serialNumber() const;
 
+    // Platform-specific device location, e.g. the sysfs directory on Linux. May be empty.
+    const QString &systemPath() const;
+
     const QVariant &backendData() const;
 
     void setManufacturer(const QString &manufacturer);
     void setProductDescription(const QString &productDescription);
     void setSerialNumber(const QString &serialNumber);
+    void setSystemPath(const QString &systemPath);
 
     bool operator ==(const USBDeviceInfo &other) const;
 
@@ -38,6 +42,7 @@ private:
     QString m_manufacturer;
     QString m_productDescription;
     QString m_serialNumber;
+    QString m_systemPath;
 
     QVariant m_backendData;
 };
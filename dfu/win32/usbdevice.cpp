@@ -154,6 +154,30 @@ QByteArray USBDevice::controlTransfer(uint8_t requestType, uint8_t request, uint
     return buf;
 }
 
+bool USBDevice::submitControlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, const QByteArray &data, const TransferHandler &handler)
+{
+    // No USB event thread here, completing the transfer right away
+    handler(controlTransfer(requestType, request, value, index, data), QByteArray());
+    return true;
+}
+
+bool USBDevice::submitControlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, uint16_t length, const TransferHandler &handler)
+{
+    const auto buf = controlTransfer(requestType, request, value, index, length);
+    handler(!buf.isEmpty(), buf);
+    return true;
+}
+
+bool USBDevice::hasEventHandler()
+{
+    return true;
+}
+
+void USBDevice::handleEvents(int timeoutMs)
+{
+    Q_UNUSED(timeoutMs)
+}
+
 QByteArray USBDevice::extraInterfaceDescriptor(int interfaceNum, uint8_t type, int length)
 {
     Q_UNUSED(interfaceNum);
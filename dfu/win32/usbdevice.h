@@ -2,6 +2,8 @@
 
 #include <QObject>
 
+#include <functional>
+
 #include "usbdeviceinfo.h"
 
 class USBDevice : public QObject
@@ -24,6 +26,18 @@ public:
     bool controlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, const QByteArray &data);
     QByteArray controlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, uint16_t length);
 
+    // The handler may be called from another thread, e.g. the one handling USB events.
+    // For IN transfers, data contains the received bytes.
+    using TransferHandler = std::function<void(bool success, const QByteArray &data)>;
+
+    bool submitControlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, const QByteArray &data, const TransferHandler &handler);
+    bool submitControlTransfer(uint8_t requestType, uint8_t request, uint16_t value, uint16_t index, uint16_t length, const TransferHandler &handler);
+
+    // Same interface as the libusb backend. Transfers complete on submission here,
+    // so there are never any events left to handle.
+    static bool hasEventHandler();
+    static void handleEvents(int timeoutMs);
+
     QByteArray extraInterfaceDescriptor(int interfaceNum, uint8_t type, int length);
     QByteArray stringInterfaceDescriptor(uint8_t alt);
 
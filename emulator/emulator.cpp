@@ -0,0 +1,114 @@
+#include "emulator.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include "emulatorconnection.h"
+
+using namespace Flipper;
+using namespace Zero;
+
+Emulator::Emulator(const QString &rootPath, QObject *parent):
+    QObject(parent),
+    m_server(new QLocalServer(this)),
+    m_connection(nullptr),
+    m_rootDir(rootPath),
+    m_latency(0),
+    m_bandwidth(0),
+    m_versionMinor(14)
+{
+    connect(m_server, &QLocalServer::newConnection, this, &Emulator::onNewConnection);
+}
+
+Emulator::~Emulator()
+{
+    close();
+}
+
+bool Emulator::listen(const QString &serverName)
+{
+    // Clean up after a crashed instance
+    QLocalServer::removeServer(serverName);
+    return m_server->listen(serverName);
+}
+
+void Emulator::close()
+{
+    if(m_connection) {
+        m_connection->deleteLater();
+        m_connection = nullptr;
+    }
+
+    m_server->close();
+}
+
+const QString Emulator::serverName() const
+{
+    return m_server->serverName();
+}
+
+const QString Emulator::errorString() const
+{
+    return m_server->errorString();
+}
+
+const QDir &Emulator::rootDir() const
+{
+    return m_rootDir;
+}
+
+int Emulator::latency() const
+{
+    return m_latency;
+}
+
+void Emulator::setLatency(int msecs)
+{
+    m_latency = qMax(0, msecs);
+}
+
+qint64 Emulator::bandwidth() const
+{
+    return m_bandwidth;
+}
+
+void Emulator::setBandwidth(qint64 bytesPerSecond)
+{
+    // Zero means unlimited
+    m_bandwidth = qMax<qint64>(0, bytesPerSecond);
+}
+
+uint32_t Emulator::protobufVersionMinor() const
+{
+    return m_versionMinor;
+}
+
+void Emulator::setProtobufVersionMinor(uint32_t versionMinor)
+{
+    m_versionMinor = versionMinor;
+}
+
+void Emulator::onNewConnection()
+{
+    while(m_server->hasPendingConnections()) {
+        auto *socket = m_server->nextPendingConnection();
+
+        // Just like the real device, only one RPC session at a time
+        if(m_connection) {
+            socket->disconnectFromServer();
+            socket->deleteLater();
+            continue;
+        }
+
+        m_connection = new EmulatorConnection(socket, this);
+
+        connect(m_connection, &EmulatorConnection::finished, this, [=]() {
+            m_connection->deleteLater();
+            m_connection = nullptr;
+
+            emit sessionFinished();
+        });
+
+        emit sessionStarted();
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QDir>
+#include <QObject>
+
+class QLocalServer;
+
+namespace Flipper {
+namespace Zero {
+
+class EmulatorConnection;
+
+/*
+ * In-process Flipper Zero emulator for benchmarking and testing without hardware.
+ *
+ * Accepts RPC sessions over a QLocalSocket (see ProtobufSession::setLocalServer())
+ * and serves the storage, system and gui requests against a directory on disk.
+ * Link latency and bandwidth can be limited to mimic a real device.
+ */
+
+class Emulator : public QObject
+{
+    Q_OBJECT
+
+public:
+    Emulator(const QString &rootPath, QObject *parent = nullptr);
+    ~Emulator();
+
+    bool listen(const QString &serverName);
+    void close();
+
+    const QString serverName() const;
+    const QString errorString() const;
+
+    const QDir &rootDir() const;
+
+    int latency() const;
+    void setLatency(int msecs);
+
+    qint64 bandwidth() const;
+    void setBandwidth(qint64 bytesPerSecond);
+
+    uint32_t protobufVersionMinor() const;
+    void setProtobufVersionMinor(uint32_t versionMinor);
+
+signals:
+    void sessionStarted();
+    void sessionFinished();
+
+private slots:
+    void onNewConnection();
+
+private:
+    QLocalServer *m_server;
+    EmulatorConnection *m_connection;
+    QDir m_rootDir;
+    int m_latency;
+    qint64 m_bandwidth;
+    uint32_t m_versionMinor;
+};
+
+}
+}
+
@@ -0,0 +1,34 @@
+QT -= gui
+QT += network
+
+TEMPLATE = lib
+CONFIG += staticlib c++11
+
+include(../qflipper_common.pri)
+
+INCLUDEPATH += \
+    $$PWD/../3rdparty/nanopb \
+    $$PWD/../plugins/flipperproto0
+
+DEFINES += PB_ENABLE_MALLOC
+
+SOURCES += \
+    emulator.cpp \
+    emulatorconnection.cpp
+
+HEADERS += \
+    emulator.h \
+    emulatorconnection.h
+
+# The static protobuf plugin already contains the message descriptors
+!contains(CONFIG, static) {
+    SOURCES += \
+        ../plugins/flipperproto0/messages/application.pb.c \
+        ../plugins/flipperproto0/messages/flipper.pb.c \
+        ../plugins/flipperproto0/messages/gpio.pb.c \
+        ../plugins/flipperproto0/messages/gui.pb.c \
+        ../plugins/flipperproto0/messages/property.pb.c \
+        ../plugins/flipperproto0/messages/status.pb.c \
+        ../plugins/flipperproto0/messages/storage.pb.c \
+        ../plugins/flipperproto0/messages/system.pb.c
+}
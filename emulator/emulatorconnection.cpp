@@ -0,0 +1,666 @@
+#include "emulatorconnection.h"
+
+#include <QTimer>
+#include <QVector>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QLocalSocket>
+#include <QStorageInfo>
+#include <QCryptographicHash>
+
+#include "pb_encode.h"
+#include "pb_decode.h"
+
+#include "emulator.h"
+
+// Same chunk size as the firmware uses for storage reads
+static constexpr qint64 READ_CHUNK_SIZE = 512;
+// Maximum number of directory entries in a single list response
+static constexpr int LIST_CHUNK_SIZE = sizeof(PB_Storage_ListResponse::file) / sizeof(PB_Storage_File);
+// Allow short bursts, but never less than one full storage write request
+static constexpr qint64 MIN_BUCKET_SIZE = 8 * 1024;
+
+using namespace Flipper;
+using namespace Zero;
+
+static bool isStorageRequest(pb_size_t tag)
+{
+    switch(tag) {
+    case PB_Main_storage_info_request_tag:
+    case PB_Main_storage_stat_request_tag:
+    case PB_Main_storage_list_request_tag:
+    case PB_Main_storage_read_request_tag:
+    case PB_Main_storage_write_request_tag:
+    case PB_Main_storage_delete_request_tag:
+    case PB_Main_storage_mkdir_request_tag:
+    case PB_Main_storage_md5sum_request_tag:
+    case PB_Main_storage_rename_request_tag:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static pb_bytes_array_t *makeBytesArray(const QByteArray &data)
+{
+    auto *ret = (pb_bytes_array_t*)malloc(PB_BYTES_ARRAY_T_ALLOCSIZE(data.size()));
+    ret->size = data.size();
+    memcpy(ret->bytes, data.data(), data.size());
+    return ret;
+}
+
+EmulatorConnection::EmulatorConnection(QLocalSocket *socket, Emulator *emulator):
+    QObject(emulator),
+    m_socket(socket),
+    m_emulator(emulator),
+    m_linkTimer(new QTimer(this)),
+    m_rxTokens(0),
+    m_txTokens(0),
+    m_lastRefill(0),
+    m_writeId(0)
+{
+    m_socket->setParent(this);
+
+    m_linkTimer->setSingleShot(true);
+    m_linkTimer->setInterval(1);
+
+    connect(m_linkTimer, &QTimer::timeout, this, &EmulatorConnection::processLink);
+    connect(m_socket, &QLocalSocket::readyRead, this, &EmulatorConnection::onSocketReadyRead);
+    connect(m_socket, &QLocalSocket::disconnected, this, &EmulatorConnection::onSocketDisconnected);
+
+    m_clock.start();
+}
+
+EmulatorConnection::~EmulatorConnection()
+{
+    m_socket->disconnect(this);
+    m_socket->abort();
+}
+
+void EmulatorConnection::onSocketReadyRead()
+{
+    m_rxBuffer.append(m_socket->readAll());
+    processLink();
+}
+
+void EmulatorConnection::onSocketDisconnected()
+{
+    m_linkTimer->stop();
+    m_writeFile.close();
+
+    emit finished();
+}
+
+void EmulatorConnection::processLink()
+{
+    refillTokens();
+
+    int offset = 0;
+
+    for(;;) {
+        const auto frameSize = nextFrameSize(m_rxBuffer.constData() + offset, m_rxBuffer.size() - offset);
+
+        if(frameSize < 0 || offset + frameSize > m_rxBuffer.size()) {
+            break;
+        } else if(m_emulator->bandwidth() > 0) {
+            // Let oversized frames through once the bucket is full
+            if(m_rxTokens < qMin(frameSize, bucketSize())) {
+                break;
+            }
+
+            m_rxTokens = qMax<qint64>(0, m_rxTokens - frameSize);
+        }
+
+        PB_Main request = PB_Main_init_zero;
+        pb_istream_t s = pb_istream_from_buffer((const pb_byte_t*)m_rxBuffer.constData() + offset, frameSize);
+
+        if(pb_decode_ex(&s, &PB_Main_msg, &request, PB_DECODE_DELIMITED)) {
+            processRequest(request);
+            pb_release(&PB_Main_msg, &request);
+        } else {
+            sendEmpty(0, PB_CommandStatus_ERROR_DECODE);
+        }
+
+        offset += frameSize;
+    }
+
+    m_rxBuffer.remove(0, offset);
+
+    while(!m_txQueue.isEmpty()) {
+        auto &packet = m_txQueue.head();
+
+        if(packet.dueTime > m_clock.elapsed()) {
+            break;
+        }
+
+        const auto nbytes = takeBudget(m_txTokens, packet.data.size());
+
+        if(nbytes == 0) {
+            break;
+        }
+
+        m_socket->write(packet.data.constData(), nbytes);
+
+        if(nbytes == packet.data.size()) {
+            m_txQueue.dequeue();
+        } else {
+            packet.data.remove(0, nbytes);
+        }
+    }
+
+    m_socket->flush();
+    scheduleLink();
+}
+
+void EmulatorConnection::processRequest(const PB_Main &request)
+{
+    // Mimic the firmware: any other storage request breaks a continuous write
+    if(m_writeFile.isOpen() && isStorageRequest(request.which_content) && request.command_id != m_writeId) {
+        abortStorageWrite();
+    }
+
+    switch(request.which_content) {
+    case PB_Main_system_ping_request_tag: systemPing(request); break;
+    case PB_Main_system_device_info_request_tag: systemDeviceInfo(request); break;
+    case PB_Main_system_protobuf_version_request_tag: systemProtobufVersion(request); break;
+    case PB_Main_system_get_datetime_request_tag: systemGetDateTime(request); break;
+    case PB_Main_system_reboot_request_tag: systemReboot(request); break;
+
+    case PB_Main_storage_info_request_tag: storageInfo(request); break;
+    case PB_Main_storage_stat_request_tag: storageStat(request); break;
+    case PB_Main_storage_list_request_tag: storageList(request); break;
+    case PB_Main_storage_read_request_tag: storageRead(request); break;
+    case PB_Main_storage_write_request_tag: storageWrite(request); break;
+    case PB_Main_storage_mkdir_request_tag: storageMkdir(request); break;
+    case PB_Main_storage_delete_request_tag: storageDelete(request); break;
+    case PB_Main_storage_rename_request_tag: storageRename(request); break;
+    case PB_Main_storage_md5sum_request_tag: storageMd5Sum(request); break;
+
+    case PB_Main_property_get_request_tag: propertyGet(request); break;
+
+    // Nothing to emulate here, just acknowledge
+    case PB_Main_system_set_datetime_request_tag:
+    case PB_Main_system_factory_reset_request_tag:
+    case PB_Main_gui_start_screen_stream_request_tag:
+    case PB_Main_gui_stop_screen_stream_request_tag:
+    case PB_Main_gui_start_virtual_display_request_tag:
+    case PB_Main_gui_stop_virtual_display_request_tag:
+    case PB_Main_gui_send_input_event_request_tag:
+        sendEmpty(request.command_id);
+        break;
+
+    // The device does not reply to these
+    case PB_Main_gui_screen_frame_tag:
+        break;
+
+    default:
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_NOT_IMPLEMENTED);
+    }
+}
+
+void EmulatorConnection::systemPing(const PB_Main &request)
+{
+    PB_Main response = PB_Main_init_zero;
+    response.command_id = request.command_id;
+    response.which_content = PB_Main_system_ping_response_tag;
+    // Only borrowed, the request still owns the data
+    response.content.system_ping_response.data = request.content.system_ping_request.data;
+
+    sendMessage(response);
+}
+
+static const QVector<QPair<QByteArray, QByteArray>> &deviceInfoProperties()
+{
+    static const QVector<QPair<QByteArray, QByteArray>> properties = {
+        {QByteArrayLiteral("hardware.name"), QByteArrayLiteral("Emulator")},
+        {QByteArrayLiteral("hardware.ver"), QByteArrayLiteral("12")},
+        {QByteArrayLiteral("hardware.target"), QByteArrayLiteral("7")},
+        {QByteArrayLiteral("hardware.body"), QByteArrayLiteral("9")},
+        {QByteArrayLiteral("hardware.connect"), QByteArrayLiteral("6")},
+        {QByteArrayLiteral("hardware.color"), QByteArrayLiteral("0")},
+        {QByteArrayLiteral("hardware.region.builtin"), QByteArrayLiteral("0")},
+        {QByteArrayLiteral("firmware.version"), QByteArrayLiteral("0.0.0")},
+        {QByteArrayLiteral("firmware.commit.hash"), QByteArrayLiteral("00000000")},
+        {QByteArrayLiteral("firmware.branch.name"), QByteArrayLiteral("emulator")},
+        {QByteArrayLiteral("firmware.build.date"), QByteArrayLiteral("01-01-2022")},
+        {QByteArrayLiteral("radio.alive"), QByteArrayLiteral("false")},
+    };
+
+    return properties;
+}
+
+void EmulatorConnection::systemDeviceInfo(const PB_Main &request)
+{
+    const auto &properties = deviceInfoProperties();
+
+    for(auto it = properties.cbegin(); it != properties.cend(); ++it) {
+        // Legacy keys use underscores instead of dots
+        auto key = it->first;
+        key.replace('.', '_');
+        auto value = it->second;
+
+        PB_Main response = PB_Main_init_zero;
+        response.command_id = request.command_id;
+        response.has_next = std::next(it) != properties.cend();
+        response.which_content = PB_Main_system_device_info_response_tag;
+        response.content.system_device_info_response.key = key.data();
+        response.content.system_device_info_response.value = value.data();
+
+        sendMessage(response);
+    }
+}
+
+void EmulatorConnection::systemProtobufVersion(const PB_Main &request)
+{
+    PB_Main response = PB_Main_init_zero;
+    response.command_id = request.command_id;
+    response.which_content = PB_Main_system_protobuf_version_response_tag;
+    response.content.system_protobuf_version_response.major = 0;
+    response.content.system_protobuf_version_response.minor = m_emulator->protobufVersionMinor();
+
+    sendMessage(response);
+}
+
+void EmulatorConnection::systemGetDateTime(const PB_Main &request)
+{
+    const auto now = QDateTime::currentDateTime();
+
+    PB_Main response = PB_Main_init_zero;
+    response.command_id = request.command_id;
+    response.which_content = PB_Main_system_get_datetime_response_tag;
+
+    auto &content = response.content.system_get_datetime_response;
+    content.has_datetime = true;
+    content.datetime.hour = now.time().hour();
+    content.datetime.minute = now.time().minute();
+    content.datetime.second = now.time().second();
+    content.datetime.day = now.date().day();
+    content.datetime.month = now.date().month();
+    content.datetime.year = now.date().year();
+    content.datetime.weekday = now.date().dayOfWeek();
+
+    sendMessage(response);
+}
+
+void EmulatorConnection::systemReboot(const PB_Main &request)
+{
+    Q_UNUSED(request)
+
+    // The device drops the connection without replying
+    m_socket->disconnectFromServer();
+}
+
+void EmulatorConnection::storageInfo(const PB_Main &request)
+{
+    const QFileInfo fileInfo(localPath(request.content.storage_info_request.path));
+
+    if(!fileInfo.isDir()) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_NOT_EXIST);
+        return;
+    }
+
+    const QStorageInfo storageInfo(fileInfo.absoluteFilePath());
+
+    PB_Main response = PB_Main_init_zero;
+    response.command_id = request.command_id;
+    response.which_content = PB_Main_storage_info_response_tag;
+    response.content.storage_info_response.total_space = storageInfo.bytesTotal();
+    response.content.storage_info_response.free_space = storageInfo.bytesAvailable();
+
+    sendMessage(response);
+}
+
+void EmulatorConnection::storageStat(const PB_Main &request)
+{
+    const QFileInfo fileInfo(localPath(request.content.storage_stat_request.path));
+
+    if(!fileInfo.exists()) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_NOT_EXIST);
+        return;
+    }
+
+    PB_Main response = PB_Main_init_zero;
+    response.command_id = request.command_id;
+    response.which_content = PB_Main_storage_stat_response_tag;
+
+    auto &content = response.content.storage_stat_response;
+    content.has_file = true;
+    content.file.type = fileInfo.isDir() ? PB_Storage_File_FileType_DIR : PB_Storage_File_FileType_FILE;
+    content.file.size = fileInfo.isDir() ? 0 : fileInfo.size();
+
+    sendMessage(response);
+}
+
+void EmulatorConnection::storageList(const PB_Main &request)
+{
+    const QDir dir(localPath(request.content.storage_list_request.path));
+
+    if(!dir.exists()) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_NOT_EXIST);
+        return;
+    }
+
+    const auto entries = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System, QDir::Name);
+
+    if(entries.isEmpty()) {
+        sendEmpty(request.command_id);
+        return;
+    }
+
+    for(auto i = 0; i < entries.size(); i += LIST_CHUNK_SIZE) {
+        const auto count = qMin(LIST_CHUNK_SIZE, entries.size() - i);
+        QByteArray names[LIST_CHUNK_SIZE];
+
+        PB_Main response = PB_Main_init_zero;
+        response.command_id = request.command_id;
+        response.has_next = i + count < entries.size();
+        response.which_content = PB_Main_storage_list_response_tag;
+
+        auto &content = response.content.storage_list_response;
+        content.file_count = count;
+
+        for(auto j = 0; j < count; ++j) {
+            const auto &entry = entries.at(i + j);
+            names[j] = entry.fileName().toUtf8();
+
+            content.file[j].type = entry.isDir() ? PB_Storage_File_FileType_DIR : PB_Storage_File_FileType_FILE;
+            content.file[j].name = names[j].data();
+            content.file[j].size = entry.isDir() ? 0 : entry.size();
+        }
+
+        sendMessage(response);
+    }
+}
+
+void EmulatorConnection::storageRead(const PB_Main &request)
+{
+    QFile file(localPath(request.content.storage_read_request.path));
+
+    if(!file.exists()) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_NOT_EXIST);
+        return;
+    } else if(!file.open(QIODevice::ReadOnly)) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_INTERNAL);
+        return;
+    }
+
+    do {
+        const auto buf = file.read(READ_CHUNK_SIZE);
+
+        PB_Main response = PB_Main_init_zero;
+        response.command_id = request.command_id;
+        response.has_next = !file.atEnd();
+        response.which_content = PB_Main_storage_read_response_tag;
+
+        auto &content = response.content.storage_read_response;
+        content.has_file = true;
+        content.file.data = buf.isEmpty() ? nullptr : makeBytesArray(buf);
+
+        sendMessage(response);
+
+        if(content.file.data) {
+            free(content.file.data);
+        }
+
+    } while(!file.atEnd());
+}
+
+void EmulatorConnection::storageWrite(const PB_Main &request)
+{
+    const auto &content = request.content.storage_write_request;
+
+    if(!m_writeFile.isOpen()) {
+        m_writeFile.setFileName(localPath(content.path));
+        m_writeId = request.command_id;
+
+        if(!QFileInfo(m_writeFile.fileName()).dir().exists()) {
+            sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_NOT_EXIST);
+            return;
+        } else if(!m_writeFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_INTERNAL);
+            return;
+        }
+    }
+
+    if(content.has_file && content.file.data) {
+        const auto *data = content.file.data;
+
+        if(m_writeFile.write((const char*)data->bytes, data->size) != data->size) {
+            m_writeFile.close();
+            sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_INTERNAL);
+            return;
+        }
+    }
+
+    // Only the last chunk gets a reply
+    if(!request.has_next) {
+        m_writeFile.close();
+        sendEmpty(request.command_id);
+    }
+}
+
+void EmulatorConnection::storageMkdir(const PB_Main &request)
+{
+    const QFileInfo fileInfo(localPath(request.content.storage_mkdir_request.path));
+
+    if(fileInfo.exists()) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_EXIST);
+    } else if(!fileInfo.dir().exists()) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_NOT_EXIST);
+    } else if(!fileInfo.dir().mkdir(fileInfo.fileName())) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_INTERNAL);
+    } else {
+        sendEmpty(request.command_id);
+    }
+}
+
+void EmulatorConnection::storageDelete(const PB_Main &request)
+{
+    const auto &content = request.content.storage_delete_request;
+    const QFileInfo fileInfo(localPath(content.path));
+
+    if(!fileInfo.exists()) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_NOT_EXIST);
+        return;
+    }
+
+    bool success;
+
+    if(fileInfo.isDir()) {
+        QDir dir(fileInfo.absoluteFilePath());
+
+        if(!content.recursive && !dir.isEmpty(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System)) {
+            sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_DIR_NOT_EMPTY);
+            return;
+        }
+
+        success = dir.removeRecursively();
+
+    } else {
+        success = QFile::remove(fileInfo.absoluteFilePath());
+    }
+
+    sendEmpty(request.command_id, success ? PB_CommandStatus_OK : PB_CommandStatus_ERROR_STORAGE_INTERNAL);
+}
+
+void EmulatorConnection::storageRename(const PB_Main &request)
+{
+    const auto &content = request.content.storage_rename_request;
+
+    const auto oldPath = localPath(content.old_path);
+    const auto newPath = localPath(content.new_path);
+
+    if(!QFileInfo::exists(oldPath)) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_NOT_EXIST);
+    } else if(QFileInfo::exists(newPath)) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_EXIST);
+    } else if(!QDir().rename(oldPath, newPath)) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_INTERNAL);
+    } else {
+        sendEmpty(request.command_id);
+    }
+}
+
+void EmulatorConnection::storageMd5Sum(const PB_Main &request)
+{
+    QFile file(localPath(request.content.storage_md5sum_request.path));
+
+    if(!file.exists()) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_NOT_EXIST);
+        return;
+    } else if(!file.open(QIODevice::ReadOnly)) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_STORAGE_INTERNAL);
+        return;
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(&file);
+
+    PB_Main response = PB_Main_init_zero;
+    response.command_id = request.command_id;
+    response.which_content = PB_Main_storage_md5sum_response_tag;
+
+    auto &content = response.content.storage_md5sum_response;
+    const auto hexDigest = hash.result().toHex();
+    qstrncpy(content.md5sum, hexDigest.constData(), sizeof(content.md5sum));
+
+    sendMessage(response);
+}
+
+void EmulatorConnection::propertyGet(const PB_Main &request)
+{
+    const QByteArray prefix(request.content.property_get_request.key);
+
+    if(prefix != QByteArrayLiteral("devinfo")) {
+        sendEmpty(request.command_id, PB_CommandStatus_ERROR_INVALID_PARAMETERS);
+        return;
+    }
+
+    const auto &properties = deviceInfoProperties();
+
+    for(auto it = properties.cbegin(); it != properties.cend(); ++it) {
+        auto key = it->first;
+        auto value = it->second;
+
+        PB_Main response = PB_Main_init_zero;
+        response.command_id = request.command_id;
+        response.has_next = std::next(it) != properties.cend();
+        response.which_content = PB_Main_property_get_response_tag;
+        response.content.property_get_response.key = key.data();
+        response.content.property_get_response.value = value.data();
+
+        sendMessage(response);
+    }
+}
+
+void EmulatorConnection::sendEmpty(uint32_t id, PB_CommandStatus status)
+{
+    PB_Main response = PB_Main_init_zero;
+    response.command_id = id;
+    response.command_status = status;
+    response.which_content = PB_Main_empty_tag;
+
+    sendMessage(response);
+}
+
+void EmulatorConnection::sendMessage(PB_Main &message)
+{
+    pb_ostream_t s = PB_OSTREAM_SIZING;
+
+    if(!pb_encode_ex(&s, &PB_Main_msg, &message, PB_ENCODE_DELIMITED)) {
+        return;
+    }
+
+    QByteArray buf((int)s.bytes_written, Qt::Uninitialized);
+    s = pb_ostream_from_buffer((pb_byte_t*)buf.data(), buf.size());
+
+    if(!pb_encode_ex(&s, &PB_Main_msg, &message, PB_ENCODE_DELIMITED)) {
+        return;
+    }
+
+    m_txQueue.enqueue({m_clock.elapsed() + m_emulator->latency(), buf});
+}
+
+void EmulatorConnection::abortStorageWrite()
+{
+    m_writeFile.close();
+    sendEmpty(m_writeId, PB_CommandStatus_ERROR_CONTINUOUS_COMMAND_INTERRUPTED);
+}
+
+const QString EmulatorConnection::localPath(const char *devicePath) const
+{
+    const auto path = QString::fromUtf8(devicePath ? devicePath : "");
+    return QDir::cleanPath(m_emulator->rootDir().absolutePath() + QLatin1Char('/') + path);
+}
+
+qint64 EmulatorConnection::takeBudget(qint64 &tokens, qint64 wanted)
+{
+    if(m_emulator->bandwidth() == 0) {
+        return wanted;
+    }
+
+    const auto ret = qMin(tokens, wanted);
+    tokens -= ret;
+
+    return ret;
+}
+
+void EmulatorConnection::refillTokens()
+{
+    const auto now = m_clock.elapsed();
+    const auto elapsed = now - m_lastRefill;
+    const auto bandwidth = m_emulator->bandwidth();
+
+    if(bandwidth == 0 || elapsed <= 0) {
+        return;
+    }
+
+    const auto amount = bandwidth * elapsed / 1000;
+
+    if(amount == 0) {
+        // Keep accumulating time until there is at least one byte to give
+        return;
+    }
+
+    m_rxTokens = qMin(bucketSize(), m_rxTokens + amount);
+    m_txTokens = qMin(bucketSize(), m_txTokens + amount);
+
+    m_lastRefill = now;
+}
+
+qint64 EmulatorConnection::bucketSize() const
+{
+    return qMax(m_emulator->bandwidth() / 10, MIN_BUCKET_SIZE);
+}
+
+bool EmulatorConnection::hasCompleteFrame() const
+{
+    const auto frameSize = nextFrameSize(m_rxBuffer.constData(), m_rxBuffer.size());
+    return frameSize >= 0 && frameSize <= m_rxBuffer.size();
+}
+
+void EmulatorConnection::scheduleLink()
+{
+    if(m_linkTimer->isActive()) {
+        return;
+    } else if(!m_txQueue.isEmpty() || hasCompleteFrame()) {
+        m_linkTimer->start();
+    }
+}
+
+qint64 EmulatorConnection::nextFrameSize(const char *data, qint64 size)
+{
+    // Varint length prefix followed by the message itself
+    quint64 length = 0;
+
+    for(auto i = 0; i < qMin<qint64>(size, 10); ++i) {
+        const auto byte = (quint8)data[i];
+        length |= (quint64)(byte & 0x7f) << (7 * i);
+
+        if(!(byte & 0x80)) {
+            return (qint64)length + i + 1;
+        }
+    }
+
+    return -1;
+}
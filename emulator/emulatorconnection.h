@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QFile>
+#include <QQueue>
+#include <QObject>
+#include <QElapsedTimer>
+
+#include "messages/flipper.pb.h"
+
+class QTimer;
+class QLocalSocket;
+
+namespace Flipper {
+namespace Zero {
+
+class Emulator;
+
+// Serves a single RPC session on behalf of the Emulator
+class EmulatorConnection : public QObject
+{
+    Q_OBJECT
+
+    struct Packet {
+        qint64 dueTime;
+        QByteArray data;
+    };
+
+public:
+    EmulatorConnection(QLocalSocket *socket, Emulator *emulator);
+    ~EmulatorConnection();
+
+signals:
+    void finished();
+
+private slots:
+    void onSocketReadyRead();
+    void onSocketDisconnected();
+    void processLink();
+
+private:
+    void processRequest(const PB_Main &request);
+
+    void systemPing(const PB_Main &request);
+    void systemDeviceInfo(const PB_Main &request);
+    void systemProtobufVersion(const PB_Main &request);
+    void systemGetDateTime(const PB_Main &request);
+    void systemReboot(const PB_Main &request);
+
+    void storageInfo(const PB_Main &request);
+    void storageStat(const PB_Main &request);
+    void storageList(const PB_Main &request);
+    void storageRead(const PB_Main &request);
+    void storageWrite(const PB_Main &request);
+    void storageMkdir(const PB_Main &request);
+    void storageDelete(const PB_Main &request);
+    void storageRename(const PB_Main &request);
+    void storageMd5Sum(const PB_Main &request);
+
+    void propertyGet(const PB_Main &request);
+
+    void sendEmpty(uint32_t id, PB_CommandStatus status = PB_CommandStatus_OK);
+    void sendMessage(PB_Main &message);
+    void abortStorageWrite();
+
+    const QString localPath(const char *devicePath) const;
+    qint64 takeBudget(qint64 &tokens, qint64 wanted);
+    void refillTokens();
+    qint64 bucketSize() const;
+    bool hasCompleteFrame() const;
+    void scheduleLink();
+
+    static qint64 nextFrameSize(const char *data, qint64 size);
+
+    QLocalSocket *m_socket;
+    Emulator *m_emulator;
+    QTimer *m_linkTimer;
+    QElapsedTimer m_clock;
+
+    QByteArray m_rxBuffer;
+    QQueue<Packet> m_txQueue;
+
+    qint64 m_rxTokens;
+    qint64 m_txTokens;
+    qint64 m_lastRefill;
+
+    QFile m_writeFile;
+    uint32_t m_writeId;
+};
+
+}
+}
+
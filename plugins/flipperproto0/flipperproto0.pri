@@ -0,0 +1,54 @@
+# Shared with the benchmarks, which build the plugin internals in
+
+DEFINES += PB_ENABLE_MALLOC
+
+HEADERS += \
+    $$PWD/guirequest.h \
+    $$PWD/guiresponse.h \
+    $$PWD/mainrequest.h \
+    $$PWD/mainresponse.h \
+    $$PWD/messages/application.pb.h \
+    $$PWD/messages/flipper.pb.h \
+    $$PWD/messages/gui.pb.h \
+    $$PWD/messages/property.pb.h \
+    $$PWD/messages/status.pb.h \
+    $$PWD/messages/storage.pb.h \
+    $$PWD/messages/system.pb.h \
+    $$PWD/messagewrapper.h \
+    $$PWD/propertyrequest.h \
+    $$PWD/propertyresponse.h \
+    $$PWD/protobufplugin.h \
+    $$PWD/regiondata.h \
+    $$PWD/responsepool.h \
+    $$PWD/statusrequest.h \
+    $$PWD/statusresponse.h \
+    $$PWD/storagerequest.h \
+    $$PWD/storageresponse.h \
+    $$PWD/systemrequest.h \
+    $$PWD/systemresponse.h
+
+SOURCES += \
+    $$PWD/guirequest.cpp \
+    $$PWD/guiresponse.cpp \
+    $$PWD/mainrequest.cpp \
+    $$PWD/mainresponse.cpp \
+    $$PWD/messages/application.pb.c \
+    $$PWD/messages/flipper.pb.c \
+    $$PWD/messages/gpio.pb.c \
+    $$PWD/messages/gui.pb.c \
+    $$PWD/messages/property.pb.c \
+    $$PWD/messages/status.pb.c \
+    $$PWD/messages/storage.pb.c \
+    $$PWD/messages/system.pb.c \
+    $$PWD/messagewrapper.cpp \
+    $$PWD/propertyrequest.cpp \
+    $$PWD/propertyresponse.cpp \
+    $$PWD/protobufplugin.cpp \
+    $$PWD/regiondata.cpp \
+    $$PWD/responsepool.cpp \
+    $$PWD/statusrequest.cpp \
+    $$PWD/statusresponse.cpp \
+    $$PWD/storagerequest.cpp \
+    $$PWD/storageresponse.cpp \
+    $$PWD/systemrequest.cpp \
+    $$PWD/systemresponse.cpp
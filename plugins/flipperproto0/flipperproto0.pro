@@ -15,61 +15,12 @@ VERSION = 0.0.0
 INCLUDEPATH += $$PWD/../protobufinterface \
     $$PWD/../../3rdparty/nanopb
 
-HEADERS += \
-    guirequest.h \
-    guiresponse.h \
-    mainrequest.h \
-    mainresponse.h \
-    messages/application.pb.h \
-    messages/flipper.pb.h \
-    messages/gui.pb.h \
-    messages/property.pb.h \
-    messages/status.pb.h \
-    messages/storage.pb.h \
-    messages/system.pb.h \
-    messagewrapper.h \
-    propertyrequest.h \
-    propertyresponse.h \
-    protobufplugin.h \
-    regiondata.h \
-    statusrequest.h \
-    statusresponse.h \
-    storagerequest.h \
-    storageresponse.h \
-    systemrequest.h \
-    systemresponse.h
-
-SOURCES += \
-    guirequest.cpp \
-    guiresponse.cpp \
-    mainrequest.cpp \
-    mainresponse.cpp \
-    messages/application.pb.c \
-    messages/flipper.pb.c \
-    messages/gpio.pb.c \
-    messages/gui.pb.c \
-    messages/property.pb.c \
-    messages/status.pb.c \
-    messages/storage.pb.c \
-    messages/system.pb.c \
-    messagewrapper.cpp \
-    propertyrequest.cpp \
-    propertyresponse.cpp \
-    protobufplugin.cpp \
-    regiondata.cpp \
-    statusrequest.cpp \
-    statusresponse.cpp \
-    storagerequest.cpp \
-    storageresponse.cpp \
-    systemrequest.cpp \
-    systemresponse.cpp
+include(flipperproto0.pri)
 
 unix|win32 {
     LIBS += -L$$OUT_PWD/../../3rdparty/ -l3rdparty
 }
 
-DEFINES += PB_ENABLE_MALLOC
-
 !contains(CONFIG, static) {
     unix:!macx {
         target.path = $$PREFIX/lib/$$NAME/plugins
@@ -9,17 +9,36 @@ MainRequest::MainRequest(uint32_t id, pb_size_t tag, bool hasNext):
 const QByteArray MainRequest::encode() const
 {
     QByteArray ret;
+    encode(ret);
+    return ret;
+}
+
+bool MainRequest::encode(QByteArray &buffer) const
+{
     pb_ostream_t s = PB_OSTREAM_SIZING;
 
     if(!pb_encode_ex(&s, &PB_Main_msg, &m_message, PB_ENCODE_DELIMITED)) {
-        return ret;
+        buffer.clear();
+        return false;
     }
 
-    ret.resize((int)s.bytes_written);
-    s = pb_ostream_from_buffer((pb_byte_t*)ret.data(), ret.size());
+    buffer.resize((int)s.bytes_written);
+    s = pb_ostream_from_buffer((pb_byte_t*)buffer.data(), buffer.size());
 
     if(!pb_encode_ex(&s, &PB_Main_msg, &m_message, PB_ENCODE_DELIMITED)) {
-       ret.clear();
+       buffer.clear();
+       return false;
+    }
+
+    return true;
+}
+
+size_t MainRequest::varintSize(uint64_t value)
+{
+    size_t ret = 1;
+
+    while(value >>= 7) {
+        ++ret;
     }
 
     return ret;
@@ -11,8 +11,12 @@ public:
     virtual ~MainRequest() {}
 
     const QByteArray encode() const;
+    // Encode into an existing buffer, reusing its memory if possible
+    virtual bool encode(QByteArray &buffer) const;
 
 protected:
+    static size_t varintSize(uint64_t value);
+
     PB_Main m_message;
 };
 
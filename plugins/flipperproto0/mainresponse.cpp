@@ -103,11 +103,26 @@ QObject *MainResponse::create(MessageWrapper &wrapper, QObject *parent)
     }
 }
 
+void MainResponse::setWrapper(MessageWrapper &wrapper)
+{
+    m_wrapper = std::move(wrapper);
+}
+
+void MainResponse::clear()
+{
+    m_wrapper.clear();
+}
+
 const PB_Main &MainResponse::message() const
 {
     return m_wrapper.message();
 }
 
+const MessageWrapper &MainResponse::wrapper() const
+{
+    return m_wrapper;
+}
+
 MainResponseInterface::ResponseType MainResponse::tagToResponseType(pb_size_t tag)
 {
     switch(tag) {
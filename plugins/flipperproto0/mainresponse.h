@@ -24,12 +24,17 @@ public:
     const QString errorString() const override;
 
     static QObject *create(MessageWrapper &wrapper, QObject *parent = nullptr);
+    static ResponseType tagToResponseType(pb_size_t tag);
+
+    // Used by ResponsePool to recycle the object
+    void setWrapper(MessageWrapper &wrapper);
+    void clear();
 
 protected:
     const PB_Main &message() const;
+    const MessageWrapper &wrapper() const;
 
 private:
-    static ResponseType tagToResponseType(pb_size_t tag);
     MessageWrapper m_wrapper;
 };
 
@@ -1,21 +1,42 @@
 #include "messagewrapper.h"
 
+#include <QIODevice>
+
 #include "pb_decode.h"
 
 #include "mainresponse.h"
 
 MessageWrapper::MessageWrapper(const QByteArray &buffer):
-    m_message(PB_Main_init_zero)
+    m_message(PB_Main_init_zero),
+    m_isStreamed(false),
+    m_streamedSize(0)
 {
-    pb_istream_t s = pb_istream_from_buffer((const pb_byte_t*)buffer.data(), buffer.size());
-    m_isComplete = pb_decode_ex(&s, &PB_Main_msg, &m_message, PB_DECODE_DELIMITED);
-    m_encodedSize = buffer.size() - s.bytes_left;
+    decode(buffer);
+}
+
+MessageWrapper::MessageWrapper(const QByteArray &buffer, const DataSinkMap &sinks):
+    m_message(PB_Main_init_zero),
+    m_isStreamed(false),
+    m_streamedSize(0)
+{
+    StreamContext ctx = {&sinks, &m_message, 0, false};
+
+    m_message.cb_content.funcs.decode = &MessageWrapper::decodeContent;
+    m_message.cb_content.arg = &ctx;
+
+    decode(buffer);
+
+    m_message.cb_content = {};
+    m_isStreamed = ctx.isStreamed;
+    m_streamedSize = ctx.streamedSize;
 }
 
 MessageWrapper::MessageWrapper(MessageWrapper &&other):
     m_message(other.m_message),
     m_encodedSize(other.m_encodedSize),
-    m_isComplete(other.m_isComplete)
+    m_isComplete(other.m_isComplete),
+    m_isStreamed(other.m_isStreamed),
+    m_streamedSize(other.m_streamedSize)
 {
     // Prevent potential double-free
     other.m_isComplete = false;
@@ -28,6 +49,36 @@ MessageWrapper::~MessageWrapper()
     }
 }
 
+MessageWrapper &MessageWrapper::operator=(MessageWrapper &&other)
+{
+    if(this != &other) {
+        clear();
+
+        m_message = other.m_message;
+        m_encodedSize = other.m_encodedSize;
+        m_isComplete = other.m_isComplete;
+        m_isStreamed = other.m_isStreamed;
+        m_streamedSize = other.m_streamedSize;
+
+        other.m_isComplete = false;
+    }
+
+    return *this;
+}
+
+void MessageWrapper::clear()
+{
+    if(m_isComplete) {
+        pb_release(&PB_Main_msg, &m_message);
+    }
+
+    m_message = PB_Main_init_zero;
+    m_encodedSize = 0;
+    m_isComplete = false;
+    m_isStreamed = false;
+    m_streamedSize = 0;
+}
+
 const PB_Main &MessageWrapper::message() const
 {
     return m_message;
@@ -42,3 +93,120 @@ bool MessageWrapper::isComplete() const
 {
     return m_isComplete;
 }
+
+bool MessageWrapper::isStreamed() const
+{
+    return m_isStreamed;
+}
+
+qint64 MessageWrapper::streamedSize() const
+{
+    return m_streamedSize;
+}
+
+void MessageWrapper::decode(const QByteArray &buffer)
+{
+    pb_istream_t s = pb_istream_from_buffer((const pb_byte_t*)buffer.data(), buffer.size());
+    m_isComplete = pb_decode_ex(&s, &PB_Main_msg, &m_message, PB_DECODE_DELIMITED);
+    m_encodedSize = buffer.size() - s.bytes_left;
+}
+
+bool MessageWrapper::decodeContent(pb_istream_t *stream, const pb_field_iter_t *field, void **arg)
+{
+    // Called by nanopb before decoding the contents of PB_Main. The message header
+    // has already been decoded at this point, as it always comes first on the wire.
+    auto *ctx = (StreamContext*)*arg;
+    const auto &message = *ctx->message;
+
+    if(field->tag != PB_Main_storage_read_response_tag || message.command_status != PB_CommandStatus_OK) {
+        return true;
+    }
+
+    auto *sink = ctx->sinks->value(message.command_id);
+
+    if(!sink) {
+        return true;
+    }
+
+    // Consuming the whole substream tells nanopb to skip its own decoding
+    ctx->isStreamed = true;
+    return decodeStorageReadResponse(stream, (PB_Storage_ReadResponse*)field->pData, sink, ctx->streamedSize);
+}
+
+bool MessageWrapper::decodeStorageReadResponse(pb_istream_t *stream, PB_Storage_ReadResponse *response, QIODevice *sink, qint64 &bytesWritten)
+{
+    while(stream->bytes_left) {
+        pb_wire_type_t wireType;
+        uint32_t tag;
+        bool eof;
+
+        if(!pb_decode_tag(stream, &wireType, &tag, &eof)) {
+            return eof;
+        } else if(tag != PB_Storage_ReadResponse_file_tag || wireType != PB_WT_STRING) {
+            if(!pb_skip_field(stream, wireType)) {
+                return false;
+            }
+
+            continue;
+        }
+
+        pb_istream_t fileStream;
+
+        if(!pb_make_string_substream(stream, &fileStream)) {
+            return false;
+        }
+
+        response->has_file = true;
+
+        while(fileStream.bytes_left) {
+            if(!pb_decode_tag(&fileStream, &wireType, &tag, &eof)) {
+                return false;
+
+            } else if(tag == PB_Storage_File_type_tag && wireType == PB_WT_VARINT) {
+                uint32_t type;
+
+                if(!pb_decode_varint32(&fileStream, &type)) {
+                    return false;
+                }
+
+                response->file.type = (PB_Storage_File_FileType)type;
+
+            } else if(tag == PB_Storage_File_size_tag && wireType == PB_WT_VARINT) {
+                if(!pb_decode_varint32(&fileStream, &response->file.size)) {
+                    return false;
+                }
+
+            } else if(tag == PB_Storage_File_data_tag && wireType == PB_WT_STRING) {
+                pb_istream_t dataStream;
+
+                if(!pb_make_string_substream(&fileStream, &dataStream)) {
+                    return false;
+                }
+
+                // The stream reads from the receive buffer, so its state points right at the data
+                const auto size = (qint64)dataStream.bytes_left;
+                const auto *data = (const char*)dataStream.state;
+
+                if(sink->write(data, size) != size) {
+                    bytesWritten = -1;
+                } else if(bytesWritten >= 0) {
+                    bytesWritten += size;
+                }
+
+                if(!pb_read(&dataStream, nullptr, dataStream.bytes_left) ||
+                   !pb_close_string_substream(&fileStream, &dataStream)) {
+                    return false;
+                }
+
+            } else if(!pb_skip_field(&fileStream, wireType)) {
+                return false;
+            }
+        }
+
+        if(!pb_close_string_substream(stream, &fileStream)) {
+            return false;
+        }
+    }
+
+    return true;
+}
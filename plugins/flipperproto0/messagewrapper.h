@@ -1,22 +1,49 @@
 #pragma once
 
+#include <QHash>
 #include <QByteArray>
 
+class QIODevice;
+
 #include "messages/flipper.pb.h"
 
 class MessageWrapper
 {
 public:
+    using DataSinkMap = QHash<uint32_t, QIODevice*>;
+
     MessageWrapper(const QByteArray &buffer);
+    // Storage read payloads of the messages with matching ids are written to the sink as they are decoded
+    MessageWrapper(const QByteArray &buffer, const DataSinkMap &sinks);
     MessageWrapper(MessageWrapper &&other);
     ~MessageWrapper();
 
+    MessageWrapper &operator=(MessageWrapper &&other);
+    void clear();
+
     const PB_Main &message() const;
     size_t encodedSize() const;
     bool isComplete() const;
 
+    bool isStreamed() const;
+    qint64 streamedSize() const;
+
 private:
+    struct StreamContext {
+        const DataSinkMap *sinks;
+        PB_Main *message;
+        qint64 streamedSize;
+        bool isStreamed;
+    };
+
+    static bool decodeContent(pb_istream_t *stream, const pb_field_iter_t *field, void **arg);
+    static bool decodeStorageReadResponse(pb_istream_t *stream, PB_Storage_ReadResponse *response, QIODevice *sink, qint64 &bytesWritten);
+
+    void decode(const QByteArray &buffer);
+
     PB_Main m_message;
     size_t m_encodedSize;
     bool m_isComplete;
+    bool m_isStreamed;
+    qint64 m_streamedSize;
 };
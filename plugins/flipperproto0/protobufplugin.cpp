@@ -3,6 +3,7 @@
 #include <QIODevice>
 
 #include "mainresponse.h"
+#include "responsepool.h"
 
 #include "guirequest.h"
 #include "statusrequest.h"
@@ -14,9 +15,15 @@
 
 ProtobufPlugin::ProtobufPlugin(QObject *parent):
     QObject(parent),
-    m_versionMinor(0)
+    m_versionMinor(0),
+    m_responsePool(new ResponsePool)
 {}
 
+ProtobufPlugin::~ProtobufPlugin()
+{
+    delete m_responsePool;
+}
+
 uint32_t ProtobufPlugin::versionMajor() const
 {
     return 0;
@@ -149,6 +156,11 @@ const QByteArray ProtobufPlugin::storageWrite(uint32_t id, const QByteArray &pat
     return StorageWriteRequest(id, path, data, hasNext).encode();
 }
 
+bool ProtobufPlugin::storageWrite(QByteArray &buffer, uint32_t id, const QByteArray &path, QIODevice *source, qint64 size, bool hasNext) const
+{
+    return StorageWriteRequest(id, path, source, size, hasNext).encode(buffer);
+}
+
 const QByteArray ProtobufPlugin::storageMd5Sum(uint32_t id, const QByteArray &path) const
 {
     return StorageMd5SumRequest(id, path).encode();
@@ -167,5 +179,27 @@ const QByteArray ProtobufPlugin::regionBands(const QByteArray &countryCode, cons
 QObject *ProtobufPlugin::decode(const QByteArray &buffer, QObject *parent) const
 {
     MessageWrapper wrp(buffer);
-    return MainResponse::create(wrp, parent);
+
+    if(parent) {
+        // Owned by the caller, not a candidate for reuse
+        return MainResponse::create(wrp, parent);
+    }
+
+    return m_responsePool->take(wrp);
+}
+
+QObject *ProtobufPlugin::decode(const QByteArray &buffer, const DataSinkMap &sinks, QObject *parent) const
+{
+    MessageWrapper wrp(buffer, sinks);
+
+    if(parent) {
+        return MainResponse::create(wrp, parent);
+    }
+
+    return m_responsePool->take(wrp);
+}
+
+void ProtobufPlugin::release(QObject *response) const
+{
+    m_responsePool->give(response);
 }
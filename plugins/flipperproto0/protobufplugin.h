@@ -5,6 +5,8 @@
 
 #include "protobufplugininterface.h"
 
+class ResponsePool;
+
 class ProtobufPlugin : public QObject, public ProtobufPluginInterface
 {
     Q_OBJECT
@@ -13,6 +15,7 @@ class ProtobufPlugin : public QObject, public ProtobufPluginInterface
 
 public:
     ProtobufPlugin(QObject *parent = nullptr);
+    ~ProtobufPlugin();
 
     uint32_t versionMajor() const override;
     void setMinorVersion(uint32_t version) override;
@@ -42,6 +45,7 @@ public:
     const QByteArray storageRemove(uint32_t id, const QByteArray &path, bool recursive) const override;
     const QByteArray storageRead(uint32_t id, const QByteArray &path) const override;
     const QByteArray storageWrite(uint32_t id, const QByteArray &path, const QByteArray &data, bool hasNext) const override;
+    bool storageWrite(QByteArray &buffer, uint32_t id, const QByteArray &path, QIODevice *source, qint64 size, bool hasNext) const override;
     const QByteArray storageMd5Sum(uint32_t id, const QByteArray &path) const override;
 
     const QByteArray propertyGet(uint32_t id, const QByteArray &key) const override;
@@ -49,7 +53,10 @@ public:
     const QByteArray regionBands(const QByteArray &countryCode, const BandInfoList &bands) const override;
 
     QObject *decode(const QByteArray &buffer, QObject *parent = nullptr) const override;
+    QObject *decode(const QByteArray &buffer, const DataSinkMap &sinks, QObject *parent = nullptr) const override;
+    void release(QObject *response) const override;
 
 private:
     uint32_t m_versionMinor;
+    ResponsePool *m_responsePool;
 };
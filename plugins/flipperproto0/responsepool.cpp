@@ -0,0 +1,63 @@
+#include "responsepool.h"
+
+#include <QMutexLocker>
+
+#include "mainresponse.h"
+#include "messagewrapper.h"
+
+// Enough to cover a burst of messages in flight
+static constexpr int MAX_FREE_RESPONSES = 16;
+
+ResponsePool::ResponsePool()
+{}
+
+ResponsePool::~ResponsePool()
+{
+    for(auto &responses : m_free) {
+        qDeleteAll(responses);
+    }
+}
+
+QObject *ResponsePool::take(MessageWrapper &wrapper)
+{
+    if(!wrapper.isComplete()) {
+        return nullptr;
+    }
+
+    const auto type = MainResponse::tagToResponseType(wrapper.message().which_content);
+
+    if(type != MainResponseInterface::Unknown) {
+        QMutexLocker locker(&m_mutex);
+        auto &responses = m_free[type];
+
+        if(!responses.isEmpty()) {
+            auto *response = responses.takeLast();
+            locker.unlock();
+
+            response->setWrapper(wrapper);
+            return response;
+        }
+    }
+
+    return MainResponse::create(wrapper);
+}
+
+void ResponsePool::give(QObject *response)
+{
+    // Every response originates from MainResponse::create()
+    auto *mainResponse = static_cast<MainResponse*>(response);
+    const auto type = mainResponse->type();
+
+    // Free the decoded message right away, it might be large
+    mainResponse->clear();
+
+    QMutexLocker locker(&m_mutex);
+    auto &responses = m_free[type];
+
+    if(responses.size() < MAX_FREE_RESPONSES) {
+        responses.append(mainResponse);
+    } else {
+        locker.unlock();
+        delete mainResponse;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QMutex>
+#include <QVector>
+
+#include "mainresponseinterface.h"
+
+class QObject;
+class MainResponse;
+class MessageWrapper;
+
+// Keeps the response objects around after use, so that a steady stream
+// of messages does not cost a QObject construction per frame.
+// Responses are taken in the transport thread and given back in the session thread.
+class ResponsePool
+{
+public:
+    ResponsePool();
+    ~ResponsePool();
+
+    QObject *take(MessageWrapper &wrapper);
+    void give(QObject *response);
+
+private:
+    QMutex m_mutex;
+    QVector<MainResponse*> m_free[MainResponseInterface::ResponseTypeCount];
+};
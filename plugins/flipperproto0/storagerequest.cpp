@@ -1,5 +1,7 @@
 #include "storagerequest.h"
 
+#include <QIODevice>
+
 #include "pb_encode.h"
 
 AbstractStorageRequest::AbstractStorageRequest(uint32_t id, pb_size_t tag, const QByteArray &path, bool hasNext):
@@ -50,27 +52,80 @@ StorageReadRequest::StorageReadRequest(uint32_t id, const QByteArray &path):
 }
 
 StorageWriteRequest::StorageWriteRequest(uint32_t id, const QByteArray &path, const QByteArray &data, bool hasNext):
-    AbstractStorageRequest(id, PB_Main_storage_write_request_tag, path, hasNext)
+    AbstractStorageRequest(id, PB_Main_storage_write_request_tag, path, hasNext),
+    m_data(data),
+    m_source(nullptr),
+    m_size(data.size())
+{
+    m_message.content.storage_write_request.path = pathData();
+}
+
+StorageWriteRequest::StorageWriteRequest(uint32_t id, const QByteArray &path, QIODevice *source, qint64 size, bool hasNext):
+    AbstractStorageRequest(id, PB_Main_storage_write_request_tag, path, hasNext),
+    m_source(source),
+    m_size(size)
 {
-    auto &content = m_message.content.storage_write_request;
+    m_message.content.storage_write_request.path = pathData();
+}
+
+bool StorageWriteRequest::encode(QByteArray &buffer) const
+{
+    // Everything except the file data is encoded by nanopb, the wrapping of the data
+    // is done by hand. The output is identical to encoding the whole message with nanopb.
+    const auto &request = m_message.content.storage_write_request;
+
+    auto header = m_message;
+    header.which_content = 0;
+
+    size_t headerSize, requestSize;
+
+    if(!pb_get_encoded_size(&headerSize, &PB_Main_msg, &header) ||
+       !pb_get_encoded_size(&requestSize, &PB_Storage_WriteRequest_msg, &request)) {
+        buffer.clear();
+        return false;
+    }
 
-    content.has_file = !data.isEmpty();
-    content.path = pathData();
+    // PB_Storage_File with only the data field set
+    const size_t fileSize = m_size ? 1 + varintSize(m_size) + m_size : 0;
 
-    if(content.has_file) {
-        content.file.data = (pb_bytes_array_t*)malloc(PB_BYTES_ARRAY_T_ALLOCSIZE(data.size()));
-        content.file.data->size = data.size();
-        memcpy(content.file.data->bytes, data.data(), data.size());
+    if(m_size) {
+        requestSize += 1 + varintSize(fileSize) + fileSize;
     }
+
+    const auto messageSize = headerSize + 1 + varintSize(requestSize) + requestSize;
+    buffer.resize((int)(varintSize(messageSize) + messageSize));
+
+    auto s = pb_ostream_from_buffer((pb_byte_t*)buffer.data(), buffer.size());
+
+    auto success = pb_encode_varint(&s, messageSize) &&
+                   pb_encode(&s, &PB_Main_msg, &header) &&
+                   pb_encode_tag(&s, PB_WT_STRING, PB_Main_storage_write_request_tag) &&
+                   pb_encode_varint(&s, requestSize) &&
+                   pb_encode(&s, &PB_Storage_WriteRequest_msg, &request);
+
+    if(success && m_size) {
+        success = pb_encode_tag(&s, PB_WT_STRING, PB_Storage_WriteRequest_file_tag) &&
+                  pb_encode_varint(&s, fileSize) &&
+                  pb_encode_tag(&s, PB_WT_STRING, PB_Storage_File_data_tag) &&
+                  pb_encode_varint(&s, m_size) &&
+                  readData(buffer.data() + s.bytes_written);
+    }
+
+    if(!success) {
+        buffer.clear();
+    }
+
+    return success;
 }
 
-StorageWriteRequest::~StorageWriteRequest()
+bool StorageWriteRequest::readData(char *dest) const
 {
-    auto &content = m_message.content.storage_write_request;
-
-    if(content.has_file) {
-        free(content.file.data);
+    if(!m_source) {
+        memcpy(dest, m_data.constData(), m_size);
+        return true;
     }
+
+    return m_source->read(dest, m_size) == m_size;
 }
 
 StorageRenameRequest::StorageRenameRequest(uint32_t id, const QByteArray &oldPath, const QByteArray &newPath):
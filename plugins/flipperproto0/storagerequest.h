@@ -2,6 +2,8 @@
 
 #include "mainrequest.h"
 
+class QIODevice;
+
 class AbstractStorageRequest : public MainRequest
 {
 protected:
@@ -56,11 +58,23 @@ public:
     StorageReadRequest(uint32_t id, const QByteArray &path);
 };
 
+// The file data is not a part of m_message, it is copied straight
+// from its source to the output buffer during encoding
 class StorageWriteRequest : public AbstractStorageRequest
 {
 public:
     StorageWriteRequest(uint32_t id, const QByteArray &path, const QByteArray &data, bool hasNext);
-    ~StorageWriteRequest();
+    StorageWriteRequest(uint32_t id, const QByteArray &path, QIODevice *source, qint64 size, bool hasNext);
+
+    using MainRequest::encode;
+    bool encode(QByteArray &buffer) const override;
+
+private:
+    bool readData(char *dest) const;
+
+    QByteArray m_data;
+    QIODevice *m_source;
+    qint64 m_size;
 };
 
 class StorageMd5SumRequest : public AbstractStorageRequest
@@ -60,7 +60,18 @@ bool StorageReadResponse::hasFile() const
 const StorageFile StorageReadResponse::file() const
 {
     const auto &f = message().content.storage_read_response.file;
-    return {(StorageFile::FileType)f.type, {f.name}, {(const char*)f.data->bytes, f.data->size}, f.size};
+    const auto data = f.data ? QByteArray((const char*)f.data->bytes, f.data->size) : QByteArray();
+    return {(StorageFile::FileType)f.type, {f.name}, data, f.size};
+}
+
+bool StorageReadResponse::isStreamed() const
+{
+    return wrapper().isStreamed();
+}
+
+qint64 StorageReadResponse::streamedSize() const
+{
+    return wrapper().streamedSize();
 }
 
 StorageMd5SumResponse::StorageMd5SumResponse(MessageWrapper &wrapper, QObject *parent):
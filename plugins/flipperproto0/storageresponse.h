@@ -44,6 +44,8 @@ public:
     StorageReadResponse(MessageWrapper &wrapper, QObject *parent = nullptr);
     bool hasFile() const override;
     const StorageFile file() const override;
+    bool isStreamed() const override;
+    qint64 streamedSize() const override;
 };
 
 class StorageMd5SumResponse : public MainResponse, public StorageMd5SumResponseInterface
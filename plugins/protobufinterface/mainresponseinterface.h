@@ -25,6 +25,8 @@ public:
         GuiScreenFrame,
 
         PropertyGet,
+
+        ResponseTypeCount
     };
 
     virtual ~MainResponseInterface() {}
@@ -42,5 +44,5 @@ public:
 using EmptyResponseInterface = MainResponseInterface;
 
 QT_BEGIN_NAMESPACE
-Q_DECLARE_INTERFACE(MainResponseInterface, "com.flipperdevices.MainResponseInterface/1.0")
+Q_DECLARE_INTERFACE(MainResponseInterface, "com.flipperdevices.MainResponseInterface/1.1")
 QT_END_NAMESPACE
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <QHash>
 #include <QtPlugin>
 #include <QByteArray>
 
 #include "bandinfo.h"
 
+class QIODevice;
+
 class ProtobufPluginInterface
 {
 public:
@@ -14,6 +17,8 @@ public:
         RebootModeUpdate = 2,
     };
 
+    using DataSinkMap = QHash<uint32_t, QIODevice*>;
+
     virtual ~ProtobufPluginInterface() {}
 
     virtual uint32_t versionMajor() const = 0;
@@ -43,6 +48,8 @@ public:
     virtual const QByteArray storageRemove(uint32_t id, const QByteArray &path, bool recursive = false) const = 0;
     virtual const QByteArray storageRead(uint32_t id, const QByteArray &path) const = 0;
     virtual const QByteArray storageWrite(uint32_t id, const QByteArray &path, const QByteArray &data, bool hasNext) const = 0;
+    // Reads size bytes from source directly into buffer, the buffer memory is reused if large enough
+    virtual bool storageWrite(QByteArray &buffer, uint32_t id, const QByteArray &path, QIODevice *source, qint64 size, bool hasNext) const = 0;
     virtual const QByteArray storageMd5Sum(uint32_t id, const QByteArray &path) const = 0;
 
     virtual const QByteArray propertyGet(uint32_t id, const QByteArray &key) const = 0;
@@ -50,8 +57,12 @@ public:
     virtual const QByteArray regionBands(const QByteArray &countryCode, const BandInfoList &bands) const = 0;
 
     virtual QObject *decode(const QByteArray &buffer, QObject *parent = nullptr) const = 0;
+    // Storage read payloads of the responses with ids present in sinks are written directly to the respective device
+    virtual QObject *decode(const QByteArray &buffer, const DataSinkMap &sinks, QObject *parent = nullptr) const = 0;
+    // Hand a response returned by decode() back for reuse instead of deleting it. Safe to call from any thread.
+    virtual void release(QObject *response) const = 0;
 };
 
 QT_BEGIN_NAMESPACE
-Q_DECLARE_INTERFACE(ProtobufPluginInterface, "com.flipperdevices.ProtobufPluginInterface/1.0")
+Q_DECLARE_INTERFACE(ProtobufPluginInterface, "com.flipperdevices.ProtobufPluginInterface/1.3")
 QT_END_NAMESPACE
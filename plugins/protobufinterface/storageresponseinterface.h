@@ -43,6 +43,11 @@ class StorageReadResponseInterface
 public:
     virtual bool hasFile() const = 0;
     virtual const StorageFile file() const = 0;
+
+    // The data has been written straight to the sink passed to decode(), file().data is empty
+    virtual bool isStreamed() const = 0;
+    // Number of bytes written to the sink, -1 if writing failed
+    virtual qint64 streamedSize() const = 0;
 };
 
 class StorageMd5SumResponseInterface
@@ -55,6 +60,6 @@ QT_BEGIN_NAMESPACE
 Q_DECLARE_INTERFACE(StorageInfoResponseInterface, "com.flipperdevices.StorageInfoResponseInterface/1.0")
 Q_DECLARE_INTERFACE(StorageStatResponseInterface, "com.flipperdevices.StorageStatResponseInterface/1.0")
 Q_DECLARE_INTERFACE(StorageListResponseInterface, "com.flipperdevices.StorageListResponseInterface/1.0")
-Q_DECLARE_INTERFACE(StorageReadResponseInterface, "com.flipperdevices.StorageReadResponseInterface/1.0")
+Q_DECLARE_INTERFACE(StorageReadResponseInterface, "com.flipperdevices.StorageReadResponseInterface/1.1")
 Q_DECLARE_INTERFACE(StorageMd5SumResponseInterface, "com.flipperdevices.StorageMd5SumResponseInterface/1.0")
 QT_END_NAMESPACE
@@ -12,3 +12,13 @@ backend.depends = dfu plugins
 application.depends = backend
 cli.depends = backend
 plugins.depends = 3rdparty
+
+# Development-only parts, enable with CONFIG+=qflipper_dev
+qflipper_dev {
+    SUBDIRS += \
+        benchmarks \
+        emulator
+
+    benchmarks.depends = backend emulator
+    emulator.depends = 3rdparty
+}